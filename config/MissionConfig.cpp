@@ -0,0 +1,161 @@
+#include "MissionConfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+// Removes spaces, tabs and line endings from both ends
+static std::string trim(const std::string& text)
+{
+    const char* whitespace = " \t\r\n";
+    size_t start = text.find_first_not_of(whitespace);
+    if (start == std::string::npos)
+    {
+        return "";
+    }
+    size_t end = text.find_last_not_of(whitespace);
+    return text.substr(start, end - start + 1);
+}
+
+MissionConfig::MissionConfig()
+{
+}
+
+bool MissionConfig::load(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        perror("MissionConfig: opening config");
+        return false;
+    }
+
+    std::vector<MissionConfigEntry> loaded;
+    std::string section;
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+        std::string text = trim(line);
+        if (text.empty() || text[0] == ';' || text[0] == '#')
+        {
+            continue;
+        }
+
+        if (text[0] == '[')
+        {
+            if (text[text.length() - 1] != ']')
+            {
+                std::cout << "MissionConfig: skipping line " << lineNumber << " of " << path << ": " << text << "\n";
+                continue;
+            }
+            section = trim(text.substr(1, text.length() - 2));
+            continue;
+        }
+
+        size_t equals = text.find('=');
+        if (equals == std::string::npos || equals == 0)
+        {
+            std::cout << "MissionConfig: skipping line " << lineNumber << " of " << path << ": " << text << "\n";
+            continue;
+        }
+        MissionConfigEntry entry;
+        entry.section = section;
+        entry.key = trim(text.substr(0, equals));
+        entry.value = trim(text.substr(equals + 1));
+        loaded.push_back(entry);
+    }
+    fclose(file);
+
+    entries.swap(loaded);
+    return true;
+}
+
+const MissionConfigEntry* MissionConfig::find(const char* section, const char* key) const
+{
+    // The last one wins, as it would if each line were applied in turn
+    for (size_t i = entries.size(); i > 0; i--)
+    {
+        if (entries[i - 1].section == section && entries[i - 1].key == key)
+        {
+            return &entries[i - 1];
+        }
+    }
+    return NULL;
+}
+
+bool MissionConfig::has(const char* section, const char* key) const
+{
+    return find(section, key) != NULL;
+}
+
+const char* MissionConfig::getString(const char* section, const char* key, const char* defaultValue) const
+{
+    const MissionConfigEntry* entry = find(section, key);
+    return entry ? entry->value.c_str() : defaultValue;
+}
+
+int32_t MissionConfig::getInt(const char* section, const char* key, int32_t defaultValue) const
+{
+    int32_t value = defaultValue;
+    if (find(section, key) && getInts(section, key, &value, 1) != 1)
+    {
+        std::cout << "MissionConfig: " << section << "." << key << " is not a number, using " << defaultValue << "\n";
+        return defaultValue;
+    }
+    return value;
+}
+
+int MissionConfig::getInts(const char* section, const char* key, int32_t* values, int maxValues) const
+{
+    const MissionConfigEntry* entry = find(section, key);
+    if (!entry)
+    {
+        return 0;
+    }
+
+    // Read everything first, so nothing is changed if the list is bad
+    int32_t read[16];
+    int count = 0;
+    const char* next = entry->value.c_str();
+    while (count < maxValues && count < (int)(sizeof(read) / sizeof(*read)))
+    {
+        char* endPtr;
+        long value = strtol(next, &endPtr, 0);
+        if (endPtr == next)
+        {
+            return 0;
+        }
+        read[count++] = value;
+        while (*endPtr == ' ' || *endPtr == '\t')
+        {
+            endPtr++;
+        }
+        if (*endPtr == '\0')
+        {
+            break;
+        }
+        if (*endPtr != ',')
+        {
+            return 0;
+        }
+        next = endPtr + 1;
+    }
+
+    memcpy(values, read, count * sizeof(*values));
+    return count;
+}
+
+std::vector<MissionConfigEntry> MissionConfig::getSection(const char* section) const
+{
+    std::vector<MissionConfigEntry> found;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].section == section)
+        {
+            found.push_back(entries[i]);
+        }
+    }
+    return found;
+}
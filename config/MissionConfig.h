@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifndef MISSION_CONFIG
+#define MISSION_CONFIG
+
+// A single key = value line of a config file, with the section it was in
+typedef struct
+{
+    std::string section;
+    std::string key;
+    std::string value;
+} MissionConfigEntry;
+
+// Settings read from an INI file, such as:
+//
+//   ; comments start with ; or #
+//   [uarts]
+//   transceiver = 1, 9600
+//
+// Keys that are not in the file give back the default they are asked for,
+// so a config only needs what differs from how missionControl is built.
+class MissionConfig
+{
+    public:
+
+    MissionConfig();
+
+    // Reads the file, replacing whatever was read before.
+    // Returns false, keeping what was read before, if the file cannot be opened.
+    // Lines that make no sense are reported and skipped.
+    bool load(const char* path);
+
+    bool has(const char* section, const char* key) const;
+
+    // The value of a key, or defaultValue if there is none
+    const char* getString(const char* section, const char* key, const char* defaultValue) const;
+
+    // The value of a key as a number, or defaultValue if there is none or it is not a number
+    int32_t getInt(const char* section, const char* key, int32_t defaultValue) const;
+
+    // Reads a comma separated list of numbers into values, leaving the rest of them alone.
+    // Returns how many were read, 0 if there is no such key or it is not a list of numbers.
+    int getInts(const char* section, const char* key, int32_t* values, int maxValues) const;
+
+    // Every entry of a section, in the order of the file
+    std::vector<MissionConfigEntry> getSection(const char* section) const;
+
+    private:
+
+    const MissionConfigEntry* find(const char* section, const char* key) const;
+
+    std::vector<MissionConfigEntry> entries;
+};
+
+#endif
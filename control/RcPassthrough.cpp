@@ -0,0 +1,220 @@
+#include "RcPassthrough.h"
+#include <string.h>
+
+// Until told otherwise, 100 cycles a second and stale after five missed 50hz pulses
+#define RC_DEFAULT_RATE_HZ 100
+#define RC_DEFAULT_STALE_MS 100
+
+RcPassthrough::RcPassthrough(PWMSensor* throttle, PwmInputBank* inputs, ServoDriver* servos, FlightRecorder* recorder,
+                             LatencyHistogram* latencies)
+    : cycleThread(this, 1000000000ULL / RC_DEFAULT_RATE_HZ)
+{
+    this->throttle = throttle;
+    this->inputs = inputs;
+    this->servos = servos;
+    this->recorder = recorder;
+    this->latencies = latencies;
+    outputCount = 0;
+    staleNs = RC_DEFAULT_STALE_MS * 1000000ULL;
+    memset(&stats, 0, sizeof(stats));
+}
+
+RcPassthrough::~RcPassthrough()
+{
+    stop();
+}
+
+bool RcPassthrough::setOutputs(const RcOutput* outputs, int count)
+{
+    if (count < 0 || count > RC_MAX_OUTPUTS)
+    {
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        const RcOutput& output = outputs[i];
+        if (output.input < 0 || output.input > RC_MAX_INPUT || output.servo < 1 || output.servo > 8 ||
+            output.minPosition < 0 || output.maxPosition > 5000 || output.minPosition > output.maxPosition ||
+            output.failsafePosition < 0 || output.failsafePosition > 5000 ||
+            output.curvePointCount < 2 || output.curvePointCount > RC_MAX_CURVE_POINTS)
+        {
+            return false;
+        }
+        for (int point = 1; point < output.curvePointCount; point++)
+        {
+            if (output.curve[point].inputUs <= output.curve[point - 1].inputUs)
+            {
+                return false;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(settingsLock);
+    memcpy(this->outputs, outputs, count * sizeof(RcOutput));
+    outputCount = count;
+    // Whatever the outputs are now, they are written afresh
+    servos->forgetState();
+    stats.failsafeOutputs = 0;
+    return true;
+}
+
+void RcPassthrough::setRate(int32_t rateHz)
+{
+    cycleThread.setPeriodNs(1000000000ULL / (rateHz < 1 ? 1 : rateHz));
+}
+
+void RcPassthrough::setStaleMs(int32_t staleMs)
+{
+    staleNs = (staleMs < 0 ? 0 : staleMs) * 1000000ULL;
+}
+
+void RcPassthrough::start()
+{
+    cycleThread.start();
+}
+
+void RcPassthrough::stop()
+{
+    cycleThread.stop();
+}
+
+bool RcPassthrough::isRunning() const
+{
+    return cycleThread.isRunning();
+}
+
+RcPassthroughStats RcPassthrough::getStats()
+{
+    std::lock_guard<std::mutex> lock(settingsLock);
+    RcPassthroughStats current = stats;
+    current.lateCycles = cycleThread.getLateCycles();
+    return current;
+}
+
+int32_t RcPassthrough::mapInput(const RcOutput& output, int32_t inputUs)
+{
+    const RcCurvePoint* curve = output.curve;
+    int last = output.curvePointCount - 1;
+    int32_t position;
+    if (inputUs <= curve[0].inputUs)
+    {
+        position = curve[0].position;
+    }
+    else if (inputUs >= curve[last].inputUs)
+    {
+        position = curve[last].position;
+    }
+    else
+    {
+        int point = 1;
+        while (inputUs > curve[point].inputUs)
+        {
+            point++;
+        }
+        const RcCurvePoint& from = curve[point - 1];
+        const RcCurvePoint& to = curve[point];
+        position = from.position + (int64_t)(to.position - from.position) * (inputUs - from.inputUs) / (to.inputUs - from.inputUs);
+    }
+    return (position < output.minPosition) ? output.minPosition : ((position > output.maxPosition) ? output.maxPosition : position);
+}
+
+bool RcPassthrough::getInput(int32_t input, int32_t* widthUs, uint64_t* fallingNs) const
+{
+    if (input == 0)
+    {
+        if (!throttle || throttle->getPulseNs() == 0)
+        {
+            return false;
+        }
+        *widthUs = throttle->getValue() + 1500;
+        *fallingNs = throttle->getPulseNs();
+        return true;
+    }
+    if (!inputs || inputs->getWidth(input - 1) == 0)
+    {
+        return false;
+    }
+    *widthUs = inputs->getWidth(input - 1);
+    *fallingNs = inputs->getRisingNs(input - 1) + *widthUs * 1000ULL;
+    return true;
+}
+
+// Takes every pulse measured since the last cycle, recording them as the main loop used to
+void RcPassthrough::takePulses()
+{
+    if (throttle)
+    {
+        int32_t throttleValue = throttle->readValue();
+        if (throttleValue != INT32_MIN && recorder)
+        {
+            recorder->recordPwm(throttle->getGpio(), throttleValue);
+        }
+    }
+    if (inputs && inputs->update() > 0 && recorder)
+    {
+        const PwmInPulse* pulses = inputs->getPulses();
+        for (int i = 0; i < inputs->getPulseCount(); i++)
+        {
+            recorder->recordPwm(inputs->getGpio(pulses[i].channel), (int32_t)(pulses[i].widthNs / 1000) - 1500);
+        }
+    }
+}
+
+void RcPassthrough::runCycle(uint64_t now)
+{
+    takePulses();
+
+    std::lock_guard<std::mutex> lock(settingsLock);
+    stats.cycles++;
+    // Every output that changed goes out in one write
+    servos->beginBatch();
+    uint64_t batchFallingNs[RC_MAX_OUTPUTS];
+    int batchCount = 0;
+    for (int i = 0; i < outputCount; i++)
+    {
+        const RcOutput& output = outputs[i];
+        int32_t widthUs;
+        uint64_t fallingNs;
+        bool isStale = !getInput(output.input, &widthUs, &fallingNs) || now > fallingNs + staleNs;
+
+        int32_t position;
+        if (isStale)
+        {
+            position = output.failsafePosition;
+            if (!(stats.failsafeOutputs & (1U << i)))
+            {
+                stats.failsafeOutputs |= 1U << i;
+                stats.failsafes++;
+            }
+        }
+        else
+        {
+            position = mapInput(output, widthUs);
+            stats.failsafeOutputs &= ~(1U << i);
+        }
+
+        // Only what has changed goes to the servo controller
+        if (servos->getAngle(output.servo) == position)
+        {
+            continue;
+        }
+        servos->setAngle(output.servo, position);
+        stats.writes++;
+        if (!isStale)
+        {
+            batchFallingNs[batchCount++] = fallingNs;
+        }
+    }
+    servos->flushBatch();
+
+    uint64_t writtenNs = FlightRecorder::timestamp();
+    for (int i = 0; i < batchCount; i++)
+    {
+        latencies->record(writtenNs - batchFallingNs[i]);
+    }
+}
+
+void RcPassthrough::runCycle()
+{
+    runCycle(FlightRecorder::timestamp());
+}
@@ -0,0 +1,134 @@
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include "../devices/PWMSensor.h"
+#include "../devices/PwmInputBank.h"
+#include "../devices/ServoDriver.h"
+#include "../recorder/FlightRecorder.h"
+#include "../recorder/LatencyHistogram.h"
+#include "../scheduler/PeriodicThread.h"
+
+#ifndef RC_PASSTHROUGH
+#define RC_PASSTHROUGH
+
+// Most servo outputs, as many as the servo controller has
+#define RC_MAX_OUTPUTS 8
+// Most points a curve can have
+#define RC_MAX_CURVE_POINTS 8
+// Input 0 is the throttle, inputs 1 to this are the channels of the pwm input bank
+#define RC_MAX_INPUT PWM_IN_MAX_CHANNELS
+
+// A point of a curve, where an input pulse width gives a servo position
+typedef struct
+{
+    int32_t inputUs;
+    int32_t position;
+} RcCurvePoint;
+
+// How one servo follows one input
+typedef struct
+{
+    // 0 for the throttle, 1 to RC_MAX_INPUT for the pwm inputs
+    int32_t input;
+    // The servo controller's servo number, 1 to 8
+    int32_t servo;
+    // Where the servo goes when its input has gone stale
+    int32_t failsafePosition;
+    // Positions are kept within these, whatever the curve says, and all positions within 0 to 5000
+    int32_t minPosition;
+    int32_t maxPosition;
+    // Straight lines between the points, in increasing input, held flat beyond the ends
+    RcCurvePoint curve[RC_MAX_CURVE_POINTS];
+    int32_t curvePointCount;
+} RcOutput;
+
+// How the passthrough has been doing since it started
+typedef struct
+{
+    uint64_t cycles;
+    // Cycles that woke more than a whole period late
+    uint64_t lateCycles;
+    // Positions written to the servo controller
+    uint64_t writes;
+    // Times an output went to its failsafe position
+    uint64_t failsafes;
+    // Bit n set while output n is at its failsafe position
+    uint32_t failsafeOutputs;
+} RcPassthroughStats;
+
+// Passes radio control inputs through to the servos from a PeriodicThread of its own,
+// so it keeps its rate whatever the main loop is doing.
+//
+// Every cycle it takes the pulses measured since the last one, maps each output's input
+// through its curve and limits, and writes the positions that changed since they were last
+// written. An input with no pulse for staleMs sends its outputs to their failsafe positions.
+// How long it takes from a pulse falling to its position being written is kept in the
+// latency histogram it is given.
+//
+// While it runs, the thread is the only one to read the inputs and write the servos.
+class RcPassthrough : implements IPeriodicTask
+{
+    public:
+
+    // Passes the inputs through to the servos. Each pulse taken is also recorded, when there is a recorder.
+    // Latencies, pulse falling to position written in nanoseconds, go into the given histogram.
+    RcPassthrough(PWMSensor* throttle, PwmInputBank* inputs, ServoDriver* servos, FlightRecorder* recorder,
+                  LatencyHistogram* latencies);
+
+    // Stops the thread
+    ~RcPassthrough();
+
+    // Replaces the outputs. Can be done while running, from the next cycle on.
+    // Returns false, changing nothing, if any output makes no sense.
+    bool setOutputs(const RcOutput* outputs, int count);
+
+    // Cycles a second, at least 1
+    void setRate(int32_t rateHz);
+
+    // How long an input can go without a pulse before its outputs fail safe
+    void setStaleMs(int32_t staleMs);
+
+    // Starts the thread, if it is not already running
+    void start();
+    void stop();
+
+    bool isRunning() const;
+
+    RcPassthroughStats getStats();
+
+    // Where an output's curve and limits put the given input pulse width
+    static int32_t mapInput(const RcOutput& output, int32_t inputUs);
+
+    // A cycle of the thread, as of now
+    void runCycle();
+
+    private:
+
+    // Not copyable, we own a thread
+    RcPassthrough(const RcPassthrough&);
+    RcPassthrough& operator=(const RcPassthrough&);
+
+    void runCycle(uint64_t now);
+    void takePulses();
+
+    // The latest width of an input and when its pulse fell, false if there has been none
+    bool getInput(int32_t input, int32_t* widthUs, uint64_t* fallingNs) const;
+
+    PWMSensor* throttle;
+    PwmInputBank* inputs;
+    ServoDriver* servos;
+    FlightRecorder* recorder;
+
+    // Guards the settings and stats between the thread and everyone else
+    std::mutex settingsLock;
+    RcOutput outputs[RC_MAX_OUTPUTS];
+    int outputCount;
+    std::atomic<uint64_t> staleNs;
+    RcPassthroughStats stats;
+
+    LatencyHistogram* latencies;
+
+    PeriodicThread cycleThread;
+};
+
+#endif
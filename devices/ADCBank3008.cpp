@@ -0,0 +1,256 @@
+#include "ADCBank3008.h"
+#include "HardwarePath.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// Bytes in the transfer of a single conversion
+#define ADC_TRANSFER_BYTES 3
+
+ADCBank3008::ADCBank3008(const int32_t* channels, int count)
+{
+    isSimulated = isHardwareSimulated();
+    setChannels(channels, count);
+
+    speedHz = ADC_BANK_DEFAULT_SPEED_HZ;
+    spiHandle = open(hardwarePath("/dev/spidev2.0").c_str(), O_RDWR | O_CLOEXEC);
+    if (spiHandle == -1)
+    {
+        perror("ADCBank3008: opening /dev/spidev2.0");
+        isInitialized = false;
+        return;
+    }
+    // The simulator's stand-in is a plain file, there is nothing to configure
+    if (!isSimulated && !configureSpi())
+    {
+        isInitialized = false;
+    }
+}
+
+ADCBank3008::ADCBank3008(int spiHandle, const int32_t* channels, int count)
+{
+    isSimulated = false;
+    setChannels(channels, count);
+    this->spiHandle = spiHandle;
+    speedHz = ADC_BANK_DEFAULT_SPEED_HZ;
+    if (spiHandle == -1)
+    {
+        isInitialized = false;
+    }
+}
+
+ADCBank3008::~ADCBank3008()
+{
+    if (spiHandle != -1)
+    {
+        close(spiHandle);
+    }
+}
+
+void ADCBank3008::setChannels(const int32_t* channels, int count)
+{
+    isInitialized = count > 0 && count <= ADC_BANK_CHANNELS;
+    channelCount = 0;
+    for (int i = 0; i < count && isInitialized; i++)
+    {
+        if (channels[i] < 0 || channels[i] >= ADC_BANK_CHANNELS)
+        {
+            isInitialized = false;
+            break;
+        }
+        this->channels[channelCount++] = channels[i];
+    }
+
+    AdcSnapshot none;
+    for (int i = 0; i < ADC_BANK_CHANNELS; i++)
+    {
+        none.conversions[i] = -1;
+    }
+    none.timeNs = 0;
+    none.updateCount = 0;
+    latest.write(none);
+    updateCount = 0;
+}
+
+// The same settings ADCSensor3008 uses
+bool ADCBank3008::configureSpi()
+{
+    // Set to SPI Mode 3, data in on falling edge, data out on rising edge
+    uint8_t mode = 3;
+    if (ioctl(spiHandle, SPI_IOC_WR_MODE, &mode) == -1)
+    {
+        perror("ADCBank3008: setting spi to mode 3");
+        return false;
+    }
+
+    uint8_t bits = 8;
+    if (ioctl(spiHandle, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1)
+    {
+        perror("ADCBank3008: setting spi bits per word to 8");
+        return false;
+    }
+
+    if (ioctl(spiHandle, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz) == -1)
+    {
+        perror("ADCBank3008: setting spi speed");
+        return false;
+    }
+    return true;
+}
+
+bool ADCBank3008::setSpeed(uint32_t speedHz)
+{
+    if (speedHz < 10000 || speedHz > ADC_BANK_MAX_SPEED_HZ)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(updateLock);
+    if (!isSimulated && spiHandle != -1 && writeSpeed(speedHz) == -1)
+    {
+        perror("ADCBank3008: setting spi speed");
+        return false;
+    }
+    this->speedHz = speedHz;
+    return true;
+}
+
+uint32_t ADCBank3008::getSpeed() const
+{
+    return speedHz;
+}
+
+bool ADCBank3008::isReady() const
+{
+    return isInitialized;
+}
+
+void ADCBank3008::makeCommand(int channel, uint8_t* tx)
+{
+    tx[0] = 0x18 + channel;
+    tx[1] = 0;
+    tx[2] = 0;
+}
+
+int32_t ADCBank3008::readConversion(const uint8_t* rx)
+{
+    // Byte 0 is nonsence 0xFF because our command hadn't been read yet,
+    // first two bits of the byte 1 are no good either. (time it takes to do adc conversion).
+    // Then we only want the top four bits of byte 2, as the 10-bit total value ends there.
+    return ((rx[1] & 0x3F) << 4) | ((rx[2] & 0xF0) >> 4);
+}
+
+int ADCBank3008::transfer(struct spi_ioc_transfer* transfers, int count)
+{
+    return ioctl(spiHandle, SPI_IOC_MESSAGE(count), transfers);
+}
+
+int ADCBank3008::writeSpeed(uint32_t speedHz)
+{
+    return ioctl(spiHandle, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz);
+}
+
+bool ADCBank3008::readSimulated(int32_t* conversions)
+{
+    uint16_t simulatedValues[SIMULATED_ADC_CHANNELS];
+    if (pread(spiHandle, simulatedValues, sizeof(simulatedValues), 0) != sizeof(simulatedValues))
+    {
+        return false;
+    }
+    for (int i = 0; i < channelCount; i++)
+    {
+        conversions[channels[i]] = simulatedValues[channels[i]] & 0x3FF;
+    }
+    return true;
+}
+
+bool ADCBank3008::update()
+{
+    if (!isInitialized)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(updateLock);
+
+    int32_t converted[ADC_BANK_CHANNELS];
+    for (int i = 0; i < ADC_BANK_CHANNELS; i++)
+    {
+        converted[i] = -1;
+    }
+
+    if (isSimulated)
+    {
+        if (!readSimulated(converted))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        uint8_t tx[ADC_BANK_CHANNELS][ADC_TRANSFER_BYTES];
+        uint8_t rx[ADC_BANK_CHANNELS][ADC_TRANSFER_BYTES];
+        struct spi_ioc_transfer transfers[ADC_BANK_CHANNELS];
+        memset(transfers, 0, sizeof(transfers));
+        memset(rx, 0, sizeof(rx));
+        for (int i = 0; i < channelCount; i++)
+        {
+            makeCommand(channels[i], tx[i]);
+            transfers[i].tx_buf = (unsigned long)tx[i];
+            transfers[i].rx_buf = (unsigned long)rx[i];
+            transfers[i].len = ADC_TRANSFER_BYTES;
+            transfers[i].speed_hz = speedHz;
+            // Each conversion starts with chip select going down, so it goes up between them.
+            // (cs_change on the last transfer would instead leave it down after the message.)
+            transfers[i].cs_change = (i < channelCount - 1) ? 1 : 0;
+        }
+
+        if (transfer(transfers, channelCount) == -1)
+        {
+            perror("ADCBank3008: performing spi transfer");
+            return false;
+        }
+        for (int i = 0; i < channelCount; i++)
+        {
+            converted[channels[i]] = readConversion(rx[i]);
+        }
+    }
+
+    publish(converted);
+    return true;
+}
+
+void ADCBank3008::publish(const int32_t* converted)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    AdcSnapshot snapshot;
+    memcpy(snapshot.conversions, converted, sizeof(snapshot.conversions));
+    snapshot.timeNs = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    snapshot.updateCount = ++updateCount;
+    latest.write(snapshot);
+}
+
+int32_t ADCBank3008::getConversion(int channel) const
+{
+    if (channel < 0 || channel >= ADC_BANK_CHANNELS)
+    {
+        return -1;
+    }
+    AdcSnapshot snapshot;
+    latest.read(&snapshot);
+    return snapshot.conversions[channel];
+}
+
+int32_t ADCBank3008::getValue(int channel) const
+{
+    int32_t conversion = getConversion(channel);
+    return (conversion < 0) ? -1 : conversion << ADC_FILTER_FRACTION_BITS;
+}
+
+void ADCBank3008::getSnapshot(AdcSnapshot* snapshot) const
+{
+    latest.read(snapshot);
+}
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <linux/spi/spidev.h>
+#include "IAdcSource.h"
+#include "SeqLock.h"
+
+#ifndef ADC_BANK_3008
+#define ADC_BANK_3008
+
+// Channels of the MCP3008
+#define ADC_BANK_CHANNELS 8
+// The spi clock the MCP3008 has always been run at, and the most it can take (at 5 volts)
+#define ADC_BANK_DEFAULT_SPEED_HZ 100000
+#define ADC_BANK_MAX_SPEED_HZ 3600000
+
+// A consistent set of conversions, all from the same update
+typedef struct
+{
+    // The 10-bit conversion of each channel, -1 for a channel not read or not yet converted
+    int32_t conversions[ADC_BANK_CHANNELS];
+    // CLOCK_MONOTONIC nanoseconds the update was made, 0 if there has not been one
+    uint64_t timeNs;
+    // Updates made so far, this one included
+    uint32_t updateCount;
+} AdcSnapshot;
+
+// Takes analog measurements of several channels of the MCP3008 at once.
+//
+// An update reads every channel asked for with a single SPI_IOC_MESSAGE of chained
+// transfers, one per channel with chip select raised between them, rather than a system
+// call for each. The conversions are then published together under a SeqLock,
+// so that any thread can read the latest of them, as a consistent set, without waiting
+// on the spi bus or on whichever thread is updating.
+// When the hardware is simulated, an update is a single read of the simulator's stand-in.
+class ADCBank3008 : implements IAdcSource
+{
+    public:
+
+    /*
+    Make use of int32_t, int16_t, int8_t (32-bits, 16-bits, or 8-bits)
+    instead of int, short, or char.
+    This will ensure that the length of the integer is always the same on different platforms.
+    */
+
+    // Opens /dev/spidev2.0 to read the given channels, each from 0 to 7.
+    // If it cannot be opened and configured, or a channel is out of range, isReady() will return false.
+    ADCBank3008(const int32_t* channels, int count);
+
+    // Reads the given channels with an spi device that is already open and configured, which the bank
+    // then owns. For tests, with transfer overridden.
+    ADCBank3008(int spiHandle, const int32_t* channels, int count);
+
+    virtual ~ADCBank3008();
+
+    bool isReady() const;
+
+    // Sets the spi clock, from 10kHz to ADC_BANK_MAX_SPEED_HZ. Each conversion is 24 clocks,
+    // so at the default 100kHz eight channels take about 2ms.
+    // Returns false, leaving the clock as it was, if it is out of range or cannot be set.
+    bool setSpeed(uint32_t speedHz);
+    uint32_t getSpeed() const;
+
+    // Converts every channel with one spi message and publishes the conversions.
+    // Returns false if the transfer failed, leaving the last conversions published.
+    bool update();
+
+    // The latest conversion of a channel (0 to 7), -1 if it is not read or there has not been one
+    int32_t getConversion(int channel) const;
+
+    // The same conversion shifted up ADC_FILTER_FRACTION_BITS, -1 if there is none
+    int32_t getValue(int channel) const;
+
+    // Copies out the latest conversions, all from the same update
+    void getSnapshot(AdcSnapshot* snapshot) const;
+
+    // The command bytes that start a conversion of the channel, and the conversion in the bytes received back
+    static void makeCommand(int channel, uint8_t* tx);
+    static int32_t readConversion(const uint8_t* rx);
+
+    protected:
+
+    // Carries out the chained transfers as one spi message.
+    // Returns -1 on failure, as the SPI_IOC_MESSAGE ioctl does.
+    virtual int transfer(struct spi_ioc_transfer* transfers, int count);
+
+    // Sets the spi device's clock, returning -1 on failure as the ioctl does
+    virtual int writeSpeed(uint32_t speedHz);
+
+    private:
+
+    void setChannels(const int32_t* channels, int count);
+    bool configureSpi();
+    bool readSimulated(int32_t* conversions);
+    void publish(const int32_t* conversions);
+
+    // Not copyable, we own the handle
+    ADCBank3008(const ADCBank3008&);
+    ADCBank3008& operator=(const ADCBank3008&);
+
+    int spiHandle;
+    uint32_t speedHz;
+    // Reading the simulator's stand-in rather than an spi device
+    bool isSimulated;
+
+    int32_t channels[ADC_BANK_CHANNELS];
+    int channelCount;
+
+    // Serializes updates, as there can only be one writer of what is published
+    std::mutex updateLock;
+    uint32_t updateCount;
+
+    // The latest conversions, for anyone to read
+    SeqLock<AdcSnapshot> latest;
+
+    // Whether the spi device was opened and the channels make sense, value returned by isReady
+    bool isInitialized;
+};
+
+#endif
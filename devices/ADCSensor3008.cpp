@@ -1,4 +1,6 @@
 #include "ADCSensor3008.h"
+#include "ADCBank3008.h"
+#include "HardwarePath.h"
 #include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -13,12 +15,25 @@ std::mutex ADCSensor3008::spiAdcMutex;
 ADCSensor3008::ADCSensor3008(int adcNumber)
 {
     this->adcNumber = (adcNumber < 0) ? 0 : ((adcNumber > 7) ? 7 : adcNumber);
-    this->lastConvertedValue = -1;
+    this->lastValue = -1;
+    this->source = NULL;
+}
+
+ADCSensor3008::ADCSensor3008(IAdcSource* source, int adcNumber)
+{
+    this->adcNumber = (adcNumber < 0) ? 0 : ((adcNumber > 7) ? 7 : adcNumber);
+    this->lastValue = -1;
+    this->source = source;
 }
 
 int32_t ADCSensor3008::getConversion() const
 {
-    return this->lastConvertedValue;
+    return adcValueToConversion(this->lastValue);
+}
+
+int32_t ADCSensor3008::getValue() const
+{
+    return this->lastValue;
 }
 
 // Open and configure the spi device.
@@ -29,7 +44,7 @@ int32_t ADCSensor3008::initializeSpi()
 {
     if (ADCSensor3008::spiAdcHandle == 0)
     {
-        int handle = open("/dev/spidev2.0", O_RDWR);
+        int handle = open(hardwarePath("/dev/spidev2.0").c_str(), O_RDWR);
         if (handle == -1)
         {
             perror("ADCSensor3008: opening /dev/spidev2.0");
@@ -37,6 +52,12 @@ int32_t ADCSensor3008::initializeSpi()
         }
         ADCSensor3008::spiAdcHandle = handle;
         
+        // The simulator's stand-in is a plain file, there is nothing to configure
+        if (isHardwareSimulated())
+        {
+            return 0;
+        }
+        
         // Set to SPI Mode 3, data in on falling edge, data out on rising edge
         uint8_t mode = 3;
         int result = ioctl(ADCSensor3008::spiAdcHandle, SPI_IOC_WR_MODE, &mode);
@@ -67,6 +88,26 @@ int32_t ADCSensor3008::initializeSpi()
 }
 
 int32_t ADCSensor3008::readConversion()
+{
+    return adcValueToConversion(readValue());
+}
+
+int32_t ADCSensor3008::readValue()
+{
+    if (this->source)
+    {
+        this->lastValue = this->source->getValue(this->adcNumber);
+    }
+    else
+    {
+        int32_t conversion = readSpiConversion();
+        this->lastValue = (conversion < 0) ? -1 : conversion << ADC_FILTER_FRACTION_BITS;
+    }
+    return this->lastValue;
+}
+
+// Takes the spiAdcMutex itself
+int32_t ADCSensor3008::readSpiConversion()
 {
     // Lock us up in the garage
     this->spiAdcMutex.lock();
@@ -78,8 +119,22 @@ int32_t ADCSensor3008::readConversion()
         return -1;
     }
     
-    uint8_t tx[] = {(uint8_t)(0x18 + this->adcNumber), 0, 0};
+    // The simulator's stand-in holds each channel's conversion
+    if (isHardwareSimulated())
+    {
+        uint16_t simulatedValue;
+        int result = pread(this->spiAdcHandle, &simulatedValue, sizeof(simulatedValue), this->adcNumber * sizeof(simulatedValue));
+        this->spiAdcMutex.unlock();
+        if (result != sizeof(simulatedValue))
+        {
+            return -1;
+        }
+        return simulatedValue & 0x3FF;
+    }
+    
+    uint8_t tx[3];
     uint8_t rx[] = {0, 0, 0};
+    ADCBank3008::makeCommand(this->adcNumber, tx);
     
     struct spi_ioc_transfer spiTransfer;
     spiTransfer.tx_buf = (unsigned long)tx;
@@ -99,11 +154,5 @@ int32_t ADCSensor3008::readConversion()
     
     this->spiAdcMutex.unlock();
     
-    // Byte 0 is nonsence 0xFF because our command hadn't been read yet,
-    // first two bits of the byte 1 are no good either. (time it takes to do adc conversion).
-    // Then we only want the top four bits of byte 2, as the 10-bit total value ends there.
-    int32_t adcValue = ((rx[1] & 0x3F) << 4) | ((rx[2] & 0xF0) >> 4);
-    this->lastConvertedValue = adcValue;
-    
-    return adcValue;
+    return ADCBank3008::readConversion(rx);
 }
@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <mutex>
+#include "IAdcSource.h"
 
 #ifndef ADC_SENSOR_3008
 #define ADC_SENSOR_3008
@@ -7,6 +8,9 @@
 // Takes analog measurements from a physical MCP3008 ADC (analog to digital) device.
 // This class will grab on to the SPI device /dev/spidev2.0 to communicate with the MCP3008.
 // It will never let go of this device.
+// When the hardware is simulated, the conversions are read from the simulator's stand-in file.
+// Given an adc source, such as an ADCBank3008, it instead reads the source's latest value of its channel,
+// which from a filtering source such as an AdcAcquisition has more bits than a conversion.
 class ADCSensor3008
 {
     public:
@@ -21,25 +25,45 @@ class ADCSensor3008
     // which is from 0 to 7. Different values will be saturated into this range.
     ADCSensor3008(int adcNumber);
     
+    // Creates an ADCSensor3008 that reads the source's latest conversions of the adc number,
+    // without using the spi device itself. The source is kept up to date by its owner.
+    ADCSensor3008(IAdcSource* source, int adcNumber);
+    
     // Value is the 10-bit ADC conversion.
-    // Returns the last converted value read from the sensor.
+    // Returns the last converted value read from the sensor, rounded from the full value.
     // return -1 if no conversion has yet been made.
     int32_t getConversion() const;
     
     // Value is the 10-bit ADC conversion
     // Queries the sensor to convert an ADC value according to the adcNumber of this ADCSensor3008.
+    // With a source, this is the source's latest value rounded to a conversion.
     // Returns -1 if the conversion is unable to succeed.
     int32_t readConversion();
+    
+    // Value has ADC_FILTER_FRACTION_BITS below the count of the 10-bit conversion.
+    // Returns the last value read from the sensor, -1 if none has yet been made.
+    int32_t getValue() const;
+    
+    // Value has ADC_FILTER_FRACTION_BITS below the count of the 10-bit conversion.
+    // Queries the sensor as readConversion does, keeping all the bits the source has.
+    // Returns -1 if the conversion is unable to succeed.
+    int32_t readValue();
 
     private:
         
     static int32_t initializeSpi();
     
+    // Converts the channel over the spi device (or the simulator's stand-in), -1 on failure
+    int32_t readSpiConversion();
+    
     // The adc pin number to read from the physical device
     int adcNumber;
     
-    // The last 10-bit value we converted, made by readConversion.
-    int32_t lastConvertedValue;
+    // The last value we read, with ADC_FILTER_FRACTION_BITS, made by readValue.
+    int32_t lastValue;
+    
+    // Where the conversions come from instead of the spi device, or NULL
+    IAdcSource* source;
     
     // A handle to the linux SPI device file, shared by all ADCSensor3008 instances
     static int spiAdcHandle;
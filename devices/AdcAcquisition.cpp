@@ -0,0 +1,217 @@
+#include "AdcAcquisition.h"
+#include <string.h>
+
+// Until told otherwise, 1000 samples a second through second order filters, 32 samples to a value
+#define ADC_DEFAULT_RATE_HZ 1000
+#define ADC_DEFAULT_FILTER_ORDER 2
+#define ADC_DEFAULT_DECIMATION 32
+
+AdcAcquisition::AdcAcquisition(ADCBank3008* bank)
+    : sampleThread(this, 1000000000ULL / ADC_DEFAULT_RATE_HZ)
+{
+    this->bank = bank;
+    memset(&stats, 0, sizeof(stats));
+    setFilter(ADC_DEFAULT_FILTER_ORDER, ADC_DEFAULT_DECIMATION);
+}
+
+AdcAcquisition::~AdcAcquisition()
+{
+    stop();
+}
+
+void AdcAcquisition::setRate(int32_t rateHz)
+{
+    rateHz = (rateHz < 1) ? 1 : ((rateHz > ADC_MAX_SAMPLE_RATE_HZ) ? ADC_MAX_SAMPLE_RATE_HZ : rateHz);
+    sampleThread.setPeriodNs(1000000000ULL / rateHz);
+}
+
+int32_t AdcAcquisition::getRate() const
+{
+    return (int32_t)(1000000000ULL / sampleThread.getPeriodNs());
+}
+
+bool AdcAcquisition::setFilter(int32_t order, int32_t decimation)
+{
+    if (order < 1 || order > ADC_MAX_FILTER_ORDER || decimation < 1 || decimation > ADC_MAX_DECIMATION ||
+        (decimation & (decimation - 1)) != 0)
+    {
+        return false;
+    }
+    int32_t shift = 0;
+    while ((1 << shift) < decimation)
+    {
+        shift++;
+    }
+
+    std::lock_guard<std::mutex> lock(filterLock);
+    this->order = order;
+    decimationShift = shift;
+    resetFilters();
+    return true;
+}
+
+int32_t AdcAcquisition::getOrder()
+{
+    std::lock_guard<std::mutex> lock(filterLock);
+    return order;
+}
+
+int32_t AdcAcquisition::getDecimation()
+{
+    std::lock_guard<std::mutex> lock(filterLock);
+    return 1 << decimationShift;
+}
+
+// The filterLock should already be taken
+void AdcAcquisition::resetFilters()
+{
+    phase = 0;
+    settlingOutputs = 0;
+    memset(integrators, 0, sizeof(integrators));
+    memset(combs, 0, sizeof(combs));
+    sampledChannels = (1U << ADC_BANK_CHANNELS) - 1;
+
+    int32_t none[ADC_BANK_CHANNELS];
+    for (int i = 0; i < ADC_BANK_CHANNELS; i++)
+    {
+        none[i] = -1;
+    }
+    publish(none, 0, 0);
+}
+
+void AdcAcquisition::start()
+{
+    sampleThread.start();
+}
+
+void AdcAcquisition::stop()
+{
+    sampleThread.stop();
+}
+
+bool AdcAcquisition::isRunning() const
+{
+    return sampleThread.isRunning();
+}
+
+void AdcAcquisition::addSample(const int32_t* conversions, uint64_t sampleNs)
+{
+    std::lock_guard<std::mutex> lock(filterLock);
+    stats.samples++;
+
+    for (int channel = 0; channel < ADC_BANK_CHANNELS; channel++)
+    {
+        // A channel missing from any sample has nothing sensible to say until the filters start over
+        if (conversions[channel] < 0)
+        {
+            sampledChannels &= ~(1U << channel);
+            continue;
+        }
+        uint32_t* integrator = integrators[channel];
+        integrator[0] += (uint32_t)conversions[channel];
+        for (int stage = 1; stage < order; stage++)
+        {
+            integrator[stage] += integrator[stage - 1];
+        }
+    }
+
+    if (++phase < (1 << decimationShift))
+    {
+        return;
+    }
+    phase = 0;
+
+    // The combs take the difference over the output period, leaving the sum of the window times the gain
+    int32_t filtered[ADC_BANK_CHANNELS];
+    int32_t gainShift = order * decimationShift;
+    for (int channel = 0; channel < ADC_BANK_CHANNELS; channel++)
+    {
+        uint32_t sum = integrators[channel][order - 1];
+        for (int stage = 0; stage < order; stage++)
+        {
+            uint32_t last = combs[channel][stage];
+            combs[channel][stage] = sum;
+            sum -= last;
+        }
+
+        if (!(sampledChannels & (1U << channel)))
+        {
+            filtered[channel] = -1;
+        }
+        else if (gainShift > ADC_FILTER_FRACTION_BITS)
+        {
+            int32_t shift = gainShift - ADC_FILTER_FRACTION_BITS;
+            filtered[channel] = (int32_t)((sum + (1U << (shift - 1))) >> shift);
+        }
+        else
+        {
+            filtered[channel] = (int32_t)(sum << (ADC_FILTER_FRACTION_BITS - gainShift));
+        }
+    }
+
+    // Until every comb has seen a whole output period, the outputs are still settling
+    if (++settlingOutputs < (uint32_t)order)
+    {
+        return;
+    }
+    settlingOutputs = order;
+
+    uint64_t delayNs = sampleThread.getPeriodNs() * order * ((1 << decimationShift) - 1) / 2;
+    publish(filtered, sampleNs > delayNs ? sampleNs - delayNs : 0, outputCount + 1);
+    stats.outputs++;
+}
+
+// The filterLock should already be taken, as there can only be one writer of what is published
+void AdcAcquisition::publish(const int32_t* filtered, uint64_t filteredNs, uint32_t count)
+{
+    AdcFilteredSnapshot snapshot;
+    memcpy(snapshot.values, filtered, sizeof(snapshot.values));
+    snapshot.timeNs = filteredNs;
+    snapshot.outputCount = count;
+    outputCount = count;
+    latest.write(snapshot);
+}
+
+int32_t AdcAcquisition::getValue(int channel) const
+{
+    if (channel < 0 || channel >= ADC_BANK_CHANNELS)
+    {
+        return -1;
+    }
+    AdcFilteredSnapshot snapshot;
+    latest.read(&snapshot);
+    return snapshot.values[channel];
+}
+
+int32_t AdcAcquisition::getConversion(int channel) const
+{
+    return adcValueToConversion(getValue(channel));
+}
+
+void AdcAcquisition::getSnapshot(AdcFilteredSnapshot* snapshot) const
+{
+    latest.read(snapshot);
+}
+
+AdcAcquisitionStats AdcAcquisition::getStats()
+{
+    std::lock_guard<std::mutex> lock(filterLock);
+    AdcAcquisitionStats current = stats;
+    current.lateSamples = sampleThread.getLateCycles();
+    return current;
+}
+
+void AdcAcquisition::runCycle()
+{
+    if (bank->update())
+    {
+        AdcSnapshot sample;
+        bank->getSnapshot(&sample);
+        addSample(sample.conversions, sample.timeNs);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(filterLock);
+        stats.failedSamples++;
+    }
+}
@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include "ADCBank3008.h"
+#include "IAdcSource.h"
+#include "SeqLock.h"
+#include "../scheduler/PeriodicThread.h"
+
+#ifndef ADC_ACQUISITION
+#define ADC_ACQUISITION
+
+// Most integrator and comb stages, and the most samples decimated to one value.
+// Together they keep the 10-bit samples and the filter's gain within 32 bits.
+#define ADC_MAX_FILTER_ORDER 3
+#define ADC_MAX_DECIMATION 128
+// Most samples a second the thread can be asked for
+#define ADC_MAX_SAMPLE_RATE_HZ 10000
+
+// The latest filtered values, all from the same output of the filters
+typedef struct
+{
+    // Each channel's filtered conversion, in 1/64ths of a count (the 10-bit conversion shifted up
+    // ADC_FILTER_FRACTION_BITS), -1 for a channel not read or not yet filtered
+    int32_t values[ADC_BANK_CHANNELS];
+    // CLOCK_MONOTONIC nanoseconds the values stand for, which is the last sample's time less the filter's delay.
+    // 0 if there has been no output.
+    uint64_t timeNs;
+    // Outputs made since the filters were last set, this one included
+    uint32_t outputCount;
+} AdcFilteredSnapshot;
+
+// How the acquisition has been doing since it started
+typedef struct
+{
+    uint64_t samples;
+    // Samples the bank could not convert, left out of the filters
+    uint64_t failedSamples;
+    // Samples taken more than a whole period late
+    uint64_t lateSamples;
+    uint64_t outputs;
+} AdcAcquisitionStats;
+
+// Samples every channel of an ADCBank3008 from a PeriodicThread of its own, many times faster than
+// the values are wanted, and filters the samples down to fewer values with more bits.
+//
+// Each channel has a CIC filter: order integrators run at the sample rate, and every
+// decimation samples the integrated sum goes through order combs. With an order of 1 that
+// is a plain boxcar average of the last decimation samples; higher orders take out more of
+// the noise above the output rate, for a longer delay of order * (decimation - 1) / 2 samples.
+// Averaging n samples of noisy conversions gains about half of log2(n) bits, so the values
+// are published with ADC_FILTER_FRACTION_BITS below the count, under a SeqLock as
+// ADCBank3008 publishes its own.
+//
+// The filters are only adds and shifts, a few for each channel each sample; the cost of a
+// sample is the bank's single spi message.
+// While it runs, the thread is the only one to update the bank.
+class AdcAcquisition : implements IAdcSource, implements IPeriodicTask
+{
+    public:
+
+    // Filters the channels the bank reads. The bank should be ready.
+    AdcAcquisition(ADCBank3008* bank);
+
+    // Stops the thread
+    ~AdcAcquisition();
+
+    // Samples a second, from 1 to ADC_MAX_SAMPLE_RATE_HZ.
+    // The bank's spi clock has to be fast enough to convert its channels that often.
+    void setRate(int32_t rateHz);
+    int32_t getRate() const;
+
+    // Sets the filters' order, 1 to ADC_MAX_FILTER_ORDER, and how many samples make one value,
+    // a power of two up to ADC_MAX_DECIMATION. The filters start over, from the next sample on.
+    // Returns false, changing nothing, if either makes no sense.
+    bool setFilter(int32_t order, int32_t decimation);
+    int32_t getOrder();
+    int32_t getDecimation();
+
+    // Starts the thread, if it is not already running
+    void start();
+    void stop();
+
+    bool isRunning() const;
+
+    // Puts one sample of every channel, -1 for those not converted, through the filters,
+    // publishing the values when it completes an output. The thread does this for each sample
+    // the bank converts; tests can do it themselves.
+    void addSample(const int32_t* conversions, uint64_t timeNs);
+
+    // The latest filtered value of a channel, with ADC_FILTER_FRACTION_BITS, -1 if there is none
+    int32_t getValue(int channel) const;
+
+    // The latest filtered value of a channel rounded to a 10-bit conversion, -1 if there is none
+    int32_t getConversion(int channel) const;
+
+    // Copies out the latest filtered values, all from the same output
+    void getSnapshot(AdcFilteredSnapshot* snapshot) const;
+
+    AdcAcquisitionStats getStats();
+
+    // A sample of the thread: updates the bank and puts the sample through the filters
+    void runCycle();
+
+    private:
+
+    // Not copyable, we own a thread
+    AdcAcquisition(const AdcAcquisition&);
+    AdcAcquisition& operator=(const AdcAcquisition&);
+
+    void resetFilters();
+    void publish(const int32_t* values, uint64_t timeNs, uint32_t count);
+
+    ADCBank3008* bank;
+
+    // Guards the filters and stats between the thread and everyone else
+    std::mutex filterLock;
+    int32_t order;
+    // Decimation is 1 << decimationShift
+    int32_t decimationShift;
+    // Samples into the current output
+    int32_t phase;
+    // Outputs made since the filters started over, the first order - 1 are still settling
+    uint32_t settlingOutputs;
+    // The integrators and the combs' last inputs. Sums wrap around, which the combs undo.
+    uint32_t integrators[ADC_BANK_CHANNELS][ADC_MAX_FILTER_ORDER];
+    uint32_t combs[ADC_BANK_CHANNELS][ADC_MAX_FILTER_ORDER];
+    // Channels with a conversion in every sample since the filters started over
+    uint32_t sampledChannels;
+    AdcAcquisitionStats stats;
+    // Outputs published since the filters were last set
+    uint32_t outputCount;
+
+    // The latest filtered values, for anyone to read
+    SeqLock<AdcFilteredSnapshot> latest;
+
+    PeriodicThread sampleThread;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "CalibrationTable.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Rounds to the nearest value a table entry can hold
+static int32_t toEntry(double value)
+{
+    if (value >= INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    // INT32_MIN is kept for a failed conversion
+    if (value <= INT32_MIN + 1.0)
+    {
+        return INT32_MIN + 1;
+    }
+    return (int32_t)floor(value + 0.5);
+}
+
+CalibrationTable::CalibrationTable()
+{
+    memset(table, 0, sizeof(table));
+}
+
+bool CalibrationTable::setPoints(const CalibrationPoint* points, int count)
+{
+    if (count < 2 || count > CALIBRATION_MAX_POINTS)
+    {
+        return false;
+    }
+    for (int i = 1; i < count; i++)
+    {
+        if (points[i].conversion <= points[i - 1].conversion)
+        {
+            return false;
+        }
+    }
+
+    // Conversions before the second point are on the first line, those after the second to last on the last line
+    int line = 0;
+    for (int32_t conversion = 0; conversion < CALIBRATION_TABLE_SIZE; conversion++)
+    {
+        while (line < count - 2 && conversion > points[line + 1].conversion)
+        {
+            line++;
+        }
+        const CalibrationPoint& from = points[line];
+        const CalibrationPoint& to = points[line + 1];
+        double slope = (double)((int64_t)to.value - from.value) / ((int64_t)to.conversion - from.conversion);
+        table[conversion] = toEntry(from.value + slope * ((int64_t)conversion - from.conversion));
+    }
+    return true;
+}
+
+bool CalibrationTable::setPolynomial(const double* coefficients, int count)
+{
+    if (count < 1 || count > CALIBRATION_MAX_COEFFICIENTS)
+    {
+        return false;
+    }
+    for (int32_t conversion = 0; conversion < CALIBRATION_TABLE_SIZE; conversion++)
+    {
+        double value = 0;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            value = value * conversion + coefficients[i];
+        }
+        table[conversion] = toEntry(value);
+    }
+    return true;
+}
+
+bool CalibrationTable::parse(const char* text)
+{
+    bool isPoints = strncmp(text, "points", 6) == 0;
+    bool isPolynomial = strncmp(text, "polynomial", 10) == 0;
+    if (!isPoints && !isPolynomial)
+    {
+        return false;
+    }
+
+    // Everything after the kind of calibration is a comma separated list of numbers
+    double numbers[CALIBRATION_MAX_POINTS * 2];
+    int count = 0;
+    const char* next = text + (isPoints ? 6 : 10);
+    while (*next == ' ' || *next == '\t')
+    {
+        next++;
+    }
+    while (*next == ',')
+    {
+        if (count == (int)(sizeof(numbers) / sizeof(*numbers)))
+        {
+            return false;
+        }
+        char* endPtr;
+        numbers[count] = strtod(next + 1, &endPtr);
+        if (endPtr == next + 1 || fabs(numbers[count]) > INT32_MAX)
+        {
+            return false;
+        }
+        count++;
+        next = endPtr;
+        while (*next == ' ' || *next == '\t')
+        {
+            next++;
+        }
+    }
+    if (*next != '\0')
+    {
+        return false;
+    }
+
+    if (isPolynomial)
+    {
+        return setPolynomial(numbers, count);
+    }
+    if (count % 2 != 0)
+    {
+        return false;
+    }
+    CalibrationPoint points[CALIBRATION_MAX_POINTS];
+    for (int i = 0; i < count / 2; i++)
+    {
+        points[i].conversion = (int32_t)numbers[i * 2];
+        points[i].value = (int32_t)numbers[i * 2 + 1];
+    }
+    return setPoints(points, count / 2);
+}
@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include "IAdcSource.h"
+
+#ifndef CALIBRATION_TABLE
+#define CALIBRATION_TABLE
+
+// Entries of a table, one for every 10-bit adc conversion
+#define CALIBRATION_TABLE_SIZE 1024
+// Most points of a piecewise linear calibration, and most coefficients of a polynomial one
+#define CALIBRATION_MAX_POINTS 16
+#define CALIBRATION_MAX_COEFFICIENTS 6
+
+// A point of a calibration, where a conversion gives a value
+typedef struct
+{
+    int32_t conversion;
+    int32_t value;
+} CalibrationPoint;
+
+// Turns 10-bit adc conversions into what a sensor measures, with a single indexed load.
+//
+// A calibration is given once, as straight lines between points or as a polynomial,
+// and worked out for every one of the 1024 conversions there and then, so whatever
+// arithmetic it takes is never done again when a conversion is looked up.
+// Filtered adc values have ADC_FILTER_FRACTION_BITS below the count, which rounding
+// to one entry would throw away, so convertValue goes between the two either side
+// of them instead, for two loads and a multiply.
+// Values have the decimal point fixed at the 1000s place, as the sensors give them.
+class CalibrationTable
+{
+    public:
+
+    /*
+    Make use of int32_t, int16_t, int8_t (32-bits, 16-bits, or 8-bits)
+    instead of int, short, or char.
+    This will ensure that the length of the integer is always the same on different platforms.
+    */
+
+    // A table giving 0 for everything, until it is given a calibration
+    CalibrationTable();
+
+    // Straight lines between the points, given in increasing conversion, carried on past the
+    // first and last. Returns false, changing nothing, if there are fewer than two points
+    // or they are out of order.
+    bool setPoints(const CalibrationPoint* points, int count);
+
+    // value = coefficients[0] + coefficients[1] * conversion + coefficients[2] * conversion^2 ...
+    // Returns false, changing nothing, if there are no coefficients or too many.
+    bool setPolynomial(const double* coefficients, int count);
+
+    // Reads a calibration as the config gives it, either
+    //   "points, conversion, value, conversion, value, ..." or
+    //   "polynomial, c0, c1, c2, ..."
+    // Returns false, changing nothing, if it makes no sense.
+    bool parse(const char* text);
+
+    // The value of a conversion from 0 to 1023, INT32_MIN for anything else (such as -1 for a failed conversion)
+    inline int32_t convert(int32_t conversion) const
+    {
+        if ((uint32_t)conversion >= CALIBRATION_TABLE_SIZE)
+        {
+            return INT32_MIN;
+        }
+        return table[conversion];
+    }
+
+    // What an adc value measures, the value being a conversion from 0 to 1023 with
+    // ADC_FILTER_FRACTION_BITS below it. INT32_MIN for anything else (such as -1 for a failed conversion).
+    inline int32_t convertValue(int32_t value) const
+    {
+        uint32_t conversion = (uint32_t)value >> ADC_FILTER_FRACTION_BITS;
+        if (value < 0 || conversion >= CALIBRATION_TABLE_SIZE)
+        {
+            return INT32_MIN;
+        }
+        int32_t fraction = value & ((1 << ADC_FILTER_FRACTION_BITS) - 1);
+        if (fraction == 0 || conversion == CALIBRATION_TABLE_SIZE - 1)
+        {
+            return table[conversion];
+        }
+        // Rounded to the nearest, a half going up
+        int64_t between = ((int64_t)table[conversion + 1] - table[conversion]) * fraction + (1 << (ADC_FILTER_FRACTION_BITS - 1));
+        return table[conversion] + (int32_t)(between >> ADC_FILTER_FRACTION_BITS);
+    }
+
+    private:
+
+    int32_t table[CALIBRATION_TABLE_SIZE];
+};
+
+#endif
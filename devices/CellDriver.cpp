@@ -10,7 +10,7 @@ uint64_t cellMillis()
     return currentTime.tv_sec * 1000 + currentTime.tv_usec / 1000;
 }
 
-CellDriver::CellDriver(Uart* uart)
+CellDriver::CellDriver(ISerial* uart)
 {
     this->uart = uart;
     shouldEchoUartToStdout = false;
@@ -18,6 +18,10 @@ CellDriver::CellDriver(Uart* uart)
     //think about size of buffer - may cut off message if more than 1 is sent
     responseBuffer.reserve(200);
     isWaitingForOk = false;
+    isWaitingForPrompt = false;
+    isReceivingTextMessage = false;
+    isReceivingCellTowers = false;
+    registrationStatus = -1;
     lastRetrieveMessagesTime = cellMillis();
     lastCellTowerTime = cellMillis();
     
@@ -46,9 +50,10 @@ int8_t CellDriver::update()
         setupCellModule();
     }
     
-    // Check for messages every 10 seconds..
+    // Check for messages (and that we are still registered) every 10 seconds..
     if (cellMillis() > lastRetrieveMessagesTime + 10000)
     {
+        queueRegistrationCheck();
         retrieveTextMessages();
         lastRetrieveMessagesTime = cellMillis();
     }
@@ -136,6 +141,21 @@ void CellDriver::retrieveTextMessages()
 }  
 
 
+void CellDriver::queueRegistrationCheck()
+{
+    commandQueue.push_back("AT+CREG?\r");
+}
+
+bool CellDriver::isRegistered() const
+{
+    return registrationStatus == 1 || registrationStatus == 5;
+}
+
+int8_t CellDriver::getRegistrationStatus() const
+{
+    return registrationStatus;
+}
+
 void CellDriver::deleteMessage(TextMessage textMessage)
 {
     std::stringstream deleteCommand;
@@ -222,6 +242,18 @@ int8_t CellDriver::parse(std::string inputResponse)
         return false;
     }
 
+    // Response to a request for the registration status
+    if (strcmp(inputResponse.substr(0,5).c_str(), "+CREG") == 0)
+    {
+        // The status follows the comma, after the unsolicited result code setting
+        size_t comma = inputResponse.find(',');
+        if (comma != std::string::npos)
+        {
+            registrationStatus = strtol(inputResponse.substr(comma + 1).c_str(), NULL, 10);
+        }
+        return false;
+    }
+
     // Response to a request for cell tower information
     if (strcmp(inputResponse.substr(0,5).c_str(), "+CNCI") == 0)
     {
@@ -1,4 +1,4 @@
-#include "Uart.h"
+#include "ISerial.h"
 #include <string>
 #include <deque>
 #include <queue>
@@ -29,7 +29,7 @@ class CellDriver
 	*/
 
     // Sets up this cell driver to communicate with the physical cellular module through the given serial/uart device.
-    CellDriver(Uart* uart);
+    CellDriver(ISerial* uart);
     
     // Does incremental work on sending or receiving text messages.
     // This function should be called periodically.
@@ -43,6 +43,13 @@ class CellDriver
     //Sends command to delete the given text message from the module's internal memory
     void deleteMessage(TextMessage textMessage);
 
+    // Whether the module last said it is registered on a network, at home or roaming.
+    // This is asked for along with the text messages, every 10 seconds.
+    bool isRegistered() const;
+
+    // The registration status the module last gave (+CREG: n,status), -1 until it has
+    int8_t getRegistrationStatus() const;
+
     // Pops a text message from the internal queue and returns it.
     // If there are no messages to return, it returns a TextMessage with all "" fields
     TextMessage getTextMessage();
@@ -53,7 +60,7 @@ class CellDriver
 
     private:
     
-    Uart* uart;
+    ISerial* uart;
 
     //bool hasConfirmedAT;
     bool checkingForNewMessage;
@@ -77,6 +84,9 @@ class CellDriver
     std::deque<std::string> commandQueue;
     std::queue<TextMessage> messageQueue;
 
+    // Last +CREG status, -1 if there has been none
+    int8_t registrationStatus;
+
     std::string responseBuffer;
     std::string towerInfoList;
     int totalTowersToReceive;
@@ -96,6 +106,11 @@ class CellDriver
     //Sends command to retrieve all messages from cell shield; returns "ok" if there are no
     //messages to the commandQueue
     void retrieveTextMessages();
+
+    //Sends the command to ask whether the module is registered on a network
+    //Response format
+    //+CREG: n,status where status 1 is home and 5 is roaming
+    void queueRegistrationCheck();
     
 	
 };
@@ -0,0 +1,220 @@
+#include "GpioLineGroup.h"
+#include "HardwarePath.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <sstream>
+
+GpioLineGroup::GpioLineGroup(const int32_t* gpioNumbers, int count, uint32_t initialValues)
+{
+    values = initialValues;
+    isInitialized = false;
+    if (count < 1 || count > GPIO_GROUP_MAX_LINES)
+    {
+        return;
+    }
+    this->gpioNumbers.assign(gpioNumbers, gpioNumbers + count);
+    valueFiles.assign(count, -1);
+
+    // One request for each chip that any of the lines are on
+    std::vector<bool> isRequested(count, false);
+    for (int i = 0; i < count; i++)
+    {
+        if (isRequested[i])
+        {
+            continue;
+        }
+        ChipRequest request;
+        request.chipNumber = gpioNumbers[i] / GPIO_LINES_PER_CHIP;
+        for (int j = i; j < count; j++)
+        {
+            if (!isRequested[j] && gpioNumbers[j] / GPIO_LINES_PER_CHIP == request.chipNumber)
+            {
+                request.lines.push_back(j);
+                isRequested[j] = true;
+            }
+        }
+        request.handle = requestLines(request.chipNumber, request.lines, initialValues);
+        if (request.handle != -1)
+        {
+            requests.push_back(request);
+            continue;
+        }
+
+        for (size_t j = 0; j < request.lines.size(); j++)
+        {
+            int line = request.lines[j];
+            valueFiles[line] = openSysfsLine(gpioNumbers[line], (initialValues >> line) & 1);
+            if (valueFiles[line] == -1)
+            {
+                return;
+            }
+        }
+    }
+    isInitialized = true;
+}
+
+GpioLineGroup::~GpioLineGroup()
+{
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        close(requests[i].handle);
+    }
+    for (size_t i = 0; i < valueFiles.size(); i++)
+    {
+        if (valueFiles[i] != -1)
+        {
+            close(valueFiles[i]);
+        }
+    }
+}
+
+int GpioLineGroup::requestLines(int chipNumber, const std::vector<int>& lines, uint32_t initialValues)
+{
+    std::stringstream chipPath;
+    chipPath << "/dev/gpiochip" << chipNumber;
+    int chipFile = open(hardwarePath(chipPath.str().c_str()).c_str(), O_RDONLY | O_CLOEXEC);
+    if (chipFile == -1)
+    {
+        return -1;
+    }
+
+    struct gpiohandle_request request;
+    memset(&request, 0, sizeof(request));
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        request.lineoffsets[i] = gpioNumbers[lines[i]] % GPIO_LINES_PER_CHIP;
+        request.default_values[i] = (initialValues >> lines[i]) & 1;
+    }
+    request.lines = lines.size();
+    request.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    strncpy(request.consumer_label, "missionControl", sizeof(request.consumer_label) - 1);
+
+    int result = ioctl(chipFile, GPIO_GET_LINEHANDLE_IOCTL, &request);
+    // The line handle stays good once the chip is closed
+    close(chipFile);
+    if (result == -1)
+    {
+        perror("GpioLineGroup: requesting lines");
+        return -1;
+    }
+    return request.fd;
+}
+
+int GpioLineGroup::openSysfsLine(int32_t gpioNumber, int initialValue)
+{
+    std::stringstream convertOutput;
+    convertOutput << gpioNumber;
+    std::string numberString = convertOutput.str();
+
+    // Export the desired gpio
+    // We ignore individual errors, because each file is separate,
+    // so the value may still be settable if these individually have problems...
+    int exportFile = open(hardwarePath("/sys/class/gpio/export").c_str(), O_WRONLY);
+    if (exportFile != -1)
+    {
+        write(exportFile, numberString.c_str(), numberString.length());
+        close(exportFile);
+    }
+
+    convertOutput.str("");
+    convertOutput << "/sys/class/gpio/gpio" << gpioNumber << "/direction";
+    int directionFile = open(hardwarePath(convertOutput.str().c_str()).c_str(), O_WRONLY);
+    if (directionFile != -1)
+    {
+        // "low" and "high" make it an output without a glitch to the other value
+        const char* direction = initialValue ? "high" : "low";
+        write(directionFile, direction, strlen(direction));
+        close(directionFile);
+    }
+
+    convertOutput.str("");
+    convertOutput << "/sys/class/gpio/gpio" << gpioNumber << "/value";
+    int valueFile = open(hardwarePath(convertOutput.str().c_str()).c_str(), O_WRONLY | O_CLOEXEC);
+    if (valueFile == -1)
+    {
+        perror("GpioLineGroup: opening sysfs value");
+        return -1;
+    }
+    pwrite(valueFile, initialValue ? "1" : "0", 1, 0);
+    return valueFile;
+}
+
+bool GpioLineGroup::isReady() const
+{
+    return isInitialized;
+}
+
+bool GpioLineGroup::isUsingCharacterDevice() const
+{
+    for (size_t i = 0; i < valueFiles.size(); i++)
+    {
+        if (valueFiles[i] != -1)
+        {
+            return false;
+        }
+    }
+    return isInitialized;
+}
+
+int GpioLineGroup::getCount() const
+{
+    return gpioNumbers.size();
+}
+
+int GpioLineGroup::setValues(uint32_t values)
+{
+    if (!isInitialized)
+    {
+        return -1;
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        struct gpiohandle_data data;
+        memset(&data, 0, sizeof(data));
+        for (size_t j = 0; j < requests[i].lines.size(); j++)
+        {
+            data.values[j] = (values >> requests[i].lines[j]) & 1;
+        }
+        if (ioctl(requests[i].handle, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) == -1)
+        {
+            result = -1;
+        }
+    }
+
+    // Only the sysfs lines that change are written, each is a system call of its own
+    for (size_t i = 0; i < valueFiles.size(); i++)
+    {
+        uint32_t bit = 1U << i;
+        if (valueFiles[i] != -1 && (values & bit) != (this->values & bit))
+        {
+            if (pwrite(valueFiles[i], (values & bit) ? "1" : "0", 1, 0) != 1)
+            {
+                result = -1;
+            }
+        }
+    }
+
+    this->values = values;
+    return result;
+}
+
+int GpioLineGroup::setValue(int line, int value)
+{
+    if (line < 0 || line >= (int)gpioNumbers.size())
+    {
+        return -1;
+    }
+    uint32_t bit = 1U << line;
+    return setValues(value ? (values | bit) : (values & ~bit));
+}
+
+uint32_t GpioLineGroup::getValues() const
+{
+    return values;
+}
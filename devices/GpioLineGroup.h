@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include <vector>
+
+#ifndef GPIO_LINE_GROUP
+#define GPIO_LINE_GROUP
+
+// Most lines a group can have, one bit of the values each
+#define GPIO_GROUP_MAX_LINES 32
+
+// Lines to a gpio chip, the kernel numbers gpio N as line N % 32 of gpiochip N / 32
+#define GPIO_LINES_PER_CHIP 32
+
+// A set of gpio pins used as outputs, all set together.
+//
+// The lines are requested from the gpio character devices (/dev/gpiochipN) once,
+// and the handles are kept open. Setting the lines is then a single ioctl for each
+// chip the lines are on, rather than an open, write and close of a sysfs file for
+// every pin. Lines on a chip that has no character device (older kernels, or the
+// simulated hardware) fall back to sysfs, with each value file kept open.
+class GpioLineGroup
+{
+    public:
+
+    /*
+    Make use of int32_t, int16_t, int8_t (32-bits, 16-bits, or 8-bits)
+    instead of int, short, or char.
+    This will ensure that the length of the integer is always the same on different platforms.
+    */
+
+    // Requests the given gpio numbers as outputs, set to bit i of initialValues for gpio i.
+    // If any line cannot be had either way, isReady() will return false.
+    GpioLineGroup(const int32_t* gpioNumbers, int count, uint32_t initialValues = 0);
+    ~GpioLineGroup();
+
+    bool isReady() const;
+
+    // Whether every line is set through a character device, rather than sysfs
+    bool isUsingCharacterDevice() const;
+
+    int getCount() const;
+
+    // Sets every line at once, bit i for line i. Returns -1 on error. 0 otherwise.
+    int setValues(uint32_t values);
+
+    // Sets a single line to either 0 or 1 (everything else besides 0), leaving the others alone.
+    // Returns -1 on error. 0 otherwise.
+    int setValue(int line, int value);
+
+    // The values last set, bit i for line i
+    uint32_t getValues() const;
+
+    private:
+
+    // A handle to lines of one chip, and which of our lines they are, in the handle's order
+    typedef struct
+    {
+        int chipNumber;
+        int handle;
+        std::vector<int> lines;
+    } ChipRequest;
+
+    // Requests the lines of one chip from its character device. Returns the handle, or -1.
+    int requestLines(int chipNumber, const std::vector<int>& lines, uint32_t initialValues);
+
+    // Exports and opens the sysfs value file of one line. Returns the file, or -1.
+    int openSysfsLine(int32_t gpioNumber, int initialValue);
+
+    // Not copyable, we own the handles
+    GpioLineGroup(const GpioLineGroup&);
+    GpioLineGroup& operator=(const GpioLineGroup&);
+
+    std::vector<int32_t> gpioNumbers;
+    std::vector<ChipRequest> requests;
+
+    // Value file of each line that is set through sysfs, -1 for the others
+    std::vector<int> valueFiles;
+
+    uint32_t values;
+
+    // Whether every line was had, value returned by isReady
+    bool isInitialized;
+};
+
+#endif
@@ -1,9 +1,9 @@
-#include <string>
+#include "GpioLineGroup.h"
 
 #ifndef GPIO_OUTPUT
 #define GPIO_OUTPUT
 
-// Takes measurements from a physical temperature sensor device.
+// A single gpio pin used as an output.
 class GpioOutput
 {
     public:
@@ -14,7 +14,7 @@ class GpioOutput
     This will ensure that the length of the integer is always the same on different platforms.
     */
     
-    // Set up the given gpio number pin for writing.
+    // Set up the given gpio number pin for writing, starting low.
     GpioOutput(int gpioNumber);
     
     // Set the value of the gpio pin to either 0 or 1 (everything else besides 0).
@@ -23,7 +23,11 @@ class GpioOutput
 
     private:
 
-    std::string gpioFileName;
+    // Must come before line, which is made from it
+    int32_t gpioNumber;
+
+    // The pin is a group of one, so it keeps its handle open the same way
+    GpioLineGroup line;
 
 };
 
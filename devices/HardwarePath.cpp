@@ -0,0 +1,25 @@
+#include "HardwarePath.h"
+#include <stdlib.h>
+
+// The prefix, taken from the environment the first time it is needed unless one was set.
+// It is kept in a function so that it is ready for devices made during static initialization.
+static std::string& prefix()
+{
+    static std::string value = getenv(HARDWARE_PREFIX_VARIABLE) ? getenv(HARDWARE_PREFIX_VARIABLE) : "";
+    return value;
+}
+
+void setHardwarePrefix(const char* prefix)
+{
+    ::prefix() = prefix ? prefix : "";
+}
+
+bool isHardwareSimulated()
+{
+    return !prefix().empty();
+}
+
+std::string hardwarePath(const char* path)
+{
+    return prefix() + path;
+}
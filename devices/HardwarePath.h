@@ -0,0 +1,33 @@
+#include <string>
+
+#ifndef HARDWARE_PATH
+#define HARDWARE_PATH
+
+// The environment variable that puts every hardware path under a directory
+#define HARDWARE_PREFIX_VARIABLE "MISSION_HW_PREFIX"
+
+// The simulator's stand-in for the spi device is a plain file holding
+// the 10-bit conversion of each MCP3008 channel as a uint16_t, channel 0 first.
+#define SIMULATED_ADC_CHANNELS 8
+
+// The simulator's stand-in for an i2c bus, /dev/i2c-N, is a plain file holding what
+// a read of the one device on it gives, from the start. Writes to it go nowhere.
+
+// The simulator's stand-in for /dev/pwm_in is a plain file holding the
+// latest pulse width in microseconds of each gpio as a uint32_t, gpio 0 first.
+// A width of 0 means there has not been a pulse.
+#define SIMULATED_PWM_GPIOS 128
+
+// Sets the directory that the device classes find the hardware's device and sysfs files under.
+// NULL or "" uses the real files. When not set, it is taken from the MISSION_HW_PREFIX
+// environment variable, which is how the hardware simulator is normally used.
+void setHardwarePrefix(const char* prefix);
+
+// Whether there is a prefix, and so the files are the simulator's stand-ins.
+// The stand-ins are plain files that do not take ioctls.
+bool isHardwareSimulated();
+
+// The given absolute path, under the prefix if there is one
+std::string hardwarePath(const char* path);
+
+#endif
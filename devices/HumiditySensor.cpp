@@ -1,16 +1,118 @@
 #include "HumiditySensor.h"
+#include <stddef.h>
+#include <time.h>
 
-HumiditySensor::HumiditySensor()
+// The top two bits of a HIH6130 measurement: a new measurement, one already read, or neither
+#define HIH6130_STATUS_VALID 0
+#define HIH6130_STATUS_STALE 1
+// Humidity and temperature are 14 bits, over 0 to 100% and -40 to 125 celsius
+#define HIH6130_FULL_SCALE 16382
+
+HumiditySensor::HumiditySensor(ADCSensor3008* adc, const CalibrationTable* calibration)
 {
-    
+    this->adc = adc;
+    this->calibration = calibration;
+    this->device = NULL;
+    this->isMeasuring = false;
+    this->measurementStartMs = 0;
+    this->lastRelativeHumidity = INT32_MIN;
+    this->lastTemperature = INT32_MIN;
+}
+
+HumiditySensor::HumiditySensor(II2cDevice* device)
+{
+    this->adc = NULL;
+    this->calibration = NULL;
+    this->device = device;
+    this->isMeasuring = false;
+    this->measurementStartMs = 0;
+    this->lastRelativeHumidity = INT32_MIN;
+    this->lastTemperature = INT32_MIN;
 }
 
 int32_t HumiditySensor::getRelativeHumidity() const
 {
-    
+    return lastRelativeHumidity;
+}
+
+int32_t HumiditySensor::getTemperature() const
+{
+    return lastTemperature;
 }
 
 int32_t HumiditySensor::readRelativeHumidity()
 {
-    
-}
\ No newline at end of file
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return readRelativeHumidity((uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+int32_t HumiditySensor::readRelativeHumidity(uint64_t nowMs)
+{
+    if (device)
+    {
+        if (isMeasuring)
+        {
+            collectMeasurement(nowMs);
+        }
+        // Not measuring anymore, so one was collected or cut off, and the next is due
+        if (!isMeasuring)
+        {
+            startMeasurement(nowMs);
+        }
+        return lastRelativeHumidity;
+    }
+
+    int32_t humidity = calibration->convertValue(adc->readValue());
+    // A reading a little either side of the ends is noise or a calibration that is a little off
+    if (humidity != INT32_MIN)
+    {
+        humidity = (humidity < 0) ? 0 : ((humidity > 100000) ? 100000 : humidity);
+    }
+    lastRelativeHumidity = humidity;
+    return lastRelativeHumidity;
+}
+
+void HumiditySensor::startMeasurement(uint64_t nowMs)
+{
+    // A write of no bytes at all is the HIH6130's measurement request
+    if (device->writeBytes(NULL, 0) == -1)
+    {
+        lastRelativeHumidity = INT32_MIN;
+        lastTemperature = INT32_MIN;
+        return;
+    }
+    isMeasuring = true;
+    measurementStartMs = nowMs;
+}
+
+void HumiditySensor::collectMeasurement(uint64_t nowMs)
+{
+    uint64_t elapsedMs = nowMs - measurementStartMs;
+    if (elapsedMs < HIH6130_MEASUREMENT_MS)
+    {
+        return;
+    }
+
+    uint8_t data[4];
+    int status = (device->readBytes(data, sizeof(data)) == (int)sizeof(data)) ? (data[0] >> 6) : -1;
+    // Not done yet, but there is still time
+    if (status == HIH6130_STATUS_STALE && elapsedMs < HUMIDITY_CUTOFF_MS)
+    {
+        return;
+    }
+
+    isMeasuring = false;
+    if (status != HIH6130_STATUS_VALID)
+    {
+        lastRelativeHumidity = INT32_MIN;
+        lastTemperature = INT32_MIN;
+        return;
+    }
+    int32_t humidity = ((data[0] & 0x3F) << 8) | data[1];
+    int32_t temperature = (data[2] << 6) | (data[3] >> 2);
+    // Rounded to the nearest thousandth
+    lastRelativeHumidity = (humidity * 100000 + HIH6130_FULL_SCALE / 2) / HIH6130_FULL_SCALE;
+    lastRelativeHumidity = (lastRelativeHumidity > 100000) ? 100000 : lastRelativeHumidity;
+    lastTemperature = (int32_t)(((int64_t)temperature * 165000 + HIH6130_FULL_SCALE / 2) / HIH6130_FULL_SCALE) - 40000;
+}
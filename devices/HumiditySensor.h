@@ -1,9 +1,25 @@
 #include <stdint.h>
+#include "ADCSensor3008.h"
+#include "CalibrationTable.h"
+#include "II2cDevice.h"
 
 #ifndef HUMIDITY_SENSOR
 #define HUMIDITY_SENSOR
 
+// The HIH6130's i2c address, and how long it takes to measure (36.65ms at most)
+#define HIH6130_ADDRESS 0x27
+#define HIH6130_MEASUREMENT_MS 37
+// A measurement still not done this long after it was asked for is cut off
+#define HUMIDITY_CUTOFF_MS 100
+
 // Takes measurements from a physical humidity sensor device.
+// This is meant for either one with an analog output on an adc channel, such as the HIH-4030,
+// whose conversions the calibration table turns into relative humidity, or a HIH6130 on an i2c bus.
+//
+// Neither ever waits on the sensor. The analog sensor's reading is the adc's latest value.
+// The HIH6130 is asked to measure by one read of the humidity and the measurement collected by
+// a later one, once the sensor has had the time to make it. Each collection asks for the next
+// measurement, so reading every so often gives a humidity that is at most that old.
 class HumiditySensor
 {
     public:
@@ -14,26 +30,53 @@ class HumiditySensor
     This will ensure that the length of the integer is always the same on different platforms.
     */
     
-    // You will likely want to give this constructor parameters that distinguish this specific sensor
-    // from any other one.
-    HumiditySensor();
+    // Takes the adc sensor to use, and the table of its conversions' relative humidities
+    // (percent, decimal point fixed at the 1000s place), which it does not own.
+    HumiditySensor(ADCSensor3008* adc, const CalibrationTable* calibration);
+    
+    // Takes the HIH6130 to use, which it does not own.
+    HumiditySensor(II2cDevice* device);
     
     // Value returned has the decimal point fixed at the 1000s place.
     // Value is in percentage, so 100% would be 100 _to the left_ of the decimal point.
-    // Returns the last value read by the sensor.
+    // Returns the last value read by the sensor, INT32_MIN if there is none.
     int32_t getRelativeHumidity() const;
     
+    // Value returned has the decimal point fixed at the 1000s place.
+    // Value is in degrees celsius.
+    // The temperature the HIH6130 measured along with the last humidity, INT32_MIN if there is none
+    // or the sensor is an analog one.
+    int32_t getTemperature() const;
+    
     // Value returned has the decimal point fixed at the 1000s place.
     // Value is in percentage, so 100% would be 100 _to the left_ of the decimal point.
     // Queries the sensor to determine its current humidity.
     // If the query is taking too long, the query should be cut off,
     // and INT32_MIN returned.
+    // Whatever the calibration says, the humidity is kept within 0 to 100%.
+    // The HIH6130's humidity is that of the last measurement collected, INT32_MIN until the first is.
     int32_t readRelativeHumidity();
+    
+    // As readRelativeHumidity, with the time now in CLOCK_MONOTONIC milliseconds
+    int32_t readRelativeHumidity(uint64_t nowMs);
 
     private:
 
-    // Your code here
+    // Asks the HIH6130 for a measurement, which will be ready HIH6130_MEASUREMENT_MS from now
+    void startMeasurement(uint64_t nowMs);
+    // Collects the HIH6130's measurement if it is ready, or cuts it off if it is too late
+    void collectMeasurement(uint64_t nowMs);
 
+    ADCSensor3008* adc;
+    const CalibrationTable* calibration;
+    II2cDevice* device;
+    
+    // Whether the HIH6130 has been asked for a measurement not yet collected, and when
+    bool isMeasuring;
+    uint64_t measurementStartMs;
+    
+    int32_t lastRelativeHumidity;
+    int32_t lastTemperature;
 };
 
 #endif
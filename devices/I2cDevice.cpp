@@ -0,0 +1,68 @@
+#include "I2cDevice.h"
+#include "HardwarePath.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+I2cDevice::I2cDevice(int bus, int address)
+{
+    isSimulated = isHardwareSimulated();
+    isInitialized = false;
+
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/i2c-%d", bus);
+    handle = open(hardwarePath(path).c_str(), O_RDWR | O_CLOEXEC);
+    if (handle == -1)
+    {
+        perror("I2cDevice: opening the i2c bus");
+        return;
+    }
+    // The simulator's stand-in is a plain file, there is no address to take
+    if (!isSimulated && ioctl(handle, I2C_SLAVE, address) == -1)
+    {
+        perror("I2cDevice: setting the device address");
+        return;
+    }
+    isInitialized = true;
+}
+
+I2cDevice::~I2cDevice()
+{
+    if (handle != -1)
+    {
+        close(handle);
+    }
+}
+
+bool I2cDevice::isReady() const
+{
+    return isInitialized;
+}
+
+int I2cDevice::writeBytes(const uint8_t* data, int length)
+{
+    if (!isInitialized)
+    {
+        return -1;
+    }
+    if (isSimulated)
+    {
+        return length;
+    }
+    return write(handle, data, length);
+}
+
+int I2cDevice::readBytes(uint8_t* data, int length)
+{
+    if (!isInitialized)
+    {
+        return -1;
+    }
+    if (isSimulated)
+    {
+        return pread(handle, data, length, 0);
+    }
+    return read(handle, data, length);
+}
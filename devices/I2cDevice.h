@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include "II2cDevice.h"
+
+#ifndef I2C_DEVICE
+#define I2C_DEVICE
+
+// Talks to one device of an i2c bus through Linux's i2c-dev, /dev/i2c-N.
+// A transfer is a single read or write of the bus, which takes as long as the bytes do
+// at the bus's clock and never waits on the device.
+// When the hardware is simulated, reads come from the start of the simulator's stand-in file
+// and writes go nowhere.
+class I2cDevice : implements II2cDevice
+{
+    public:
+
+    // Opens /dev/i2c-<bus> to talk to the device at the 7-bit address.
+    // If it cannot be opened or the address taken, isReady() will return false.
+    I2cDevice(int bus, int address);
+
+    ~I2cDevice();
+
+    bool isReady() const;
+
+    int writeBytes(const uint8_t* data, int length);
+    int readBytes(uint8_t* data, int length);
+
+    private:
+
+    // Not copyable, we own the handle
+    I2cDevice(const I2cDevice&);
+    I2cDevice& operator=(const I2cDevice&);
+
+    int handle;
+    // Reading the simulator's stand-in rather than an i2c bus
+    bool isSimulated;
+
+    // Whether the bus was opened and the address taken, value returned by isReady
+    bool isInitialized;
+};
+
+#endif
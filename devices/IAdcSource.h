@@ -0,0 +1,33 @@
+#include <stdint.h>
+#include "CppInterfaces.h"
+
+#ifndef IADC_SOURCE_INTERFACE
+#define IADC_SOURCE_INTERFACE
+
+// Adc values carry this many bits below a count of the 10-bit conversion, so filtering can
+// give back more bits than a single conversion has
+#define ADC_FILTER_FRACTION_BITS 6
+
+// Somewhere the latest adc conversions can be had without touching the spi bus:
+// an ADCBank3008's raw conversions, or an AdcAcquisition's filtered ones.
+DeclareInterface(IAdcSource)
+    // The latest 10-bit conversion of a channel (0 to 7), -1 if there is none
+    virtual int32_t getConversion(int channel) const = 0;
+
+    // The latest value of a channel (0 to 7) with ADC_FILTER_FRACTION_BITS below the count,
+    // -1 if there is none. Raw conversions have nothing in those bits.
+    virtual int32_t getValue(int channel) const = 0;
+EndInterface
+
+// A value with ADC_FILTER_FRACTION_BITS rounded to a 10-bit conversion, -1 for -1
+inline int32_t adcValueToConversion(int32_t value)
+{
+    if (value < 0)
+    {
+        return -1;
+    }
+    value = (value + (1 << (ADC_FILTER_FRACTION_BITS - 1))) >> ADC_FILTER_FRACTION_BITS;
+    return (value > 1023) ? 1023 : value;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include <stdint.h>
+#include "CppInterfaces.h"
+
+#ifndef II2C_DEVICE_INTERFACE
+#define II2C_DEVICE_INTERFACE
+
+// A device at one address of an i2c bus, each transfer a whole i2c message to or from it.
+DeclareInterface(II2cDevice)
+    // Writes the bytes as one message. Some devices take a message of no bytes as a command.
+    // Returns how many were written, or -1 on error.
+    virtual int writeBytes(const uint8_t* data, int length) = 0;
+
+    // Reads the bytes as one message.
+    // Returns how many were read, or -1 on error.
+    virtual int readBytes(uint8_t* data, int length) = 0;
+EndInterface
+
+#endif
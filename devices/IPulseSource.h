@@ -0,0 +1,21 @@
+#include <stdint.h>
+#include "CppInterfaces.h"
+#include "pwm_in/pwm_in.h"
+
+#ifndef IPULSE_SOURCE_INTERFACE
+#define IPULSE_SOURCE_INTERFACE
+
+// Somewhere measured pwm pulses come from: the pwm_in driver, or a simulation of it.
+DeclareInterface(IPulseSource)
+    // Starts capturing the given gpio, returning its channel or -1 if it cannot be.
+    virtual int addGpio(int gpioNumber) = 0;
+
+    // Reads up to maxPulses measured pulses, in the order they were measured.
+    // Returns how many were read, 0 if there are none, or -1 on error.
+    virtual int readPulses(PwmInPulse* pulses, int maxPulses) = 0;
+
+    // Pulses dropped because they were not read before the fifo filled.
+    virtual uint64_t getDroppedPulses() = 0;
+EndInterface
+
+#endif
@@ -1,10 +1,37 @@
+#include <stdint.h>
+#include <string.h>
+#include <sstream>
 #include "CppInterfaces.h"
 
+#ifndef ISERIAL_INTERFACE
+#define ISERIAL_INTERFACE
+
 DeclareInterface(ISerial)
     // Writes a single byte to this serial byte stream.
-    virtual bool writeByte(int8_t value) = 0;
-    
+    virtual bool writeByte(uint8_t value) = 0;
+
     // Reads a single byte from this serial byte stream,
     // returning -1 if there is no further data available.
     virtual int32_t readByte() = 0;
-EndInterface
\ No newline at end of file
+
+    // Writes length bytes to this serial byte stream at once.
+    // Returns whether they were all written.
+    virtual bool writeBytes(const char* data, int32_t length) = 0;
+
+    // Write the given null terminated string.
+    void writeString(const char* str)
+    {
+        writeBytes(str, strlen(str));
+    }
+
+    template<class T>
+    inline ISerial& operator << (T val)
+    {
+        std::stringstream convertOutput;
+        convertOutput << val;
+        writeBytes(convertOutput.str().c_str(), convertOutput.str().length());
+        return *this;
+    }
+EndInterface
+
+#endif
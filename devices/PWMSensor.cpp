@@ -3,18 +3,35 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include "PWMSensor.h"
+#include "HardwarePath.h"
+#include "PwmInDevice.h"
+#include "SimulatedPulseSource.h"
 #include "pwm_in/pwm_in.h"
+#include <algorithm>
 
 PWMSensor::PWMSensor(int gpioNumber)
 {
     lastValue = INT32_MIN;
+    this->gpioNumber = gpioNumber;
+    source = NULL;
+    filterLength = 0;
+    filterCount = 0;
+    filterNext = 0;
+    jitterUs = 0;
+    lastPulseNs = 0;
     
-    pwmHandle = open("/dev/pwm_in", O_RDWR);
+    pwmHandle = open(hardwarePath("/dev/pwm_in").c_str(), O_RDWR);
     if (pwmHandle == -1)
     {
         perror("PWM Sensor: opening /dev/pwm_in");
         return;
     }
+    
+    // The simulator's stand-in holds every gpio's pulse width, there is nothing to configure
+    if (isHardwareSimulated())
+    {
+        return;
+    }
 
     // Configure it
     if (ioctl(pwmHandle, PWM_IN_SET_GPIO, gpioNumber))
@@ -26,6 +43,42 @@ PWMSensor::PWMSensor(int gpioNumber)
     }
 }
 
+PWMSensor::PWMSensor(int gpioNumber, int filterLength, int32_t jitterUs)
+{
+    lastValue = INT32_MIN;
+    this->gpioNumber = gpioNumber;
+    pwmHandle = -1;
+    this->filterLength = std::max(1, std::min(filterLength, PWM_SENSOR_MAX_FILTER_LENGTH));
+    filterCount = 0;
+    filterNext = 0;
+    this->jitterUs = jitterUs;
+    lastPulseNs = 0;
+    
+    if (isHardwareSimulated())
+    {
+        source = new SimulatedPulseSource();
+    }
+    else
+    {
+        source = new PwmInDevice();
+    }
+    if (source->addGpio(gpioNumber) != 0)
+    {
+        fprintf(stderr, "PWM Sensor: cannot stream gpio %d\n", gpioNumber);
+        delete source;
+        source = NULL;
+    }
+}
+
+PWMSensor::~PWMSensor()
+{
+    delete source;
+    if (pwmHandle != -1)
+    {
+        close(pwmHandle);
+    }
+}
+
 int32_t PWMSensor::getValue() const
 {
     return lastValue;
@@ -33,11 +86,85 @@ int32_t PWMSensor::getValue() const
 
 int32_t PWMSensor::readValue()
 {
-    long pulseWidthValue = ioctl(pwmHandle, PWM_IN_READ_PULSE_WIDTH);
-    if (pulseWidthValue == -1)
+    if (filterLength > 0)
     {
-        return INT32_MIN;
+        return readFilteredValue();
+    }
+    
+    long pulseWidthValue;
+    if (isHardwareSimulated())
+    {
+        uint32_t simulatedWidth;
+        if (gpioNumber < 0 || gpioNumber >= SIMULATED_PWM_GPIOS ||
+            pread(pwmHandle, &simulatedWidth, sizeof(simulatedWidth), gpioNumber * sizeof(simulatedWidth)) != sizeof(simulatedWidth) ||
+            simulatedWidth == 0)
+        {
+            return INT32_MIN;
+        }
+        pulseWidthValue = simulatedWidth;
+    }
+    else
+    {
+        pulseWidthValue = ioctl(pwmHandle, PWM_IN_READ_PULSE_WIDTH);
+        if (pulseWidthValue == -1)
+        {
+            return INT32_MIN;
+        }
     }
     lastValue = pulseWidthValue - 1500;
     return lastValue;
 }
+
+int32_t PWMSensor::readFilteredValue()
+{
+    if (!source)
+    {
+        return INT32_MIN;
+    }
+    
+    PwmInPulse pulses[PWM_IN_FIFO_SIZE];
+    int count = source->readPulses(pulses, PWM_IN_FIFO_SIZE);
+    if (count <= 0)
+    {
+        return INT32_MIN;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        filterWidths[filterNext] = pulses[i].widthNs / 1000;
+        filterNext = (filterNext + 1) % filterLength;
+        filterCount = std::min(filterCount + 1, filterLength);
+    }
+    lastPulseNs = pulses[count - 1].risingNs + pulses[count - 1].widthNs;
+    
+    int32_t sorted[PWM_SENSOR_MAX_FILTER_LENGTH];
+    std::copy(filterWidths, filterWidths + filterCount, sorted);
+    std::nth_element(sorted, sorted + filterCount / 2, sorted + filterCount);
+    int32_t median = sorted[filterCount / 2] - 1500;
+    
+    // Hold still through jitter smaller than the deadband
+    if (lastValue == INT32_MIN || median > lastValue + jitterUs || median < lastValue - jitterUs)
+    {
+        lastValue = median;
+    }
+    return lastValue;
+}
+
+int32_t PWMSensor::getJitter() const
+{
+    if (filterCount == 0)
+    {
+        return -1;
+    }
+    return *std::max_element(filterWidths, filterWidths + filterCount) -
+           *std::min_element(filterWidths, filterWidths + filterCount);
+}
+
+uint64_t PWMSensor::getPulseNs() const
+{
+    return lastPulseNs;
+}
+
+int PWMSensor::getGpio() const
+{
+    return gpioNumber;
+}
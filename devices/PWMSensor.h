@@ -1,9 +1,13 @@
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
+#include "IPulseSource.h"
 
 #ifndef PWM_SENSOR
 #define PWM_SENSOR
 
+// Most pulses the median filter can be taken over
+#define PWM_SENSOR_MAX_FILTER_LENGTH 15
+
 // Measures the duty-cycle of a 50hz PWM signal, as used with hobbyist servos and radio controls.
 // Reports this measurement as an angle in degrees as it would control a hobbyist servo.
 class PWMSensor
@@ -21,6 +25,13 @@ class PWMSensor
     // with choices and which gpios are being used for interrupts.
     PWMSensor(int gpioNumber);
     
+    // Opens up the pwm input on the given gpio as a stream of every pulse, rather than the latest.
+    // The value is then the median width of the last filterLength pulses, which rejects single
+    // glitched pulses, and it only moves once that median is more than jitterUs away from it.
+    PWMSensor(int gpioNumber, int filterLength, int32_t jitterUs);
+    
+    ~PWMSensor();
+    
     // Value returned has the decimal point fixed at the 1000s place.
     // Value is in the range of -1 to 1. (-1000 to 1000)
     // Where -1 corresponds to 500us pulse-width, and 1 to 2500us.
@@ -35,15 +46,46 @@ class PWMSensor
     // Values measured beyond this are saturated into that range.
     // Queries the sensor to read the pulse-width; if there is not a new reading
     // since the last time this was called, INT32_MIN is returned.
+    // When filtering, this takes every pulse measured since the last call.
     int32_t readValue();
+    
+    // When filtering, the microseconds between the widest and narrowest of the pulses
+    // being filtered. -1 if not filtering or there have not been any pulses.
+    int32_t getJitter() const;
+    
+    // When filtering, the monotonic nanoseconds the newest pulse taken fell,
+    // so when the value was last known to be current. 0 if not filtering or there have not been any pulses.
+    uint64_t getPulseNs() const;
+    
+    int getGpio() const;
 
     private:
+    
+    // Not copyable, we own the handle
+    PWMSensor(const PWMSensor&);
+    PWMSensor& operator=(const PWMSensor&);
+    
+    int32_t readFilteredValue();
 
     // File handle to the pwm input driver
     int pwmHandle;
     
+    // The gpio we measure, needed to find it in the simulator's stand-in
+    int gpioNumber;
+    
     // Value for getValue to return
     int32_t lastValue;
+    
+    // Where the pulses come from when filtering, NULL if not
+    IPulseSource* source;
+    
+    // The widths of the last filterLength pulses, in microseconds
+    int32_t filterWidths[PWM_SENSOR_MAX_FILTER_LENGTH];
+    int filterLength;
+    int filterCount;
+    int filterNext;
+    int32_t jitterUs;
+    uint64_t lastPulseNs;
 
 };
 
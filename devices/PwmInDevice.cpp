@@ -0,0 +1,69 @@
+#include "PwmInDevice.h"
+#include "HardwarePath.h"
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+PwmInDevice::PwmInDevice()
+{
+    // Pulses are read as the main loop comes round to them, never waited for
+    pwmHandle = open(hardwarePath("/dev/pwm_in").c_str(), O_RDWR | O_CLOEXEC | O_NONBLOCK);
+    if (pwmHandle == -1)
+    {
+        perror("PwmInDevice: opening /dev/pwm_in");
+    }
+}
+
+PwmInDevice::~PwmInDevice()
+{
+    if (pwmHandle != -1)
+    {
+        close(pwmHandle);
+    }
+}
+
+bool PwmInDevice::isReady() const
+{
+    return pwmHandle != -1;
+}
+
+int PwmInDevice::addGpio(int gpioNumber)
+{
+    if (pwmHandle == -1)
+    {
+        return -1;
+    }
+    int channel = ioctl(pwmHandle, PWM_IN_ADD_GPIO, gpioNumber);
+    if (channel < 0)
+    {
+        perror("PwmInDevice: adding gpio");
+        return -1;
+    }
+    return channel;
+}
+
+int PwmInDevice::readPulses(PwmInPulse* pulses, int maxPulses)
+{
+    if (pwmHandle == -1)
+    {
+        return -1;
+    }
+    ssize_t result = read(pwmHandle, pulses, maxPulses * sizeof(PwmInPulse));
+    if (result < 0)
+    {
+        return (errno == EAGAIN) ? 0 : -1;
+    }
+    return result / sizeof(PwmInPulse);
+}
+
+uint64_t PwmInDevice::getDroppedPulses()
+{
+    if (pwmHandle == -1)
+    {
+        return 0;
+    }
+    long dropped = ioctl(pwmHandle, PWM_IN_GET_DROPPED_PULSES);
+    return dropped < 0 ? 0 : dropped;
+}
@@ -0,0 +1,34 @@
+#include "IPulseSource.h"
+
+#ifndef PWM_IN_DEVICE
+#define PWM_IN_DEVICE
+
+// The pwm_in kernel driver, capturing several gpios with one open of /dev/pwm_in.
+class PwmInDevice : implements IPulseSource
+{
+    public:
+
+    // Opens the driver. If it cannot be, isReady() will return false.
+    PwmInDevice();
+    ~PwmInDevice();
+
+    bool isReady() const;
+
+    int addGpio(int gpioNumber);
+
+    // Every pulse that fits comes with a single read(2), which does not wait for them
+    int readPulses(PwmInPulse* pulses, int maxPulses);
+
+    uint64_t getDroppedPulses();
+
+    private:
+
+    // Not copyable, we own the handle
+    PwmInDevice(const PwmInDevice&);
+    PwmInDevice& operator=(const PwmInDevice&);
+
+    // File handle to the pwm input driver
+    int pwmHandle;
+};
+
+#endif
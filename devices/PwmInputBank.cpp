@@ -0,0 +1,136 @@
+#include "PwmInputBank.h"
+#include "PwmInDevice.h"
+#include "SimulatedPulseSource.h"
+#include "HardwarePath.h"
+#include <string.h>
+
+PwmInputBank::PwmInputBank(const int32_t* gpioNumbers, int count)
+{
+    if (isHardwareSimulated())
+    {
+        source = new SimulatedPulseSource();
+    }
+    else
+    {
+        source = new PwmInDevice();
+    }
+    addGpios(gpioNumbers, count);
+}
+
+PwmInputBank::PwmInputBank(IPulseSource* source, const int32_t* gpioNumbers, int count)
+{
+    this->source = source;
+    addGpios(gpioNumbers, count);
+}
+
+PwmInputBank::~PwmInputBank()
+{
+    delete source;
+}
+
+void PwmInputBank::addGpios(const int32_t* gpioNumbers, int count)
+{
+    pulseCount = 0;
+    isInitialized = count > 0 && count <= PWM_IN_MAX_CHANNELS;
+
+    PwmInPulse none;
+    memset(&none, 0, sizeof(none));
+    for (int i = 0; i < count && isInitialized; i++)
+    {
+        // The channels have to be the gpios' places in our list
+        if (source->addGpio(gpioNumbers[i]) != i)
+        {
+            isInitialized = false;
+            break;
+        }
+        this->gpioNumbers.push_back(gpioNumbers[i]);
+        latestPulses.push_back(none);
+    }
+}
+
+bool PwmInputBank::isReady() const
+{
+    return isInitialized;
+}
+
+int PwmInputBank::getCount() const
+{
+    return gpioNumbers.size();
+}
+
+int32_t PwmInputBank::getGpio(int channel) const
+{
+    if (channel < 0 || channel >= (int)gpioNumbers.size())
+    {
+        return -1;
+    }
+    return gpioNumbers[channel];
+}
+
+int PwmInputBank::update()
+{
+    pulseCount = 0;
+    if (!isInitialized)
+    {
+        return -1;
+    }
+
+    int result = source->readPulses(pulses, PWM_INPUT_BANK_MAX_PULSES);
+    if (result < 0)
+    {
+        return -1;
+    }
+    pulseCount = result;
+
+    for (int i = 0; i < pulseCount; i++)
+    {
+        if (pulses[i].channel < latestPulses.size())
+        {
+            latestPulses[pulses[i].channel] = pulses[i];
+        }
+    }
+    return pulseCount;
+}
+
+const PwmInPulse* PwmInputBank::getPulses() const
+{
+    return pulses;
+}
+
+int PwmInputBank::getPulseCount() const
+{
+    return pulseCount;
+}
+
+uint32_t PwmInputBank::getWidth(int channel) const
+{
+    if (channel < 0 || channel >= (int)latestPulses.size())
+    {
+        return 0;
+    }
+    return latestPulses[channel].widthNs / 1000;
+}
+
+int32_t PwmInputBank::getValue(int channel) const
+{
+    uint32_t width = getWidth(channel);
+    if (width == 0)
+    {
+        return INT32_MIN;
+    }
+    return (int32_t)width - 1500;
+}
+
+uint64_t PwmInputBank::getRisingNs(int channel) const
+{
+    if (channel < 0 || channel >= (int)latestPulses.size())
+    {
+        return 0;
+    }
+    return latestPulses[channel].risingNs;
+}
+
+uint64_t PwmInputBank::getDroppedPulses() const
+{
+    return source->getDroppedPulses();
+}
@@ -0,0 +1,83 @@
+#define __STDC_LIMIT_MACROS
+#include <stdint.h>
+#include <vector>
+#include "IPulseSource.h"
+
+#ifndef PWM_INPUT_BANK
+#define PWM_INPUT_BANK
+
+// Most pulses a single update takes, the driver's whole fifo
+#define PWM_INPUT_BANK_MAX_PULSES PWM_IN_FIFO_SIZE
+
+// Measures the pulses of several 50hz PWM signals at once, as used with hobbyist servos and radio controls.
+//
+// Each update takes every pulse measured since the last one with a single read,
+// rather than a system call for each input. Those pulses are kept until the next update,
+// and the latest of each channel is kept until a newer one comes.
+class PwmInputBank
+{
+    public:
+
+    /*
+    Make use of int32_t, int16_t, int8_t (32-bits, 16-bits, or 8-bits)
+    instead of int, short, or char.
+    This will ensure that the length of the integer is always the same on different platforms.
+    */
+
+    // Captures the given gpios, channel i on gpio i, with the pwm_in driver,
+    // or with a SimulatedPulseSource when the hardware is simulated.
+    // If the source or any gpio cannot be had, isReady() will return false.
+    PwmInputBank(const int32_t* gpioNumbers, int count);
+
+    // Captures the given gpios from the given source, which the bank then owns.
+    PwmInputBank(IPulseSource* source, const int32_t* gpioNumbers, int count);
+
+    ~PwmInputBank();
+
+    bool isReady() const;
+
+    int getCount() const;
+
+    int32_t getGpio(int channel) const;
+
+    // Takes every pulse measured since the last update. Returns how many there were, or -1 on error.
+    int update();
+
+    // The pulses taken by the last update, in the order they were measured
+    const PwmInPulse* getPulses() const;
+    int getPulseCount() const;
+
+    // The latest pulse width of a channel in microseconds, 0 if there has been none
+    uint32_t getWidth(int channel) const;
+
+    // The latest pulse width of a channel with the decimal point fixed at the 1000s place,
+    // as PWMSensor gives it: 1500us is 0, and each microsecond more or less is 1.
+    // INT32_MIN if there has been no pulse.
+    int32_t getValue(int channel) const;
+
+    // When the latest pulse of a channel rose, in monotonic nanoseconds
+    uint64_t getRisingNs(int channel) const;
+
+    uint64_t getDroppedPulses() const;
+
+    private:
+
+    void addGpios(const int32_t* gpioNumbers, int count);
+
+    // Not copyable, we own the source
+    PwmInputBank(const PwmInputBank&);
+    PwmInputBank& operator=(const PwmInputBank&);
+
+    IPulseSource* source;
+
+    std::vector<int32_t> gpioNumbers;
+    std::vector<PwmInPulse> latestPulses;
+
+    PwmInPulse pulses[PWM_INPUT_BANK_MAX_PULSES];
+    int pulseCount;
+
+    // Whether every gpio was added, value returned by isReady
+    bool isInitialized;
+};
+
+#endif
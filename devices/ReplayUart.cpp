@@ -0,0 +1,138 @@
+#define __STDC_LIMIT_MACROS
+#include "ReplayUart.h"
+#include "../recorder/FlightLog.h"
+#include <stdio.h>
+#include <time.h>
+#include <glob.h>
+#include <string>
+
+ReplayClock::ReplayClock(double speed)
+{
+    this->speed = speed;
+    captureStart = UINT64_MAX;
+    replayStart = 0;
+    hasStarted = false;
+}
+
+void ReplayClock::includeCapture(uint64_t firstTimestamp)
+{
+    if (firstTimestamp < captureStart)
+    {
+        captureStart = firstTimestamp;
+    }
+}
+
+uint64_t ReplayClock::now()
+{
+    if (speed <= 0)
+    {
+        return UINT64_MAX;
+    }
+
+    struct timespec monotonicNow;
+    clock_gettime(CLOCK_MONOTONIC, &monotonicNow);
+    uint64_t time = (uint64_t)monotonicNow.tv_sec * 1000000000ULL + monotonicNow.tv_nsec;
+    if (!hasStarted)
+    {
+        replayStart = time;
+        hasStarted = true;
+    }
+    return captureStart + (uint64_t)((time - replayStart) * speed);
+}
+
+ReplayUart::ReplayUart(const char* pathPrefix, int uartNumber, ReplayClock* clock)
+{
+    this->clock = clock;
+    nextByte = 0;
+    dueEnd = 0;
+    nextChunk = 0;
+    bytesWritten = 0;
+    isInitialized = false;
+
+    // Segment numbers are zero padded, so the sorted names are in recording order
+    std::string pattern = std::string(pathPrefix) + "-*.flog";
+    glob_t segments;
+    if (glob(pattern.c_str(), 0, NULL, &segments) != 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < segments.gl_pathc; i++)
+    {
+        FlightLogReader reader(segments.gl_pathv[i]);
+        if (!reader.isReady())
+        {
+            continue;
+        }
+        isInitialized = true;
+
+        FlightRecordView record;
+        while (reader.next(&record))
+        {
+            if (record.header->type == FLIGHT_RECORD_SERIAL_RX && record.header->source == uartNumber)
+            {
+                bytes.insert(bytes.end(), record.payload, record.payload + record.header->length);
+                ReplayChunk chunk;
+                chunk.timestamp = record.header->timestamp;
+                chunk.end = bytes.size();
+                chunks.push_back(chunk);
+            }
+        }
+    }
+    globfree(&segments);
+
+    if (!chunks.empty())
+    {
+        clock->includeCapture(chunks[0].timestamp);
+    }
+}
+
+bool ReplayUart::isReady() const
+{
+    return isInitialized;
+}
+
+int32_t ReplayUart::readByte()
+{
+    // Only look at the clock once the due bytes have all been handed out
+    if (nextByte >= dueEnd)
+    {
+        if (nextChunk >= chunks.size())
+        {
+            return -1;
+        }
+        uint64_t now = clock->now();
+        while (nextChunk < chunks.size() && chunks[nextChunk].timestamp <= now)
+        {
+            dueEnd = chunks[nextChunk].end;
+            nextChunk++;
+        }
+        if (nextByte >= dueEnd)
+        {
+            return -1;
+        }
+    }
+    return bytes[nextByte++];
+}
+
+bool ReplayUart::writeByte(uint8_t value)
+{
+    bytesWritten++;
+    return true;
+}
+
+bool ReplayUart::writeBytes(const char* data, int32_t length)
+{
+    bytesWritten += length;
+    return true;
+}
+
+bool ReplayUart::isFinished() const
+{
+    return nextByte >= bytes.size();
+}
+
+uint64_t ReplayUart::getBytesWritten() const
+{
+    return bytesWritten;
+}
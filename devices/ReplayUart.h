@@ -0,0 +1,94 @@
+#include <stdint.h>
+#include <vector>
+#include "ISerial.h"
+#ifndef REPLAY_UART
+#define REPLAY_UART
+
+// Time base shared by every ReplayUart of one replay, so that the uarts stay in step.
+// The capture's time is mapped onto the monotonic clock, scaled by the speed.
+class ReplayClock
+{
+    public:
+
+    // A speed of 1 plays back at recorded speed, 2 twice as fast and so on.
+    // A speed of 0 (or less) hands out everything as soon as it is read.
+    ReplayClock(double speed);
+
+    // Makes playback begin no later than the given capture time.
+    // Every ReplayUart tells us about its first chunk.
+    void includeCapture(uint64_t firstTimestamp);
+
+    // The capture time that playback has reached.
+    // Playback starts with the first call.
+    uint64_t now();
+
+    private:
+
+    double speed;
+
+    // Capture time that playback begins at
+    uint64_t captureStart;
+
+    // Monotonic time that playback began, once it has
+    uint64_t replayStart;
+    bool hasStarted;
+};
+
+// A serial device that gives back what a uart received, as captured by the
+// flight recorder (either a per-port capture or a whole flight log).
+// Bytes become readable once the replay clock reaches the time they were received.
+// Whatever is written is thrown away, as there is nothing on the other end.
+class ReplayUart : implements ISerial
+{
+    public:
+
+    // Loads everything uart number uartNumber received from the segments <pathPrefix>-NNNN.flog.
+    // If there are no segments, isReady() will return false and nothing is ever read.
+    ReplayUart(const char* pathPrefix, int uartNumber, ReplayClock* clock);
+
+    bool isReady() const;
+
+    // Reads a single byte or -1 if none are due yet.
+    int32_t readByte();
+
+    // Discards the byte, only counting it
+    bool writeByte(uint8_t value);
+
+    // Discards the bytes, only counting them
+    bool writeBytes(const char* data, int32_t length);
+
+    // Whether every captured byte has been read
+    bool isFinished() const;
+
+    // How many bytes were written to us and thrown away
+    uint64_t getBytesWritten() const;
+
+    private:
+
+    typedef struct
+    {
+        // When the chunk was received
+        uint64_t timestamp;
+        // Offset in bytes just past the chunk
+        uint64_t end;
+    } ReplayChunk;
+
+    ReplayClock* clock;
+
+    // Everything received, end to end, and where each chunk of it ends
+    std::vector<uint8_t> bytes;
+    std::vector<ReplayChunk> chunks;
+
+    // Next byte readByte gives out, and the end of the bytes that are due
+    uint64_t nextByte;
+    uint64_t dueEnd;
+    // Next chunk that is not yet due
+    size_t nextChunk;
+
+    uint64_t bytesWritten;
+
+    // Whether any segments were found, value returned by isReady
+    bool isInitialized;
+};
+
+#endif
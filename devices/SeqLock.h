@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+#ifndef SEQ_LOCK
+#define SEQ_LOCK
+
+// Publishes a plain struct from one writer to any number of readers, without either ever
+// waiting on the other. The sequence is odd while the struct is being written, so a reader
+// that sees it odd, or changed by the time it has copied the struct, copies it again.
+//
+// The struct is kept as atomic words, so readers racing the writer only see torn copies,
+// which they throw away, and never undefined behaviour.
+template <typename T>
+class SeqLock
+{
+    public:
+
+    SeqLock()
+    {
+        sequence = 0;
+        for (int i = 0; i < WORDS; i++)
+        {
+            words[i] = 0;
+        }
+    }
+
+    // Only one thread can write at a time, the caller sees to that
+    void write(const T& value)
+    {
+        uint32_t copy[WORDS];
+        memcpy(copy, &value, sizeof(T));
+
+        // Odd while writing, and the fences keep the writes inside it
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < WORDS; i++)
+        {
+            words[i].store(copy[i], std::memory_order_relaxed);
+        }
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // The latest value written, all of it from the same write
+    void read(T* value) const
+    {
+        uint32_t copy[WORDS];
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            for (int i = 0; i < WORDS; i++)
+            {
+                copy[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        memcpy(value, copy, sizeof(T));
+    }
+
+    private:
+
+    static const int WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORDS];
+};
+
+#endif
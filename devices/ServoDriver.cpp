@@ -1,82 +1,176 @@
 #include "ServoDriver.h"
+#include <string.h>
 
-ServoDriver::ServoDriver(Uart* uart)
+ServoDriver::ServoDriver(ISerial* uart)
 {
-    this->uart = uart;   
+    this->uart = uart;
+    isBatching = false;
+    batchLength = 0;
+    batchedAngles = 0;
+    batchedSpeeds = 0;
+    forgetState();
 }
 
 bool ServoDriver::setAngle(int8_t servoNumber, int16_t degrees)
 {
-    if (servoNumber > 8 || servoNumber < 1)
+    if (servoNumber > SERVO_COUNT || servoNumber < 1)
     {
         return false;
     }
 
-    int16_t position = (degrees < 0) ? 0 : ((degrees > 5000) ? 5000 : degrees);
-    position += 500;
-    //Calculate data bytes from position
-    int8_t data2 = position & 127;
-    int8_t data1 = position >> 7;
-
-    //Start Byte
-    uart->writeByte(0x80);
-
-    //Device ID - Device ID number 0x01 for 8-Servo Controller
-    uart->writeByte(0x01);
-
-    //Command: 0x04 is set position mode
-    uart->writeByte(0x04);
-
-    //Servo Number
-    uart->writeByte(servoNumber);
-    
-    //First Data Byte
-    uart->writeByte(data1);
+    int16_t angle = (degrees < 0) ? 0 : ((degrees > 5000) ? 5000 : degrees);
+    // Already there, nothing to say
+    if (angles[servoNumber - 1] == angle)
+    {
+        return true;
+    }
 
-    //Second Data Byte
-    uart->writeByte(data2);
-    
-    //It might be useful to store the last servo positions in the class    
-    
+    int16_t position = angle + 500;
+    uint8_t command[SERVO_COMMAND_BYTES] =
+    {
+        //Start Byte
+        0x80,
+        //Device ID - Device ID number 0x01 for 8-Servo Controller
+        0x01,
+        //Command: 0x04 is set position mode
+        0x04,
+        //Servo Number
+        (uint8_t)servoNumber,
+        //Data bytes from position, 7 bits each
+        (uint8_t)(position >> 7),
+        (uint8_t)(position & 127)
+    };
+
+    if (!writeCommand(command, sizeof(command)))
+    {
+        angles[servoNumber - 1] = -1;
+        return false;
+    }
+    angles[servoNumber - 1] = angle;
+    if (isBatching)
+    {
+        batchedAngles |= 1U << (servoNumber - 1);
+    }
     return true;
 }
 
-int16_t ServoDriver::getAngle(int8_t servoNumber) 
+int16_t ServoDriver::getAngle(int8_t servoNumber)
 {
- //To be written if we stor the positions in the class   
+    if (servoNumber < 1 || servoNumber > SERVO_COUNT)
+    {
+        return -1;
+    }
+    return angles[servoNumber - 1];
 }
 
 bool ServoDriver::setSpeed(int8_t servoNumber, int16_t speed)
 {
-    if (servoNumber < 1 || servoNumber > 8)
+    if (servoNumber < 1 || servoNumber > SERVO_COUNT)
     {
         return false;
     }
 
     int8_t data3 = (speed < 0) ? 0 : ((speed > 127) ? 127 : speed);
-    
-    //Start Byte
-    uart->writeByte(0x80);
+    if (speeds[servoNumber - 1] == data3)
+    {
+        return true;
+    }
 
-    //Device ID - Device ID number 0x01 for 8-Servo Controller
-    uart->writeByte(0x01);
+    uint8_t command[] =
+    {
+        //Start Byte
+        0x80,
+        //Device ID - Device ID number 0x01 for 8-Servo Controller
+        0x01,
+        //Command: 0x01 is set speed mode
+        0x01,
+        //Servo Number
+        (uint8_t)servoNumber,
+        //Pass the speed data
+        (uint8_t)data3
+    };
+
+    if (!writeCommand(command, sizeof(command)))
+    {
+        speeds[servoNumber - 1] = -1;
+        return false;
+    }
+    speeds[servoNumber - 1] = data3;
+    if (isBatching)
+    {
+        batchedSpeeds |= 1U << (servoNumber - 1);
+    }
+    return true;
+}
 
-    //Command: 0x01 is set speed mode
-    uart->writeByte(0x01);
+int8_t ServoDriver::getSpeed(int8_t servoNumber)
+{
+    if (servoNumber < 1 || servoNumber > SERVO_COUNT)
+    {
+        return -1;
+    }
+    return speeds[servoNumber - 1];
+}
+
+void ServoDriver::beginBatch()
+{
+    isBatching = true;
+}
 
-    //Servo Number
-    uart->writeByte(servoNumber);
+bool ServoDriver::flushBatch()
+{
+    isBatching = false;
+    if (batchLength == 0)
+    {
+        return true;
+    }
 
-    //Pass the speed data
-    uart->writeByte(data3);
-    
-    return true;
+    bool isWritten = uart->writeBytes(batch, batchLength);
+    if (!isWritten)
+    {
+        // Who knows where those servos are now
+        for (int i = 0; i < SERVO_COUNT; i++)
+        {
+            if (batchedAngles & (1U << i))
+            {
+                angles[i] = -1;
+            }
+            if (batchedSpeeds & (1U << i))
+            {
+                speeds[i] = -1;
+            }
+        }
+    }
+    batchLength = 0;
+    batchedAngles = 0;
+    batchedSpeeds = 0;
+    return isWritten;
 }
 
-int8_t getSpeed(int8_t servoNumber)
+void ServoDriver::forgetState()
 {
-    
-//Only possible if store the values in the class and return them
+    for (int i = 0; i < SERVO_COUNT; i++)
+    {
+        angles[i] = -1;
+        speeds[i] = -1;
+    }
 }
 
+bool ServoDriver::writeCommand(const uint8_t* command, int32_t length)
+{
+    if (!isBatching)
+    {
+        return uart->writeBytes((const char*)command, length);
+    }
 
+    // A servo set over and over in one batch can fill it, then what is there goes now
+    if (batchLength + length > SERVO_BATCH_BYTES && !flushBatch())
+    {
+        isBatching = true;
+        return false;
+    }
+    isBatching = true;
+    memcpy(batch + batchLength, command, length);
+    batchLength += length;
+    return true;
+}
@@ -1,42 +1,81 @@
 #include <stdint.h>
-#include "Uart.h"
+#include "ISerial.h"
 
 #ifndef SERVO_DRIVER
 #define SERVO_DRIVER
 
-// Controls a single servo motor (of the hobbyist PWM type)
+// How many servos the controller has, numbered from 1
+#define SERVO_COUNT 8
+
+// Longest command, start byte, device, command, servo and two data bytes
+#define SERVO_COMMAND_BYTES 6
+
+// Room for a position and a speed command for every servo, so a whole update is one write
+#define SERVO_BATCH_BYTES (SERVO_COUNT * 2 * SERVO_COMMAND_BYTES)
+
+// Controls the servo motors (of the hobbyist PWM type) on an 8-servo controller
+//
+// Each command is built whole and written with a single write, rather than a byte at a time.
+// What each servo was last set to is kept, so it can be read back and so that setting
+// a servo to what it already is writes nothing.
+// Between beginBatch and flushBatch, commands for any number of servos are gathered and
+// then written all at once.
 class ServoDriver
 {
 	public:
 
 	// Sets up the servo driver to communicate with the physical servo controller module
-	ServoDriver(Uart* uart);
+	ServoDriver(ISerial* uart);
 	/*
-	Make use of int32_t, int16_t, int8_t (32-bits, 16-bits, or 8-bits) 
+	Make use of int32_t, int16_t, int8_t (32-bits, 16-bits, or 8-bits)
 	instead of int, short, or char.
 	This will ensure that the length of the integer is always the same on different platforms.
 	*/
-    
-    // You will likely want to give this constructor parameters that distinguish this specific motor
-    // from any other one.
-  
+
 	// Sets the angle of this servo motor to the given number of degrees.
+	// Returns false if the servo number is not 1 to 8 or the command could not be written.
 	bool setAngle(int8_t servoNumber, int16_t degrees);
-	
-    // Returns the angle that this motor was last set to. Nothing written currently.
+
+	// Returns the angle that this motor was last set to, as it was limited to 0 to 5000,
+	// or -1 if it has not been set.
 	int16_t getAngle(int8_t servoNumber);
 
 	// Sets the speed setting of the servo motor
 	// Accepts values from 0 to 127
 	bool setSpeed(int8_t servoNumber, int16_t speed);
-	
-	// Returns the speed setting of the servo motor. Nothing written currently. 
+
+	// Returns the speed setting that this motor was last set to, as it was limited to 0 to 127,
+	// or -1 if it has not been set.
 	int8_t getSpeed(int8_t servoNumber);
 
+	// Gathers the commands from here on until flushBatch, rather than writing each as it is made
+	void beginBatch();
+
+	// Writes everything gathered since beginBatch in one write.
+	// Returns false if it could not be written, when those servos are treated as not set.
+	bool flushBatch();
+
+	// Forgets what every servo was set to, so the next commands are all written,
+	// such as after the controller has been reset
+	void forgetState();
+
 	private:
 
-	Uart* uart;
+	// Writes the command, or adds it to the batch
+	bool writeCommand(const uint8_t* command, int32_t length);
+
+	ISerial* uart;
+
+	// What each servo was last set to, -1 for not set
+	int16_t angles[SERVO_COUNT];
+	int8_t speeds[SERVO_COUNT];
 
+	bool isBatching;
+	char batch[SERVO_BATCH_BYTES];
+	int32_t batchLength;
+	// Which servos have an angle or speed in the batch, one bit each
+	uint32_t batchedAngles;
+	uint32_t batchedSpeeds;
 
 };
 
@@ -0,0 +1,119 @@
+#include "SimulatedPulseSource.h"
+#include "HardwarePath.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static uint64_t monotonicNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+SimulatedPulseSource::SimulatedPulseSource()
+{
+    pwmInFifoInit(&fifo);
+    pwmHandle = open(hardwarePath("/dev/pwm_in").c_str(), O_RDONLY | O_CLOEXEC);
+    if (pwmHandle == -1)
+    {
+        perror("SimulatedPulseSource: opening the pwm_in stand-in");
+    }
+}
+
+SimulatedPulseSource::~SimulatedPulseSource()
+{
+    if (pwmHandle != -1)
+    {
+        close(pwmHandle);
+    }
+}
+
+bool SimulatedPulseSource::isReady() const
+{
+    return pwmHandle != -1;
+}
+
+int SimulatedPulseSource::addGpio(int gpioNumber)
+{
+    if (pwmHandle == -1 || gpioNumber < 0 || gpioNumber >= SIMULATED_PWM_GPIOS ||
+        channels.size() >= PWM_IN_MAX_CHANNELS)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        if (channels[i].gpioNumber == gpioNumber)
+        {
+            return -1;
+        }
+    }
+
+    SimulatedChannel channel;
+    memset(&channel, 0, sizeof(channel));
+    channel.gpioNumber = gpioNumber;
+    channel.nextRisingNs = monotonicNow() + SIMULATED_PULSE_PERIOD_NS;
+    channels.push_back(channel);
+    return channels.size() - 1;
+}
+
+void SimulatedPulseSource::generatePulses(uint64_t now)
+{
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        uint32_t widthUs;
+        if (pread(pwmHandle, &widthUs, sizeof(widthUs), channels[i].gpioNumber * sizeof(widthUs)) != sizeof(widthUs))
+        {
+            widthUs = 0;
+        }
+        channels[i].widthNs = widthUs * 1000;
+    }
+
+    // The pulse falling first goes in first, as the interrupts would put them
+    while (true)
+    {
+        SimulatedChannel* first = NULL;
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            uint64_t fallingNs = channels[i].nextRisingNs + channels[i].widthNs;
+            if (fallingNs <= now && (!first || fallingNs < first->nextRisingNs + first->widthNs))
+            {
+                first = &channels[i];
+            }
+        }
+        if (!first)
+        {
+            break;
+        }
+
+        // No width means no signal at all
+        if (first->widthNs != 0)
+        {
+            PwmInPulse pulse;
+            pulse.channel = first - &channels[0];
+            pulse.gpio = first->gpioNumber;
+            pulse.widthNs = first->widthNs;
+            pulse.risingNs = first->nextRisingNs;
+            pwmInFifoPut(&fifo, &pulse);
+        }
+        first->nextRisingNs += SIMULATED_PULSE_PERIOD_NS;
+    }
+}
+
+int SimulatedPulseSource::readPulses(PwmInPulse* pulses, int maxPulses)
+{
+    if (pwmHandle == -1)
+    {
+        return -1;
+    }
+
+    generatePulses(monotonicNow());
+    return pwmInFifoGet(&fifo, pulses, maxPulses);
+}
+
+uint64_t SimulatedPulseSource::getDroppedPulses()
+{
+    return fifo.dropped;
+}
@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include <vector>
+#include "IPulseSource.h"
+#include "pwm_in/pwm_in_fifo.h"
+
+#ifndef SIMULATED_PULSE_SOURCE
+#define SIMULATED_PULSE_SOURCE
+
+// Time between the simulated pulses of a channel, as a 50hz servo signal
+#define SIMULATED_PULSE_PERIOD_NS 20000000ULL
+
+// Does in userspace what the pwm_in driver does, from the hardware simulator's stand-in.
+//
+// The stand-in holds the current pulse width of every gpio (see SIMULATED_PWM_GPIOS).
+// Each channel gets a pulse of that width every SIMULATED_PULSE_PERIOD_NS on the monotonic
+// clock. They go in the order they fall into the driver's own PwmInFifo, which drops its oldest
+// pulse when full. The pulses are made when they are read, so a slow reader loses pulses the same way.
+class SimulatedPulseSource : implements IPulseSource
+{
+    public:
+
+    // Opens the stand-in under the hardware prefix. If it cannot be, isReady() will return false.
+    SimulatedPulseSource();
+    ~SimulatedPulseSource();
+
+    bool isReady() const;
+
+    int addGpio(int gpioNumber);
+
+    int readPulses(PwmInPulse* pulses, int maxPulses);
+
+    uint64_t getDroppedPulses();
+
+    private:
+
+    typedef struct
+    {
+        int gpioNumber;
+        // When the next pulse rises
+        uint64_t nextRisingNs;
+        // The width from the stand-in, 0 for no signal
+        uint32_t widthNs;
+    } SimulatedChannel;
+
+    // Makes the pulses of every channel that have fallen since the last time
+    void generatePulses(uint64_t now);
+
+    // Not copyable, we own the handle
+    SimulatedPulseSource(const SimulatedPulseSource&);
+    SimulatedPulseSource& operator=(const SimulatedPulseSource&);
+
+    std::vector<SimulatedChannel> channels;
+
+    PwmInFifo fifo;
+
+    int pwmHandle;
+};
+
+#endif
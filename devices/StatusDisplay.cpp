@@ -0,0 +1,50 @@
+#include "StatusDisplay.h"
+
+StatusDisplay::StatusDisplay(const int32_t* gpioNumbers, int count)
+    : leds(gpioNumbers, count, 0)
+{
+    lights = 0;
+    shownLights = 0;
+    updateCount = 0;
+}
+
+bool StatusDisplay::isReady() const
+{
+    return leds.isReady();
+}
+
+void StatusDisplay::setLight(int light, bool isOn)
+{
+    if (light < 0 || light >= leds.getCount())
+    {
+        return;
+    }
+    uint32_t bit = 1U << light;
+    lights = isOn ? (lights | bit) : (lights & ~bit);
+}
+
+int StatusDisplay::show()
+{
+    uint32_t changed = lights ^ shownLights;
+    if (changed == 0)
+    {
+        return 0;
+    }
+    if (leds.setValues(lights) == -1)
+    {
+        return -1;
+    }
+    shownLights = lights;
+    updateCount++;
+    return __builtin_popcount(changed);
+}
+
+uint32_t StatusDisplay::getShown() const
+{
+    return shownLights;
+}
+
+uint64_t StatusDisplay::getUpdateCount() const
+{
+    return updateCount;
+}
@@ -0,0 +1,43 @@
+#include <stdint.h>
+#include "GpioLineGroup.h"
+
+#ifndef STATUS_DISPLAY
+#define STATUS_DISPLAY
+
+// A bar of leds, each showing whether something is well.
+//
+// Lights are set as often as wanted, then shown together with show().
+// The pins are only touched when a light has changed since it was last shown,
+// and then with a single update of the whole bar, so a steady display costs no system calls.
+class StatusDisplay
+{
+    public:
+
+    // The leds on the given gpio numbers, light i on gpio i. They start off.
+    StatusDisplay(const int32_t* gpioNumbers, int count);
+
+    bool isReady() const;
+
+    // Turns a light on or off, to be shown with the next show()
+    void setLight(int light, bool isOn);
+
+    // Shows the lights as they have been set, if any of them changed.
+    // Returns how many lights changed, or -1 if the pins could not be set.
+    int show();
+
+    // The lights as they were last shown, bit i for light i
+    uint32_t getShown() const;
+
+    // How many times the pins have actually been set
+    uint64_t getUpdateCount() const;
+
+    private:
+
+    GpioLineGroup leds;
+
+    uint32_t lights;
+    uint32_t shownLights;
+    uint64_t updateCount;
+};
+
+#endif
@@ -1,8 +1,10 @@
 #include "TemperatureSensor.h"
 
-TemperatureSensor::TemperatureSensor(ADCSensor3008* adc)
+TemperatureSensor::TemperatureSensor(ADCSensor3008* adc, const CalibrationTable* calibration)
 {
     this->adc = adc;
+    this->calibration = calibration;
+    this->lastTemperature = INT32_MIN;
 }
 
 int32_t TemperatureSensor::getTemperature() const
@@ -12,11 +14,7 @@ int32_t TemperatureSensor::getTemperature() const
 
 int32_t TemperatureSensor::readTemperature()
 {
-    int32_t adcValue = adc->readConversion();
-    // We will assume 2.98V at 298K, adc is 10-bit
-    // T = V * T0 / V0
-    // V0 = 2.98 volts * 1023 max value / 5 volts max value
-    // return value = T - 24850 so that the result is in celsius, not kelvin
-    lastTemperature = (adcValue * 298000 / 610) - 24850;
+    // A failed conversion of -1 comes out as INT32_MIN
+    lastTemperature = calibration->convertValue(adc->readValue());
     return lastTemperature;
-}
\ No newline at end of file
+}
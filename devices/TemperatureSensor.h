@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include "ADCSensor3008.h"
+#include "CalibrationTable.h"
 
 #ifndef TEMPERATURE_SENSOR
 #define TEMPERATURE_SENSOR
@@ -7,6 +8,8 @@
 // Takes measurements from a physical temperature sensor device.
 // This is sepcifically meant here for a LM335 with a 1k resistor.
 // Uncalibrated, we don't really expect too much accuracy. +-3 celsius or so.
+// The calibration table turns the adc's values into temperatures, so with
+// a table made for it, any other sensor on an adc channel will do as well.
 class TemperatureSensor
 {
     public:
@@ -17,12 +20,13 @@ class TemperatureSensor
     This will ensure that the length of the integer is always the same on different platforms.
     */
     
-    // Takes the adc sensor to use.
-    TemperatureSensor(ADCSensor3008* adc);
+    // Takes the adc sensor to use, and the table of its conversions' temperatures
+    // (celsius, decimal point fixed at the 1000s place), which it does not own.
+    TemperatureSensor(ADCSensor3008* adc, const CalibrationTable* calibration);
     
     // Value returned has the decimal point fixed at the 1000s place.
     // Value is in degrees celsius.
-    // Returns the last temperature value read by the sensor.
+    // Returns the last temperature value read by the sensor, INT32_MIN if there is none.
     int32_t getTemperature() const;
     
     // Value returned has the decimal point fixed at the 1000s place.
@@ -35,6 +39,7 @@ class TemperatureSensor
     private:
 
     ADCSensor3008* adc;
+    const CalibrationTable* calibration;
     int32_t lastTemperature;
 };
 
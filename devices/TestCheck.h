@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdarg.h>
+
+#ifndef TEST_CHECK
+#define TEST_CHECK
+
+// What the *Test.testcpp programs check with. Each is a program of its own,
+// so the count of failures can live here, one for each of them.
+
+static int failures = 0;
+
+// Counts a failure, printing what failed, printf style, when isPassing is false
+static void check(bool isPassing, const char* what, ...)
+{
+    if (!isPassing)
+    {
+        va_list arguments;
+        va_start(arguments, what);
+        printf("FAIL: ");
+        vprintf(what, arguments);
+        printf("\n");
+        va_end(arguments);
+        failures++;
+    }
+}
+
+// Prints PASS or how many failed, and gives main what to return
+static int finishChecks()
+{
+    printf(failures ? "%d failures\n" : "PASS\n", failures);
+    return failures ? 1 : 0;
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include "Uart.h"
+#include "HardwarePath.h"
+#include "../recorder/FlightRecorder.h"
 #include <termios.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -7,7 +9,7 @@
 
 int Uart::configMux(const char* mux1, const char* setting1, const char* mux2, const char* setting2)
 {
-    int muxFile = open(mux1, O_WRONLY);
+    int muxFile = open(hardwarePath(mux1).c_str(), O_WRONLY);
     if (muxFile == -1)
     {
         return -1;
@@ -15,7 +17,7 @@ int Uart::configMux(const char* mux1, const char* setting1, const char* mux2, co
     write(muxFile, setting1, strlen(setting1));
     close(muxFile);
     
-    muxFile = open(mux2, O_WRONLY);
+    muxFile = open(hardwarePath(mux2).c_str(), O_WRONLY);
     if (muxFile == -1)
     {
         return -1;
@@ -26,53 +28,9 @@ int Uart::configMux(const char* mux1, const char* setting1, const char* mux2, co
     return 0;
 }
 
-Uart::Uart(int uartNumber, int32_t baudRate)
+// The termios speed for a baud rate, false if there is none
+static bool baudRateToSpeed(int32_t baudRate, speed_t* speed)
 {
-    uartHandle = -1;
-    
-    uartNumber = (uartNumber < 1) ? 1 : ((uartNumber > 5) ? 5 : uartNumber);
-    switch (uartNumber)
-    {
-        case 1:
-            //Mux settings go first... Then if no problem, do open as normal
-            if (configMux("/sys/kernel/debug/omap_mux/uart1_rxd", "20", "/sys/kernel/debug/omap_mux/uart1_txd", "0") == 0)
-            {
-                uartHandle = open("/dev/ttyO1", O_RDWR);
-            }
-            break;
-        case 2:
-            if (configMux("/sys/kernel/debug/omap_mux/spi0_sclk", "21", "/sys/kernel/debug/omap_mux/spi0_d0", "1") == 0)
-            {
-                uartHandle = open("/dev/ttyO2", O_RDWR);
-            }
-            break;
-        case 3:
-            // UART3 can only be written to! It actually has an rx pin, but it is completely inaccessible
-            if (configMux("/dev/null", "00", "/sys/kernel/debug/omap_mux/ecap0_in_pwm0_out", "1") == 0)
-            {
-                uartHandle = open("/dev/ttyO3", O_WRONLY);
-            }
-            break;
-        case 4:
-            if (configMux("/sys/kernel/debug/omap_mux/gpmc_wait0", "26", "/sys/kernel/debug/omap_mux/gpmc_wpn", "6") == 0)
-            {
-                uartHandle = open("/dev/ttyO4", O_RDWR);
-            }
-            break;
-        case 5:
-            if (configMux("/sys/kernel/debug/omap_mux/lcd_data9", "24", "/sys/kernel/debug/omap_mux/lcd_data8", "4") == 0)
-            {
-                uartHandle = open("/dev/ttyO5", O_RDWR);
-            }
-            break;
-    }
-    
-    if (uartHandle == -1)
-    {
-        isInitialized = false;
-        return;
-    }
-    
     speed_t rate;
     switch (baudRate)
     {
@@ -161,14 +119,67 @@ Uart::Uart(int uartNumber, int32_t baudRate)
             rate = B4000000;
             break;
         default:
-            isInitialized = false;
-            return;
+            return false;
+    }
+    *speed = rate;
+    return true;
+}
+
+Uart::Uart(int uartNumber, int32_t baudRate)
+{
+    uartHandle = -1;
+    readBufferStart = 0;
+    readBufferLength = 0;
+    recorder = NULL;
+    capture = NULL;
+    this->baudRate = 0;
+    
+    uartNumber = (uartNumber < 1) ? 1 : ((uartNumber > 5) ? 5 : uartNumber);
+    this->uartNumber = uartNumber;
+    switch (uartNumber)
+    {
+        case 1:
+            //Mux settings go first... Then if no problem, do open as normal
+            if (configMux("/sys/kernel/debug/omap_mux/uart1_rxd", "20", "/sys/kernel/debug/omap_mux/uart1_txd", "0") == 0)
+            {
+                uartHandle = open(hardwarePath("/dev/ttyO1").c_str(), O_RDWR);
+            }
+            break;
+        case 2:
+            if (configMux("/sys/kernel/debug/omap_mux/spi0_sclk", "21", "/sys/kernel/debug/omap_mux/spi0_d0", "1") == 0)
+            {
+                uartHandle = open(hardwarePath("/dev/ttyO2").c_str(), O_RDWR);
+            }
+            break;
+        case 3:
+            // UART3 can only be written to! It actually has an rx pin, but it is completely inaccessible
+            if (configMux("/dev/null", "00", "/sys/kernel/debug/omap_mux/ecap0_in_pwm0_out", "1") == 0)
+            {
+                uartHandle = open(hardwarePath("/dev/ttyO3").c_str(), O_WRONLY);
+            }
+            break;
+        case 4:
+            if (configMux("/sys/kernel/debug/omap_mux/gpmc_wait0", "26", "/sys/kernel/debug/omap_mux/gpmc_wpn", "6") == 0)
+            {
+                uartHandle = open(hardwarePath("/dev/ttyO4").c_str(), O_RDWR);
+            }
+            break;
+        case 5:
+            if (configMux("/sys/kernel/debug/omap_mux/lcd_data9", "24", "/sys/kernel/debug/omap_mux/lcd_data8", "4") == 0)
+            {
+                uartHandle = open(hardwarePath("/dev/ttyO5").c_str(), O_RDWR);
+            }
+            break;
+    }
+    
+    if (uartHandle == -1)
+    {
+        isInitialized = false;
+        return;
     }
     
     struct termios terminalOptions;
     tcgetattr(uartHandle, &terminalOptions);
-    cfsetispeed(&terminalOptions, rate);
-    cfsetospeed(&terminalOptions, rate);
     
     // disable canonical mode processing in the line discipline driver
     // So everything is read in instantly from stdin!
@@ -180,15 +191,50 @@ Uart::Uart(int uartNumber, int32_t baudRate)
     terminalOptions.c_cc[VTIME] = 0;
     terminalOptions.c_cc[VMIN] = 0;
     
-    int result = tcsetattr(uartHandle, TCSANOW, &terminalOptions);
-    
-    if (result == -1)
+    if (tcsetattr(uartHandle, TCSANOW, &terminalOptions) == -1)
     {
         isInitialized = false;
         return;
     }
     
-    isInitialized = true;
+    isInitialized = setBaudRate(baudRate);
+}
+
+bool Uart::setBaudRate(int32_t baudRate)
+{
+    speed_t rate;
+    if (uartHandle == -1 || !baudRateToSpeed(baudRate, &rate))
+    {
+        return false;
+    }
+    
+    struct termios terminalOptions;
+    if (tcgetattr(uartHandle, &terminalOptions) == -1)
+    {
+        perror("Uart: getting terminal settings");
+        return false;
+    }
+    cfsetispeed(&terminalOptions, rate);
+    cfsetospeed(&terminalOptions, rate);
+    
+    // Let whatever is being sent go out at the old rate first
+    if (tcsetattr(uartHandle, TCSADRAIN, &terminalOptions) == -1)
+    {
+        perror("Uart: setting baud rate");
+        return false;
+    }
+    this->baudRate = baudRate;
+    return true;
+}
+
+int32_t Uart::getBaudRate() const
+{
+    return baudRate;
+}
+
+int Uart::getReadHandle() const
+{
+    return (isInitialized && uartNumber != 3) ? uartHandle : -1;
 }
 
 bool Uart::isReady() const
@@ -202,30 +248,48 @@ int32_t Uart::readByte()
     {
         return -1;
     }
-    uint8_t value = -1;
-    int result = read(uartHandle, &value, sizeof(uint8_t));
-    // If we didn't read a single byte... we have a proble,
-    if (result != sizeof(uint8_t))
+    // Refill from the device once everything buffered has been handed out
+    if (readBufferStart >= readBufferLength)
     {
-        return -1;
+        int result = read(uartHandle, readBuffer, sizeof(readBuffer));
+        // If we didn't read a single byte... we have a proble,
+        if (result <= 0)
+        {
+            return -1;
+        }
+        readBufferStart = 0;
+        readBufferLength = result;
+        
+        if (recorder)
+        {
+            recorder->recordSerial(uartNumber, readBuffer, result);
+        }
+        if (capture)
+        {
+            capture->recordSerial(uartNumber, readBuffer, result);
+        }
     }
-    return value;
+    return readBuffer[readBufferStart++];
 }
 
-void Uart::writeByte(uint8_t value)
+bool Uart::writeByte(uint8_t value)
 {
-    if (isInitialized)
-    {
-        write(uartHandle, &value, sizeof(uint8_t));
-    }
+    return isInitialized && write(uartHandle, &value, sizeof(uint8_t)) == sizeof(uint8_t);
 }
 
-void Uart::writeString(const char* str)
+bool Uart::writeBytes(const char* data, int32_t length)
 {
-    if (isInitialized)
-    {
-        write(uartHandle, str, strlen(str));
-    }
+    return isInitialized && write(uartHandle, data, length) == length;
+}
+
+void Uart::setRecorder(FlightRecorder* recorder)
+{
+    this->recorder = recorder;
+}
+
+void Uart::setCapture(FlightRecorder* capture)
+{
+    this->capture = capture;
 }
 
 /*Uart& operator << (Uart& uart, const char* val)
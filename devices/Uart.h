@@ -2,11 +2,17 @@
 #include <unistd.h>
 #include <sstream>
 #include <iostream>
+#include "ISerial.h"
 #ifndef UART_WRAPPER
 #define UART_WRAPPER
 
+class FlightRecorder;
+
+// How many bytes are taken from the device with a single read
+#define UART_READ_BUFFER_SIZE 256
+
 // A wrapper for the Linux's UART serial devices
-class Uart
+class Uart : implements ISerial
 {
     public:
 
@@ -25,32 +31,59 @@ class Uart
     bool isReady() const;
     
     // Reads a single byte from the UART or -1 if there are none available.
+    // Bytes are taken from the device in chunks, so most calls do not need a system call.
     int32_t readByte();
     
     // Writes a single byte to the UART
-    void writeByte(uint8_t value);
+    bool writeByte(uint8_t value);
+    
+    // Writes length bytes to the UART with a single system call
+    bool writeBytes(const char* data, int32_t length);
+    
+    // Changes the baud rate once anything being sent has gone out, keeping every other setting.
+    // Returns false for a baud rate termios does not have, leaving the old one.
+    bool setBaudRate(int32_t baudRate);
+    
+    int32_t getBaudRate() const;
+    
+    // The device's file handle, to wait on for received bytes with poll.
+    // -1 if the uart is not ready or is write only.
+    int getReadHandle() const;
     
-    // Write the given null terminated string.
-    void writeString(const char* str);
+    // Every chunk of received bytes will also be appended to the given recorder,
+    // with this uart's number as the source. NULL to stop recording.
+    void setRecorder(FlightRecorder* recorder);
     
-    template<class T>
-    inline Uart& operator << (T val)
-    {
-        std::stringstream convertOutput;
-        convertOutput << val;
-        //std::cout << "Q" << convertOutput.str().c_str();
-        write(uartHandle, convertOutput.str().c_str(), convertOutput.str().length());
-        return *this;
-    }
+    // Same as the recorder, but meant for a recorder of this uart alone,
+    // so that ReplayUart can feed the capture back later. NULL to stop capturing.
+    void setCapture(FlightRecorder* capture);
 
     private:
         
     // configures the kernel mux settings by simple writing the given settings to the given mux files.
+    // The files are found under the hardware prefix, as are the tty devices.
     int configMux(const char* mux1, const char* setting1, const char* mux2, const char* setting2);
 
     // File handle to our /dev/ttyO# device
     int uartHandle;
     
+    // Which of the uarts we are, 1 to 5
+    int uartNumber;
+    
+    // The baud rate last set
+    int32_t baudRate;
+    
+    // Bytes read from the device, but not yet by readByte
+    uint8_t readBuffer[UART_READ_BUFFER_SIZE];
+    int readBufferStart;
+    int readBufferLength;
+    
+    // Where received chunks are recorded, or NULL
+    FlightRecorder* recorder;
+    
+    // Where received chunks are captured, or NULL
+    FlightRecorder* capture;
+    
     // Whether we initialized correctly, value returned by isReady
     bool isInitialized;
 
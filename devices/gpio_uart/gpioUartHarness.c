@@ -0,0 +1,474 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+// Says what the decoder does when built with make harness GPIO_UART_DEBUG=2,
+// which is the way to see what that much tracing costs
+#ifndef GPIO_UART_DEBUG
+#define GPIO_UART_DEBUG 0
+#endif
+#define uartDebug(level, ...) \
+    do \
+    { \
+        if (GPIO_UART_DEBUG >= (level)) \
+        { \
+            fprintf(stderr, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#include "gpio_uart_core.h"
+
+// Runs the rx decoding of the gpio_uart module on a made up signal, as fast as it goes,
+// and says how many bytes it got wrong and how long it took for each edge.
+//
+// The signal is random bytes from a transmitter whose clock is off by the baud error, with
+// a few bits of idle line between some of them. Every edge is then seen late by anything up
+// to the jitter, as an interrupt would be, and noise puts short glitches on the line.
+//
+// With -t the module's own transmitter sends the bytes instead, back to back, with each of
+// its timer expiries late by anything up to the timer latency. That shows how much timer
+// latency the receiving end can put up with, and how few expiries a byte takes.
+//
+// With -u the signal goes through that many decoders taking turns edge by edge, each starting
+// somewhere else in it, as the tasklets of the module's uarts would share a cpu. The time it
+// takes against the time the signal lasts is how much of the cpu the uarts would need.
+//
+// With -a the decoders are set to the rate given, rather than the one sent at, and train
+// for the rate that arrives. The bytes sent while they train count as wrong.
+
+// Bytes of idle line sent after the bytes, to push the last of them through the decoder
+#define FLUSH_BYTES 4
+// Most decoders to run together with -u, as the module has at most 8 uarts
+#define MAX_DECODERS 8
+// How far either side of where the bytes have been lining up to look for the next match
+#define ALIGNMENT_BAND 64
+
+typedef struct
+{
+    int baudRate;
+    bool parityBit;
+    bool secondStopBit;
+    // How far the transmitter's clock is off, in percent
+    double baudErrorPercent;
+    // Most nanoseconds an edge is seen late
+    long jitterNs;
+    // Glitches in every 1000 bits
+    double noisePerThousand;
+    // Whether to send with the module's transmitter, and the most nanoseconds its timer expires late
+    bool isModuleTx;
+    long timerLatencyNs;
+    int byteCount;
+    unsigned int seed;
+    // Decoders taking turns, the first of which has its bytes checked
+    int decoderCount;
+    // The rate the decoders start at when training for it, 0 to decode at the rate sent
+    int autoBaudFrom;
+} HarnessSettings;
+
+// A change of the line to value at timeNs
+typedef struct
+{
+    double timeNs;
+    bool value;
+} Edge;
+
+typedef struct
+{
+    unsigned char* bytes;
+    int count;
+    int size;
+} ByteList;
+
+void addByte(void* context, unsigned char value)
+{
+    ByteList* list = (ByteList*)context;
+    if (list->count == list->size)
+    {
+        list->size = list->size ? list->size * 2 : 1024;
+        list->bytes = realloc(list->bytes, list->size);
+        if (!list->bytes)
+        {
+            perror("Harness: growing the received bytes");
+            exit(1);
+        }
+    }
+    list->bytes[list->count++] = value;
+}
+
+// A random number from 0 up to but not including 1
+double randomFraction(void)
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+// The line holding value for a bit, from *timeNs, with the chance of a glitch somewhere in it
+int addBit(Edge* edges, int edgeCount, bool* lineValue, bool value, double* timeNs, double bitNs, const HarnessSettings* settings)
+{
+    if (value != *lineValue)
+    {
+        edges[edgeCount].timeNs = *timeNs;
+        edges[edgeCount].value = value;
+        edgeCount++;
+        *lineValue = value;
+    }
+    if (randomFraction() * 1000 < settings->noisePerThousand)
+    {
+        // A glitch of an eighth of a bit
+        double glitchNs = *timeNs + randomFraction() * bitNs * 7 / 8;
+        edges[edgeCount].timeNs = glitchNs;
+        edges[edgeCount].value = !value;
+        edges[edgeCount + 1].timeNs = glitchNs + bitNs / 8;
+        edges[edgeCount + 1].value = value;
+        edgeCount += 2;
+    }
+    *timeNs += bitNs;
+    return edgeCount;
+}
+
+// Makes the edges of sending the bytes, returning how many there are
+int makeEdges(const unsigned char* bytes, int count, Edge* edges, const HarnessSettings* settings)
+{
+    double bitNs = 1e9 / (settings->baudRate * (1 + settings->baudErrorPercent / 100));
+    double timeNs = 0;
+    bool lineValue = true;
+    int edgeCount = 0;
+
+    // Idle for a while first, as a line would be
+    for (int i = 0; i < 20; i++)
+    {
+        edgeCount = addBit(edges, edgeCount, &lineValue, true, &timeNs, bitNs, settings);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        edgeCount = addBit(edges, edgeCount, &lineValue, false, &timeNs, bitNs, settings);
+        int parity = 0;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            bool value = (bytes[i] >> bit) & 1;
+            parity ^= value;
+            edgeCount = addBit(edges, edgeCount, &lineValue, value, &timeNs, bitNs, settings);
+        }
+        if (settings->parityBit)
+        {
+            edgeCount = addBit(edges, edgeCount, &lineValue, parity, &timeNs, bitNs, settings);
+        }
+        // Stop bits, and a quarter of the time up to three bits of idle line
+        int idleBits = 1 + (settings->secondStopBit ? 1 : 0) + ((rand() % 4 == 0) ? rand() % 4 : 0);
+        for (int bit = 0; bit < idleBits; bit++)
+        {
+            edgeCount = addBit(edges, edgeCount, &lineValue, true, &timeNs, bitNs, settings);
+        }
+    }
+
+    return edgeCount;
+}
+
+// Makes the edges the module's tx timer puts on the line sending the bytes, each expiry up
+// to the timer latency late, returning how many there are
+int makeModuleTxEdges(const unsigned char* bytes, int count, Edge* edges, const HarnessSettings* settings)
+{
+    // The module works in whole nanoseconds a bit, on a clock that may be off
+    double bitNs = (1000000000L / settings->baudRate) / (1 + settings->baudErrorPercent / 100);
+    // Idle for a while first, as a line would be
+    double frameStartNs = 20 * bitNs;
+    int edgeCount = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int bitCount;
+        int frame = makeTxFrame(bytes[i], settings->parityBit, settings->secondStopBit, &bitCount);
+        for (int bit = 0; bit < bitCount; bit = nextTxEdge(frame, bitCount, bit))
+        {
+            edges[edgeCount].timeNs = frameStartNs + bit * bitNs + randomFraction() * settings->timerLatencyNs;
+            edges[edgeCount].value = (frame >> bit) & 1;
+            edgeCount++;
+        }
+        frameStartNs += bitCount * bitNs;
+    }
+    return edgeCount;
+}
+
+// Every edge is seen up to the jitter late
+void delayEdges(Edge* edges, int edgeCount, long jitterNs)
+{
+    for (int i = 0; i < edgeCount; i++)
+    {
+        edges[i].timeNs += randomFraction() * jitterNs;
+    }
+    // Which may put edges close together out of order, and an interrupt cannot see that
+    for (int i = 1; i < edgeCount; i++)
+    {
+        if (edges[i].timeNs < edges[i - 1].timeNs)
+        {
+            edges[i].timeNs = edges[i - 1].timeNs;
+        }
+    }
+}
+
+// The fewest bytes lost, added or changed to get what was sent from what was received,
+// not counting anything received after the last byte sent (the flush)
+int countByteErrors(const unsigned char* sent, int sentCount, const unsigned char* received, int receivedCount)
+{
+    int* last = malloc((receivedCount + 1) * sizeof(int));
+    int* next = malloc((receivedCount + 1) * sizeof(int));
+    if (!last || !next)
+    {
+        perror("Harness: matching bytes");
+        exit(1);
+    }
+    int far = sentCount + receivedCount;
+
+    // Only a band of received bytes is worked out for each byte sent, following the best match
+    // so far, as bytes dropped or made up along the way move the two out of line
+    for (int j = 0; j <= receivedCount; j++)
+    {
+        last[j] = (j <= ALIGNMENT_BAND) ? j : far;
+        next[j] = far;
+    }
+    int center = 0;
+    // Where each row was filled in, so it can be put back to far before it is filled in again
+    int lastFrom = 0;
+    int lastTo = (ALIGNMENT_BAND < receivedCount) ? ALIGNMENT_BAND : receivedCount;
+    int nextFrom = 0;
+    int nextTo = -1;
+    for (int i = 1; i <= sentCount; i++)
+    {
+        for (int j = nextFrom; j <= nextTo; j++)
+        {
+            next[j] = far;
+        }
+        int from = (center + 1 - ALIGNMENT_BAND > 0) ? center + 1 - ALIGNMENT_BAND : 0;
+        int to = (center + 1 + ALIGNMENT_BAND < receivedCount) ? center + 1 + ALIGNMENT_BAND : receivedCount;
+        int bestInRow = far;
+        for (int j = from; j <= to; j++)
+        {
+            int best = last[j] + 1;
+            if (j > 0)
+            {
+                int changed = last[j - 1] + (sent[i - 1] != received[j - 1]);
+                int added = next[j - 1] + 1;
+                best = (changed < best) ? changed : best;
+                best = (added < best) ? added : best;
+            }
+            next[j] = best;
+            if (best < bestInRow)
+            {
+                bestInRow = best;
+                center = j;
+            }
+        }
+        int* swap = last;
+        last = next;
+        next = swap;
+        nextFrom = lastFrom;
+        nextTo = lastTo;
+        lastFrom = from;
+        lastTo = to;
+    }
+
+    int errors = far;
+    for (int j = 0; j <= receivedCount; j++)
+    {
+        errors = (last[j] < errors) ? last[j] : errors;
+    }
+    free(last);
+    free(next);
+    return errors;
+}
+
+void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-b baud] [-e baud error %%] [-j jitter ns] [-n glitches per 1000 bits] [-c bytes] [-s seed] [-p] [-2]\n"
+                    "       [-t [-l timer latency ns]] [-u decoders] [-a baud]\n"
+                    "  -p for a parity bit, -2 for a second stop bit\n"
+                    "  -t to send with the module's transmitter (without glitches)\n"
+                    "  -u to decode with up to %d decoders at once\n"
+                    "  -a to start the decoders at another baud and have them train for the one sent\n", name, MAX_DECODERS);
+}
+
+int main(int argc, char* argv[])
+{
+    HarnessSettings settings;
+    settings.baudRate = 9600;
+    settings.parityBit = false;
+    settings.secondStopBit = false;
+    settings.baudErrorPercent = 0;
+    settings.jitterNs = 0;
+    settings.noisePerThousand = 0;
+    settings.isModuleTx = false;
+    settings.timerLatencyNs = 0;
+    settings.decoderCount = 1;
+    settings.autoBaudFrom = 0;
+    settings.byteCount = 100000;
+    settings.seed = 1;
+
+    int option;
+    while ((option = getopt(argc, argv, "b:e:j:n:c:s:p2tl:u:a:")) != -1)
+    {
+        switch (option)
+        {
+            case 'b':
+                settings.baudRate = atoi(optarg);
+                break;
+            case 'e':
+                settings.baudErrorPercent = atof(optarg);
+                break;
+            case 'j':
+                settings.jitterNs = atol(optarg);
+                break;
+            case 'n':
+                settings.noisePerThousand = atof(optarg);
+                break;
+            case 'c':
+                settings.byteCount = atoi(optarg);
+                break;
+            case 's':
+                settings.seed = atoi(optarg);
+                break;
+            case 'p':
+                settings.parityBit = true;
+                break;
+            case '2':
+                settings.secondStopBit = true;
+                break;
+            case 't':
+                settings.isModuleTx = true;
+                break;
+            case 'l':
+                settings.timerLatencyNs = atol(optarg);
+                break;
+            case 'u':
+                settings.decoderCount = atoi(optarg);
+                break;
+            case 'a':
+                settings.autoBaudFrom = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (settings.baudRate <= 0 || settings.byteCount <= 0 || settings.baudErrorPercent <= -50 || settings.jitterNs < 0 ||
+        settings.timerLatencyNs < 0 || settings.decoderCount < 1 || settings.decoderCount > MAX_DECODERS ||
+        settings.autoBaudFrom < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // The bytes, then the flush of idle line, which is sent as 0xff since that is just a start bit
+    srand(settings.seed);
+    int sentCount = settings.byteCount + FLUSH_BYTES;
+    unsigned char* sent = malloc(sentCount);
+    // A frame has at most 12 bits, each with an edge and maybe a glitch of two more, and there is the idle at the start
+    Edge* edges = malloc((sentCount * 12 * 3 + 64) * sizeof(Edge));
+    if (!sent || !edges)
+    {
+        perror("Harness: making the signal");
+        return 1;
+    }
+    for (int i = 0; i < sentCount; i++)
+    {
+        sent[i] = (i < settings.byteCount) ? rand() & 0xff : 0xff;
+    }
+    int edgeCount;
+    if (settings.isModuleTx)
+    {
+        edgeCount = makeModuleTxEdges(sent, sentCount, edges, &settings);
+    }
+    else
+    {
+        edgeCount = makeEdges(sent, sentCount, edges, &settings);
+    }
+    delayEdges(edges, edgeCount, settings.jitterNs);
+
+    // The spans between the edges, as the interrupts would hand them to the bottom half
+    long* spanTimes = malloc(edgeCount * sizeof(long));
+    bool* spanValues = malloc(edgeCount * sizeof(bool));
+    if (!spanTimes || !spanValues)
+    {
+        perror("Harness: making the spans");
+        return 1;
+    }
+    double lastEdgeNs = 0;
+    bool lastValue = true;
+    for (int i = 0; i < edgeCount; i++)
+    {
+        spanTimes[i] = (long)(edges[i].timeNs - lastEdgeNs + 0.5);
+        spanValues[i] = lastValue;
+        lastEdgeNs = edges[i].timeNs;
+        lastValue = edges[i].value;
+    }
+
+    GpioUartCounters counters[MAX_DECODERS];
+    memset(counters, 0, sizeof(counters));
+    ByteList received[MAX_DECODERS];
+    memset(received, 0, sizeof(received));
+    GpioUartDecoder decoders[MAX_DECODERS];
+    // Where in the signal each decoder starts, going round to the start again after the end
+    int offsets[MAX_DECODERS];
+    for (int k = 0; k < settings.decoderCount; k++)
+    {
+        if (settings.autoBaudFrom)
+        {
+            initDecoder(&decoders[k], settings.autoBaudFrom, settings.parityBit, settings.secondStopBit, &counters[k], addByte, &received[k]);
+            startAutoBaud(&decoders[k]);
+        }
+        else
+        {
+            initDecoder(&decoders[k], settings.baudRate, settings.parityBit, settings.secondStopBit, &counters[k], addByte, &received[k]);
+        }
+        offsets[k] = (int)((long long)edgeCount * k / settings.decoderCount);
+    }
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < edgeCount; i++)
+    {
+        for (int k = 0; k < settings.decoderCount; k++)
+        {
+            int edge = (i + offsets[k] < edgeCount) ? i + offsets[k] : i + offsets[k] - edgeCount;
+            decodeSpan(&decoders[k], spanTimes[edge], spanValues[edge]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double decodeNs = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    double signalNs = edges[edgeCount - 1].timeNs;
+
+    int errors = countByteErrors(sent, settings.byteCount, received[0].bytes, received[0].count);
+
+    printf("%d bytes at %d baud (%+.2f%%), %ld ns jitter, %.2f glitches per 1000 bits\n", settings.byteCount,
+           settings.baudRate, settings.baudErrorPercent, settings.jitterNs, settings.noisePerThousand);
+    if (settings.isModuleTx)
+    {
+        printf("Sent by the module's transmitter, timer up to %ld ns late: %.2f expiries a byte\n",
+               settings.timerLatencyNs, (double)edgeCount / sentCount);
+    }
+    if (settings.autoBaudFrom)
+    {
+        GpioUartAutoBaud* autoBaud = &decoders[0].autoBaud;
+        printf("Auto-baud from %d baud %s at %d baud (sent at %.0f), %d%% confidence, %d failed trainings\n", settings.autoBaudFrom,
+               (autoBaud->state == GPIO_UART_AUTOBAUD_LOCKED) ? "locked" : "still training, last estimate", autoBaud->estimatedBaudRate,
+               settings.baudRate * (1 + settings.baudErrorPercent / 100), autoBaud->confidence, autoBaud->failedTrainings);
+    }
+    printf("%d bytes received, %d wrong, byte error rate %.6f\n", received[0].count, errors, (double)errors / settings.byteCount);
+    printf("%llu candidate frames, %llu lost on score, receiver drifted to %d baud\n", (unsigned long long)counters[0].candidateFrames,
+           (unsigned long long)counters[0].scoreFailures, decoders[0].modifiedBaudRate);
+    printf("%d edges decoded by %d decoders in %.3f ms, %.1f ns/edge, %.3f%% of a cpu for %.3f s of signal\n", edgeCount,
+           settings.decoderCount, decodeNs / 1e6, decodeNs / edgeCount / settings.decoderCount, decodeNs / signalNs * 100, signalNs / 1e9);
+
+    free(sent);
+    free(edges);
+    free(spanTimes);
+    free(spanValues);
+    for (int k = 0; k < settings.decoderCount; k++)
+    {
+        free(received[k].bytes);
+    }
+    return 0;
+}
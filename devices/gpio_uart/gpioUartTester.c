@@ -2,10 +2,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdarg.h>
 #include <string.h>
 #include <termios.h>
-#include <time.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -41,11 +42,12 @@ int main(int argc, char* argv[])
         perror("Error setting terminal settings");
     }
     
-    // Open up the uart simulator
-    int uart = open("/dev/gpio_uart", O_RDWR);
+    // Open up the uart simulator, the first unless told which
+    const char* device = (argc > 1) ? argv[1] : "/dev/gpio_uart0";
+    int uart = open(device, O_RDWR);
     if (uart == -1)
     {
-        perror("Opening /dev/gpio_uart");
+        perror(device);
         return -1;
     }
     // Configure it
@@ -54,6 +56,13 @@ int main(int argc, char* argv[])
         perror("Uart setting baud");
         return -1;
     }
+    // Or work the rate out from what arrives, when told "auto" after the device
+    bool isAutoBaud = argc > 2 && strcmp(argv[2], "auto") == 0;
+    if (isAutoBaud && ioctl(uart, GPIO_UART_IOC_SETAUTOBAUD, 1))
+    {
+        perror("Uart starting auto-baud");
+        return -1;
+    }
     if (ioctl(uart, GPIO_UART_IOC_SETRX, 8))
     {
         perror("Uart setting rx pin");
@@ -70,9 +79,22 @@ int main(int argc, char* argv[])
         return -1;
     }
     
+    // Sleep until either the terminal or the uart has something for us
+    struct pollfd waitingOn[2];
+    waitingOn[0].fd = 0;
+    waitingOn[0].events = POLLIN;
+    waitingOn[1].fd = uart;
+    waitingOn[1].events = POLLIN;
+    
     // We can only exit by Ctrl-C or escape
     while (1)
     {
+        if (poll(waitingOn, 2, -1) < 0)
+        {
+            perror("Waiting on the terminal and uart");
+            continue;
+        }
+        
         int terminalByte;
         // Do we have characters from the terminal?
         while ((terminalByte = getchar()) != -1)
@@ -80,6 +102,36 @@ int main(int argc, char* argv[])
             // End the program on escape=27
             if (terminalByte == 27)
             {
+                // Say how it went
+                GpioUartCounters counters;
+                if (ioctl(uart, GPIO_UART_IOC_GETCOUNTERS, &counters))
+                {
+                    perror("Uart getting counters");
+                }
+                else
+                {
+                    printf("\n%llu interrupts (%llu spurious), %llu spans, %llu candidate frames, %llu bytes received (%llu frames lost on score)\n",
+                           (unsigned long long)counters.interrupts, (unsigned long long)counters.spuriousInterrupts,
+                           (unsigned long long)counters.spansProcessed, (unsigned long long)counters.candidateFrames,
+                           (unsigned long long)counters.bytesReceived, (unsigned long long)counters.scoreFailures);
+                    printf("%llu bytes sent, overruns: %llu raw, %llu rx, %llu tx\n",
+                           (unsigned long long)counters.bytesSent, (unsigned long long)counters.rawOverruns,
+                           (unsigned long long)counters.rxOverruns, (unsigned long long)counters.txOverruns);
+                    printf("Baud rate %d, drifted to %d\n", counters.baudRate, counters.modifiedBaudRate);
+                    if (counters.txEdges)
+                    {
+                        printf("%llu tx edges, late by %llu ns on average and %llu ns at the most\n",
+                               (unsigned long long)counters.txEdges, (unsigned long long)(counters.txLateNs / counters.txEdges),
+                               (unsigned long long)counters.txMostLateNs);
+                    }
+                }
+                GpioUartAutoBaud autoBaud;
+                if (isAutoBaud && ioctl(uart, GPIO_UART_IOC_GETAUTOBAUD, &autoBaud) == 0)
+                {
+                    printf("Auto-baud %s at %d baud, %d%% confidence, %d failed trainings\n",
+                           (autoBaud.state == GPIO_UART_AUTOBAUD_LOCKED) ? "locked" : "still training, last estimate",
+                           autoBaud.estimatedBaudRate, autoBaud.confidence, autoBaud.failedTrainings);
+                }
                 // Close it too!
                 close(uart);
                 // Set terminal settings back
@@ -91,19 +143,16 @@ int main(int argc, char* argv[])
             //gpioUartSendByte(&uart, terminalByte);
         }
         
-        unsigned char uartByte;
-        // Do we have characters from the uart?
-        while (read(uart, &uartByte, 1) == 1)
+        // Do we have characters from the uart? Only read when poll says so, as the read would wait for them
+        if (waitingOn[1].revents & POLLIN)
         {
-            //printf("%c=%d", uartByte, uartByte);
-            putchar(uartByte);
+            unsigned char uartBytes[64];
+            int count = read(uart, uartBytes, sizeof(uartBytes));
+            for (int i = 0; i < count; i++)
+            {
+                putchar(uartBytes[i]);
+            }
         }
-        
-        // Give them some time to rest...
-        struct timespec sleepTime;
-        sleepTime.tv_sec = 0;
-        sleepTime.tv_nsec = 1000000; // a millisecond
-        nanosleep(&sleepTime, NULL);
     }
     return 0;
 }
@@ -19,12 +19,16 @@
 #include <asm/system.h> /* cli(), *_flags */
 #include <asm/uaccess.h> /* copy_from/to_user */
 #include <linux/errno.h>
-#include <linux/timer.h>
-#include <linux/jiffies.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
 #include <linux/spinlock.h>
 #include <linux/time.h>
 #include <linux/delay.h>
-#include <asm-generic/div64.h>
+#include <linux/moduleparam.h>
+#include <linux/stat.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <asm/div64.h>
 
 #include "gpio_uart.h"
 
@@ -32,15 +36,32 @@ MODULE_LICENSE("Dual BSD/GPL");
 
 #define UART_BUFFER_SIZE 4096
 
-//#define BIT_BUFFER_SIZE 192
-#define BIT_BUFFER_SIZE 22
+#define RAW_BIT_BUFFER_SIZE 16
 
-// Make this buffer fairly small, so that values do not get
-// stuck in here for too long, but big enough to allow some interesting
-// moving around of the time values.
-#define BIT_SPAN_BUFFER_SIZE 5
+// Most soft uarts the module can be asked for. Each is /dev/gpio_uartN, with minor number N.
+#define GPIO_UART_MAX_INSTANCES 8
 
-#define RAW_BIT_BUFFER_SIZE 16
+// How much the module says about what it is doing, fixed when it is compiled (make GPIO_UART_DEBUG=2).
+// 0 is errors only, 1 adds opening, starting and closing, 2 adds every span, frame and byte.
+// Level 2 puts several printks on the bottom half for every edge, enough to lose frames
+// at higher baud rates, so it is only for looking at the decoding by hand. The counters
+// (GPIO_UART_IOC_GETCOUNTERS) are the way to see how well a running uart is doing.
+#ifndef GPIO_UART_DEBUG
+#define GPIO_UART_DEBUG 0
+#endif
+
+// Compiles to nothing at all below the level
+#define uartDebug(level, ...) \
+    do \
+    { \
+        if (GPIO_UART_DEBUG >= (level)) \
+        { \
+            printk(KERN_INFO __VA_ARGS__); \
+        } \
+    } while (0)
+
+// The decoding itself, which builds into userspace too
+#include "gpio_uart_core.h"
 
 // Atomic GCC primitive function
 // Sets variable to newValue if it is still equal to oldValue
@@ -50,6 +71,11 @@ MODULE_LICENSE("Dual BSD/GPL");
 // Structure that contains all the state that governs how the GPIO UART works
 typedef struct
 {
+    // Which of the uarts this is, its minor number
+    int index;
+    // Set while someone has the uart open, as only one may at a time
+    int isOpen;
+    
     int rxPin;
     int txPin;
     
@@ -58,10 +84,6 @@ typedef struct
     bool parityBit;
     bool secondStopBit;
     
-    // This is modified as timings are received to attempt to correct for
-    // imperfect oscillator timings on the remote device
-    int modifiedBaudRate;
-    
     // We have two circular buffers for data
     unsigned char rxBuffer[UART_BUFFER_SIZE];
     unsigned char txBuffer[UART_BUFFER_SIZE];
@@ -76,21 +98,8 @@ typedef struct
     int rxBufferTail;
     int txBufferTail;
     
-    // Circular buffer for bit values and scores
-    bool bitValueBuffer[BIT_BUFFER_SIZE];
-    int bitScoreBuffer[BIT_BUFFER_SIZE];
-    // Since this buffer will never be explicitly removed from,
-    // we will only have a tail for it. It will always be "full".
-    int bitBufferTail;
-    
-    // Circular buffer for raw bit time spans and their values. This is where they may be processed and modified,
-    // unlike the plain rawBitTimeBuffer which is strictly for getting these values from the top half of the interrupt handler.
-    long bitSpanTimeBuffer[BIT_SPAN_BUFFER_SIZE];
-    // We also keep the original unmassaged times for comparison
-    long bitSpanOriginalTimeBuffer[BIT_SPAN_BUFFER_SIZE];
-    bool bitSpanValueBuffer[BIT_SPAN_BUFFER_SIZE];
-    // This buffer operates just like the "bitBuffer"
-    int bitSpanBufferTail;
+    // Turns the spans of the rx line into bytes, in the bottom half
+    GpioUartDecoder decoder;
     
     // Circular buffer for communication from the top half to the bottom half of the rxIsr handler.
     // This is necessary so that the bottom half can lock its data without losing data from the top half
@@ -103,7 +112,7 @@ typedef struct
     // The tasklet structure that runs the bottom half of the rx interrupt handling
     struct tasklet_struct rxIsrBottomHalfTasklet;
     
-    // Lock on the processing of bit time data, that is, bitTimeBuffer and all the related buffers
+    // Lock on the processing of bit time data, that is, the decoder
     // This lock makes sure that multiple instances of the bottom half do not execute concurrently
     // and meddle all the data up.
     spinlock_t rxProcessingLock;
@@ -115,98 +124,33 @@ typedef struct
     // The value of the rx pin at the time of the last interrupt
     bool rxLastValue;
     
-    // This timer will schedule the transfer of bytes
-    // That is, a byte or two will be sent every time the timer hits
-    struct timer_list txTimer;
+    // This timer puts the edges on the tx line, one each time it expires, and stops when there is nothing to send
+    struct hrtimer txTimer;
+    // The frame being sent (from makeTxFrame), how many bits it has and the next bit to go out
+    int txFrame;
+    int txFrameBits;
+    int txFrameBit;
+    // When the frame's start bit was due, and how long each of its bits is
+    ktime_t txFrameStart;
+    long txBitDelay;
+    // Set while the timer is not going, for whoever next has bytes to send to start it
+    int isTxIdle;
+    // Held to check isRunning and start the timer in one go, and to clear isRunning,
+    // so no write can start the timer again once a stop has cancelled it
+    spinlock_t txLock;
     
     // A flag that tells whether the uart is currently operating
     bool isRunning;
     
-    // For TESTING
-    int interruptsReceived;
-    int interruptErrors;
-} GpioUart;
-
-// Adds a bit with the value and a score of 0 to the circular bit buffer.
-// No thread-safety stuff in this method itself.
-// Locking should be done separately...
-void addBitWithValue(GpioUart* uart, bool bitValue)
-{
-    int nextTail = (uart->bitBufferTail + 1) % BIT_BUFFER_SIZE;
+    // Readers wait here for bytes to be received, writers for room to be made in the tx buffer
+    wait_queue_head_t rxWait;
+    wait_queue_head_t txWait;
     
-    uart->bitValueBuffer[nextTail] = bitValue;
-    uart->bitScoreBuffer[nextTail] = 0;
-    uart->bitBufferTail = nextTail;
-}
-
-// Index may range from 0 to BIT_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-bool getBitValueAt(GpioUart* uart, int index)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    return uart->bitValueBuffer[(uart->bitBufferTail + 1 + index) % BIT_BUFFER_SIZE];
-}
-
-// Index may range from 0 to BIT_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-int getBitScoreAt(GpioUart* uart, int index)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    return uart->bitScoreBuffer[(uart->bitBufferTail + 1 + index) % BIT_BUFFER_SIZE];
-}
-
-// Index may range from 0 to BIT_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-void setBitScoreAt(GpioUart* uart, int index, int newScore)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    uart->bitScoreBuffer[(uart->bitBufferTail + 1 + index) % BIT_BUFFER_SIZE] = newScore;
-}
-
-// Adds a bit span with the value and time given the circular bit span buffer.
-// No thread-safety stuff in this method itself.
-// Locking should be done separately...
-void addSpanTimeAndValue(GpioUart* uart, long time, bool value)
-{
-    int nextTail = (uart->bitSpanBufferTail + 1) % BIT_SPAN_BUFFER_SIZE;
-    
-    uart->bitSpanValueBuffer[nextTail] = value;
-    uart->bitSpanTimeBuffer[nextTail] = time;
-    uart->bitSpanOriginalTimeBuffer[nextTail] = time;
-    uart->bitSpanBufferTail = nextTail;
-}
-
-// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-bool getSpanValueAt(GpioUart* uart, int index)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    return uart->bitSpanValueBuffer[(uart->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE];
-}
-
-// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-long getSpanTimeAt(GpioUart* uart, int index)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    return uart->bitSpanTimeBuffer[(uart->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE];
-}
-
-// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-long getOriginalSpanTimeAt(GpioUart* uart, int index)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    return uart->bitSpanOriginalTimeBuffer[(uart->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE];
-}
-
-// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
-// Where 0 will retrieve the oldest element.
-void setSpanTimeAt(GpioUart* uart, int index, long newTime)
-{
-    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
-    uart->bitSpanTimeBuffer[(uart->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE] = newTime;
-}
+    // Counted as things happen, the baud rates are filled in when they are asked for.
+    // The top half counts interrupts and raw overruns, the bottom half (under rxProcessingLock)
+    // what it decodes, and writing and the tx timer what they send.
+    GpioUartCounters counters;
+} GpioUart;
 
 // Adds a byte to the circular tx buffer. This method is quasi-thread safe.
 // It is ok for this method and the corresponding removeTxByte method to execute
@@ -226,8 +170,11 @@ void addRawBitTimeAndValue(GpioUart* uart, long time, bool value)
         // if it has already, then that is ok
         // (then the buffer is not really full and this reduces to the else case)
         // (the byte we were going to remove to make more room has already been sent).
-        int nextStart = (nextTail + 1) % UART_BUFFER_SIZE;
-        __sync_bool_compare_and_swap(&uart->rawBitBufferStart, nextTail, nextStart);
+        int nextStart = (nextTail + 1) % RAW_BIT_BUFFER_SIZE;
+        if (__sync_bool_compare_and_swap(&uart->rawBitBufferStart, nextTail, nextStart))
+        {
+            uart->counters.rawOverruns++;
+        }
         
         // We set the tail after the start so that the buffer never appears empty (tail == start)
         // This is safe because the remove function does not modify the tail.
@@ -291,7 +238,10 @@ void addTxByte(GpioUart* uart, unsigned char value)
         // (then the buffer is not really full and this reduces to the else case)
         // (the byte we were going to remove to make more room has already been sent).
         int nextStart = (nextTail + 1) % UART_BUFFER_SIZE;
-        __sync_bool_compare_and_swap(&uart->txBufferStart, nextTail, nextStart);
+        if (__sync_bool_compare_and_swap(&uart->txBufferStart, nextTail, nextStart))
+        {
+            uart->counters.txOverruns++;
+        }
         
         // We set the tail after the start so that the buffer never appears empty (tail == start)
         // This is safe because the remove function does not modify the tail.
@@ -351,7 +301,10 @@ void addRxByte(GpioUart* uart, unsigned char value)
         // (then the buffer is not really full and this reduces to the else case)
         // (the byte we were going to remove to make more room has already been sent).
         int nextStart = (nextTail + 1) % UART_BUFFER_SIZE;
-        __sync_bool_compare_and_swap(&uart->rxBufferStart, nextTail, nextStart);
+        if (__sync_bool_compare_and_swap(&uart->rxBufferStart, nextTail, nextStart))
+        {
+            uart->counters.rxOverruns++;
+        }
         
         // We set the tail after the start so that the buffer never appears empty (tail == start)
         // This is safe because the remove function does not modify the tail.
@@ -393,6 +346,24 @@ int removeRxByte(GpioUart* uart)
     }
 }
 
+// Whether there is nothing to read
+bool isRxEmpty(GpioUart* uart)
+{
+    return uart->rxBufferStart == uart->rxBufferTail;
+}
+
+// Whether another byte written would overrun the tx buffer
+bool isTxFull(GpioUart* uart)
+{
+    return (uart->txBufferTail + 1) % UART_BUFFER_SIZE == uart->txBufferStart;
+}
+
+// Where the decoder gives its bytes
+void rxByteDecoded(void* context, unsigned char value)
+{
+    addRxByte((GpioUart*)context, value);
+}
+
 int uart_init(void);
 void uart_exit(void);
 
@@ -401,6 +372,7 @@ int uart_release(struct inode* inode, struct file* filePointer);
 ssize_t uart_read(struct file* filePointer, char* dataBuffer, size_t dataLength, loff_t* filePosition);
 ssize_t uart_write(struct file* filePointer, const char* dataBuffer, size_t dataLength, loff_t* filePosition);
 long uart_ioctl(struct file* filePointer, unsigned int cmd, unsigned long arg);
+unsigned int uart_poll(struct file* filePointer, poll_table* wait);
 
 module_init(uart_init)
 module_exit(uart_exit)
@@ -411,31 +383,23 @@ struct file_operations uart_operations = {
     .write = uart_write,
     .open = uart_open,
     .release = uart_release,
-    .unlocked_ioctl = uart_ioctl
+    .unlocked_ioctl = uart_ioctl,
+    .poll = uart_poll
 };
 
 //Major Number of the driver, used for linking to a file by linux.
 int majorNumber = 441;
 
-//The number of times this device has been opened
-//Use to keep track of interrupt enabling/disabling
-int deviceOpens = 0;
+//How many uarts there are, given when the module is inserted (insmod gpio_uart.ko instances=3)
+int instances = 2;
+module_param(instances, int, S_IRUGO);
+MODULE_PARM_DESC(instances, "Number of soft uarts, /dev/gpio_uart0 on (at most 8)");
 
-void addTime(struct timespec* time, long nanoseconds)
-{
-    time->tv_nsec += nanoseconds;
-    if (time->tv_nsec < 0)
-    {
-        time->tv_sec += time->tv_nsec / 1000000000L - 1;
-        time->tv_nsec %= 1000000000L;
-        time->tv_nsec += 1000000000L;
-    }
-    else if (time->tv_nsec >= 1000000000L)
-    {
-        time->tv_sec += time->tv_nsec / 1000000000L;
-        time->tv_nsec %= 1000000000L;
-    }
-}
+//Each uart's state, for as long as the module is in.
+//Every uart has its own tasklet and locks, so they only meet in the interrupt handler,
+//which they all share: each rx pin's irq is requested with its own uart as the dev_id,
+//so the handler goes straight to that uart's state with no looking up.
+GpioUart* uarts[GPIO_UART_MAX_INSTANCES];
 
 long timeDifference(const struct timespec* currentTime, const struct timespec* oldTime)
 {
@@ -443,374 +407,77 @@ long timeDifference(const struct timespec* currentTime, const struct timespec* o
              (currentTime->tv_nsec - oldTime->tv_nsec));
 }
 
-void addTimeAndBusyWait(struct timespec* time, long nanoseconds)
-{
-    addTime(time, nanoseconds);
-    struct timespec actualTime;
-    do
-    {
-        get_monotonic_boottime(&actualTime);
-    } while (timespec_compare(time, &actualTime) > 0);
-}
-
 irqreturn_t rxIsr(int irq, void* dev_id, struct pt_regs* regs);
 
-// Holds a GPIO pin to its old value until the needed time has past.
-// Then sets the gpio to a new value and updates the lastBitTime value.
-// Also takes inverting logic into account
-void holdAndSetTx(GpioUart* uart, bool value, struct timespec* lastBitTime, long nanosecondsNeeded)
+// Starts the tx timer if the uart is running, the timer is idle and there is something to send
+void kickTx(GpioUart* uart)
 {
-    addTimeAndBusyWait(lastBitTime, nanosecondsNeeded);
-    gpio_set_value(uart->txPin, uart->invertingLogic ? !value : value);
-}
-
-void txSender(unsigned long argument)
-{
-    GpioUart* uart = (GpioUart*)argument;
-    
-    spinlock_t locker;
-    spin_lock_init(&locker);
-    
-    struct timespec lastBitTime;
-    get_monotonic_boottime(&lastBitTime);
-    
-    // What is the delay for a bit in nanoseconds?
-    long bitDelay = 1000000000L / uart->baudRate;
-    
-    // We can send multiple bytes at once, if it will not take too long.
-    // Let us take up to half a millisecond if our first byte will take less than that
-    // (so we will go as long as necessary to get one byte out)
-    int bitsFrame = 10 + (uart->secondStopBit ? 1 : 0) + (uart->parityBit ? 1 : 0);
-    int bytesToDo = 500000 / bitDelay / bitsFrame;
-    // But at least one byte...
-    bytesToDo = (bytesToDo == 0) ? 1 : bytesToDo;
-    
-    for (int i = 0;i < bytesToDo; i++)
+    spin_lock(&uart->txLock);
+    if (uart->isRunning && uart->txBufferStart != uart->txBufferTail && __sync_bool_compare_and_swap(&uart->isTxIdle, 1, 0))
     {
-        // Have we a byte to send?
-        int byteToSend = removeTxByte(uart);
-        if (byteToSend != -1)
-        {
-            // We use the spinlock to disable interrupts so that we can busy-wait exact timing
-            // TESTING
-            //spin_lock_irqsave(&locker, savedFlags);
-            spin_lock_bh(&locker);
-            
-            // Make sure we have at least the required stop bits before our start bit
-            long stopBitNanoseconds = 50 * bitDelay + (uart->secondStopBit ? bitDelay : 0);
-            
-            // Start bit
-            holdAndSetTx(uart, false, &lastBitTime, stopBitNanoseconds);
-            
-            int bits = byteToSend;
-            int parity = 0;
-            // UART is Least Significant Bit first
-            for (int i = 0;i < 8; i++)
-            {
-                // Keep track of parity
-                parity ^= (bits & 1);
-                
-                // Send the value of the lowest bit
-                holdAndSetTx(uart, bits & 1, &lastBitTime, bitDelay);
-                // Shift out the just-transmitted bit
-
-                bits >>= 1;
-            }
-            
-            // Parity bit
-            if (uart->parityBit)
-            {
-                holdAndSetTx(uart, parity, &lastBitTime, bitDelay);
-            }
-            
-            // Stop bit(s), though we don't wait for them...
-            holdAndSetTx(uart, true, &lastBitTime, bitDelay);
-            
-            // The byte is done!
-            //TESTING
-            //spin_unlock_irqrestore(&locker, savedFlags);
-            spin_unlock_bh(&locker);
-        }
+        // The line has been idle long enough, so the first frame can start now
+        uart->txFrameBit = uart->txFrameBits = 0;
+        hrtimer_start(&uart->txTimer, ktime_get(), HRTIMER_MODE_ABS);
     }
-    
-    // Have it trigger again in a jiffie! =]
-    uart->txTimer.expires = jiffies + 1;
-    add_timer(&uart->txTimer);
-    
-    // Because the receiver rx interrupt only fires on changes, if there are no changes,
-    // the last value will not be registered. We call the interrupt here as well, to get
-    // periodical updates when the value is not actually changing.
-    //TESTING rxIsr(uart->rxPin, uart, NULL);
+    spin_unlock(&uart->txLock);
 }
 
-// Check whether the bit buffer currently holds a valid byte at the location index.
-// If so, we return the value. If not, we return -1.
-int getByteInBitBufferAt(GpioUart* uart, int index)
+// Puts the next edge on the tx line, and sets the timer for the one after.
+// Bits that hold the line where it is need no edge, so a frame takes only as many
+// expiries as it has changes of value, and the rest of the time is the cpu's.
+// Each edge is due at a whole number of bits from the frame's start, so a late
+// expiry only puts its own edge out, not those after it.
+enum hrtimer_restart txEdge(struct hrtimer* timer)
 {
-    // What is the size of a valid frame for us?
-    // We start with at least one stop bit, then a start bit, then 8 data bits, 1 possible parity, then 1 or 2 stop bits
-    int frameSize = 11 + (uart->secondStopBit ? 2 : 0) + (uart->parityBit ? 1 : 0);
+    GpioUart* uart = container_of(timer, GpioUart, txTimer);
+    ktime_t due = hrtimer_get_expires(timer);
     
-    // The very first thing we do is extract the desired bits from the bit buffer
-    // The bit at index is the oldest (chronoligically) of the bits in the buffer being checked.
-    // We want the oldest bit at bit 0 of targetBits, since we want the data bytes to be already in the right order.
-    // The bits come in least significant first time-wise, so we want the oldest data bits in the least significant bits of targetBits.
-    int targetBits = 0;
-    // Go from newest to oldest
-    for (int i = frameSize; i-- > 0;)
+    // The last frame is over (its stop bits held) or there never was one, so on to the next byte
+    if (uart->txFrameBit >= uart->txFrameBits)
     {
-        // Shift existing bits
-        targetBits <<= 1;
-        if (getBitValueAt(uart, index + i))
-        {
-            // This bit is on!
-            targetBits |= 1;
-        }
-    }
-    //printk(KERN_INFO "Checking target bits with value of %d\n", targetBits);
-    
-    // Are the stop bit(s) and start bit in position?
-    
-    // This is the mask of just the stop (high) bits, depending on frame configuration
-    // With one stop bit, we have stop bits at the beginning and end of the frame
-    int stopBitmask = 1 | (1 << (frameSize - 1));
-    
-    // This mask selects all the start and stop bits, depending on frame configuration
-    int startStopBitmask = 0;
-    
-    if (uart->secondStopBit)
-    {
-        // The second and second to last bits are stop bits
-        stopBitmask |= 2 | (1 << (frameSize - 2));
-        // The third bit will be the start bit if there are two stop bits
-        startStopBitmask |= stopBitmask | 4;
-    }
-    else
-    {
-        // The second bit is the start bit
-        startStopBitmask = stopBitmask | 2;
-    }
-    
-    // Now, looking at just these specific bits, are all (and only) the stop bits high?
-    if ((targetBits & startStopBitmask) == stopBitmask)
-    {
-        // The data are bits 2 through 9 or 3 through 10 
-        int dataByte = (targetBits >> (2 + (uart->secondStopBit ? 1 : 0))) & 0xff;
-        
-        // If we have a parity bit, is it correct?
-        if (uart->parityBit)
+        int byteToSend = removeTxByte(uart);
+        if (byteToSend == -1)
         {
-            int parityBitValue = 0;
-            // Parity bit is the second or third to last
-            if (targetBits & (1 << (frameSize - 2 - (uart->secondStopBit ? 1 : 0))))
-            {
-                parityBitValue = 1;
-            }
-            
-            //int bits = dataByte;
-            //int parity = 0;
-            //for (int i = 0;i < 8; i++)
-            //{
-            //    parity ^= (bits & 1);
-            //    bits >>= 1;
-            //}
-            // Quicker parity calculation from http://graphics.stanford.edu/~seander/bithacks.html#ParityParallel
-            int parity = dataByte;
-            parity ^= parity >> 4;
-            parity &= 0xf;
-            parity = (0x6996 >> parity) & 1;
-            
-            if (parityBitValue == parity)
-            {
-                // We have a byte!
-                return dataByte;
-            }
-            else
+            uart->isTxIdle = 1;
+            // A byte written as we found none would otherwise have to wait for the next write
+            __sync_synchronize();
+            if (uart->txBufferStart == uart->txBufferTail || !__sync_bool_compare_and_swap(&uart->isTxIdle, 1, 0))
             {
-                //printf("Parity failed: %d\n", bitBuffer);
+                return HRTIMER_NORESTART;
             }
+            byteToSend = removeTxByte(uart);
         }
-        else
+        // There is room for another byte now, if a writer is waiting for it.
+        // The barrier orders taking the byte before looking for waiters, against a writer
+        // queueing itself before looking for room, so one of us always sees the other.
+        smp_mb();
+        if (waitqueue_active(&uart->txWait))
         {
-            return dataByte;
+            wake_up_interruptible(&uart->txWait);
         }
+        uart->txFrame = makeTxFrame(byteToSend, uart->parityBit, uart->secondStopBit, &uart->txFrameBits);
+        uart->txFrameBit = 0;
+        uart->txFrameStart = due;
+        uart->txBitDelay = 1000000000L / uart->baudRate;
+        uart->counters.bytesSent++;
     }
-    // No byte for us!
-    return -1;
-}
-
-void processSpanTimeAndValue(GpioUart* uart, long spanTime, long originalSpanTime, bool spanValue)
-{
-    // Divide it into bits...
-    
-    // The length of time a single bit should occupy ideally.
-    long bitDelay = 1000000000L / uart->baudRate;
-    
-    // How many bit times have there been?
-    // We round this up to help with slight misalignment, so 0.5 -> 1, 1.5 -> 2
-    long bitNumber = (spanTime + bitDelay / 2) / bitDelay;
-                    
-    // What is the size of a valid frame for us?
-    // We start with one or two stop bits (not technically in the frame), then a start bit, then 8 data bits, 1 possible parity, then 1 or 2 stop bits
-    int frameSize = 11 + (uart->secondStopBit ? 2 : 0) + (uart->parityBit ? 1 : 0);
-    // The base frame size does not include the beginning stop bits, which do not technically belong to the frame.
-    // This base frame size makes more sense to use, if say, you want to go up to the next frame; this is the number of bits away it is.
-    int baseFrameSize = 10 + (uart->secondStopBit ? 1 : 0) + (uart->parityBit ? 1 : 0);
-    
-    // No point in flushing our buffer out with more bits than it holds.
-    bitNumber = (bitNumber > BIT_BUFFER_SIZE) ? BIT_BUFFER_SIZE : bitNumber;
-    
-    // Give out our numbers!
-    printk(KERN_INFO "Processed time: %ld (was %ld) at value: %d -- %d bits\n", spanTime, originalSpanTime, (int)spanValue, (int)bitNumber);
-    
-    // We add in each one at a time...
-    for (int i = 0; i < bitNumber; i++)
-    {
-        // Add the bit to our bit buffer, use either the firstLastBitTime or bitDelay as the time, depending
-        addBitWithValue(uart, spanValue);
-        
-        // There will now be another bit whose UART frame this new bit may have just completed.
-        int newlyCompletedFrameBitIndex = BIT_BUFFER_SIZE - frameSize;
-        // But we must make sure it is a valid bit (score of 0, not -1)
-        if (getBitScoreAt(uart, newlyCompletedFrameBitIndex) == 0 &&
-            getByteInBitBufferAt(uart, newlyCompletedFrameBitIndex) != -1)
-        {
-            // The score of this bit is 1 plus the score of the bit preceding it by exactly one frame
-            // This score gauges how "sure" we can be that a real byte is contained in the frame starting at this bit.
-            // Of course, if the previous frame bit has a score of -1 (meaning invalid) we don't add that
-            int previousFrameBitScore = getBitScoreAt(uart, newlyCompletedFrameBitIndex - baseFrameSize);
-            int newBitScore = 1 + ((previousFrameBitScore != -1) ? previousFrameBitScore : 0);
-            
-            setBitScoreAt(uart, newlyCompletedFrameBitIndex, newBitScore);
-            printk(KERN_INFO "We got a valid frame at %d, scored at %d\n", newlyCompletedFrameBitIndex, newBitScore);
-        }
-        
-        // Only check for a byte at the end of the buffer if we do not have any bits marked with a score of -1
-        // If we do, these bits have already been interpreted as a byte and we want to finish filling up the bit buffer
-        // before we try to look for another byte. (they would be the oldest bits, and contiguous, hence we only check index 0)
-        if (getBitScoreAt(uart, 0) != -1)
-        {
-            int bestScore = 0;
-            int bestScoreIndex = 0;
-            // Check all the oldest entries in the bit buffer for a byte
-            for (int k = 0; k < baseFrameSize; k++)
-            {
-                int score = getBitScoreAt(uart, k);
-                if (score > bestScore)
-                {
-                    bestScore = score;
-                    bestScoreIndex = k;
-                }
-            }
-            
-            // Do we have a byte at all? If so, let us take it!
-            if (bestScore >= 1)
-            {
-                int dataByte = getByteInBitBufferAt(uart, bestScoreIndex);
-                if (dataByte == -1)
-                {
-                    printk(KERN_ERR "Something has gone terribly wrong! Bit buffer corrupt!\n");
-                }
-                else
-                {
-                    addRxByte(uart, dataByte);
-                }
-                
-                // Clear the scores of the frame bits that we read as a bit to invalid (-1), so they can't be interpreted again.
-                // The frame has bits from the base index (the oldest bit) to the newer ones, at higher indexes.
-                for (int k = 0; k < baseFrameSize; k++)
-                {
-                    int index = bestScoreIndex + k;
-                    setBitScoreAt(uart, index, -1);
-                }
-            }
-        }
-    }
-}
-
-// This does span time messaging, but only gives time to spans that are at least at level percent.
-// So if level = 90, only spans at say 190% or 290% of bitDelay, will steal more time.
-// However, if spans with less than 100% will always steal time.
-void relaxSpanTimesAtLevel(GpioUart* uart, int level)
-{
-    // The length of time a single bit should occupy ideally.
-    long bitDelay = 1000000000L / uart->baudRate;
     
-    // printk(KERN_INFO "Now at level %d", level);
+    bool value = (uart->txFrame >> uart->txFrameBit) & 1;
+    gpio_set_value(uart->txPin, uart->invertingLogic ? !value : value);
     
-    // Go through all but the last element in the buffer
-    // Those will either get their turn when more elements are added, or have already.
-    // This way we do not have to worry about going out of index.
-    // We go through them backwards, since we are mostly pulling time from the previous element
-    for (int i = BIT_SPAN_BUFFER_SIZE; i-- > 1;)
+    // How late the edge went out
+    s64 lateNs = ktime_to_ns(ktime_sub(ktime_get(), due));
+    lateNs = (lateNs < 0) ? 0 : lateNs;
+    uart->counters.txEdges++;
+    uart->counters.txLateNs += lateNs;
+    if (lateNs > uart->counters.txMostLateNs)
     {
-        long spanTime = getSpanTimeAt(uart, i);
-        // Do not bother trying to give time to the span if it is very long (> 12 bits worth, the maximum uart frame size)
-        if (spanTime > bitDelay * 12)
-        {
-            continue;
-        }
-        // Do nothing if the span before it (and thus this one, too) is invalid
-        if (getSpanTimeAt(uart, i - 1) != -1)
-        {
-            // Is this span a single bit that has been short changed?
-            // If so, we want to get it to full time
-            // This is independant of our "level" -- it just takes the highest priority
-            // Though this also assumes we do not have false interrupts.
-            if (spanTime < bitDelay)
-            {
-                //printk(KERN_INFO "Victim timespan start: %ld", getSpanTimeAt(uart, i - 1));
-                //printk(KERN_INFO "Thief timespan start: %ld", getSpanTimeAt(uart, i));
-                
-                // We take the loss from the span preceding it. That seems to be where
-                // the losses are from. (this may not hold generally... but does in virtual machine testing)
-                int missing = bitDelay - spanTime;
-                setSpanTimeAt(uart, i - 1, getSpanTimeAt(uart, i - 1) - missing);
-                setSpanTimeAt(uart, i, spanTime + missing);
-                
-                //printk(KERN_INFO "Victim timespan end: %ld", getSpanTimeAt(uart, i - 1));
-                //printk(KERN_INFO "Thief timespan end: %ld", getSpanTimeAt(uart, i));
-            }
-            // Does this span have more than a single bit, but only level% or more of the last bit?
-            else if (spanTime % bitDelay > bitDelay * level / 100)
-            {
-                //printk(KERN_INFO "Victim timespan start: %ld", getSpanTimeAt(uart, i - 1));
-                //printk(KERN_INFO "Thief timespan start: %ld", getSpanTimeAt(uart, i));
-                
-                int missing = bitDelay - (spanTime % bitDelay);
-                setSpanTimeAt(uart, i - 1, getSpanTimeAt(uart, i - 1) - missing);
-                setSpanTimeAt(uart, i, spanTime + missing);
-                
-                //printk(KERN_INFO "Victim timespan end: %ld", getSpanTimeAt(uart, i - 1));
-                //printk(KERN_INFO "Thief timespan end: %ld", getSpanTimeAt(uart, i));
-            }
-        }
+        uart->counters.txMostLateNs = lateNs;
     }
-}
-
-// This takes the spans in the bit span buffer and massages the times around
-// If we have a time with less than a bits worth of time, for example, we can tell
-// that there has been an error, and we pull time from the surrounding spans.
-// We message like this hoping to improve on noisey timings.
-// Since this is always based on original timings, calling it multiple times
-// will allways yield the same result, instead of them stacking.
-void relaxSpanTimes(GpioUart* uart)
-{
-    // Reset all times to the original times
-    /*for (int i = 0; i < BIT_SPAN_BUFFER_SIZE; i++)
-    {
-        setSpanTimeAt(uart, i, getOriginalSpanTimeAt(uart, i));
-    }*/
     
-    // Progressively relax times from levels of 100% down to 50%
-    // This will allow the spans that are more sure (say 90%) to steal from those
-    // that are less sure (say 50%), such that then the 50% one may be out of the game.
-    // 100% is done first because regardless of level, times with less than a single bit
-    // should always win.
-    for (int level = 100; level >= 50; level -= 5)
-    {
-        relaxSpanTimesAtLevel(uart, level);
-    }
+    uart->txFrameBit = nextTxEdge(uart->txFrame, uart->txFrameBits, uart->txFrameBit);
+    hrtimer_set_expires(timer, ktime_add_ns(uart->txFrameStart, (u64)uart->txFrameBit * uart->txBitDelay));
+    return HRTIMER_RESTART;
 }
 
 // The bottom half of the px pin interrupt handler
@@ -822,61 +489,32 @@ void rxIsrBottomHalfFunction(unsigned long data)
     // We do not want two of these bottom halves to run concurrently
     spin_lock(&uart->rxProcessingLock);
     
-    // Process all raw value pairs from the interrupts
+    // Decode all raw value pairs from the interrupts
     bool rawBitValue;
     long rawBitTime;
     while ((rawBitTime = removeRawBitTimeAndValue(uart, &rawBitValue)) != -1)
     {
-        // We take our very raw timings and modify them with our hopefully more correct baud rate
-        // To calibrate this, the modifiedBaudRate is originally the same as the set value.
-        // Every time we get a single bit timing in the range of 75% to 125% of the current modified baud rate,
-        // then we slightly modify our modified baud rate value to incorporate the new timing. The single timing
-        // has a low relative weight to insure that changes happen only "slowly"
-        long bitDelay = 1000000000L / uart->modifiedBaudRate;
-        if (rawBitTime >= bitDelay * 75 / 100 && rawBitTime <= bitDelay * 125 / 100)
-        {
-            long modifiedBitDelay = (bitDelay * 63 + rawBitTime) / 64;
-            uart->modifiedBaudRate = 1000000000L / modifiedBitDelay;
-        }
-        
-        // To keep use of this modified baud rate local, we will normalize our times using it to be
-        // in terms of the original baud rate again. This way the times we record for testing will not
-        // be based on different baud rates over time.
-        printk(KERN_INFO "Raw time (original): %ld at value: %d\n", rawBitTime, (int)rawBitValue);
-        // This will overflow with 32-bit integers... so we use 64-bit.
-        // rawBitTime = rawBitTime * uart->modifiedBaudRate / uart->baudRate;
-        uint64_t intermediateDividend = (uint64_t)rawBitTime * uart->modifiedBaudRate;
-        __div64_32(&intermediateDividend, uart->baudRate);
-        rawBitTime = (long)intermediateDividend;
-        printk(KERN_INFO "Raw time (modified): %ld at value: %d\n", rawBitTime, (int)rawBitValue);
-        
-        //printk(KERN_INFO "Raw time: %ld at value: %d\n", rawBitTime, (int)rawBitValue);
-        
-        
-        // We read out time spans when they are in the second-to-last position.
-        // We do this because when the last position time spans are in the "relaxing" process,
-        // they are not able to steal time. We want our read values to have just had this opportunity.
-        long removedSpanTime = getSpanTimeAt(uart, 1);
-        long removedOriginalSpanTime = getOriginalSpanTimeAt(uart, 1);
-        bool removedSpanValue = getSpanValueAt(uart, 1);
-        
-        // Now we overwrite the oldest values by placing our new ones into the buffer
-        addSpanTimeAndValue(uart, rawBitTime, rawBitValue);
-        
-        // Do the relaxation of time values with our new value.
-        relaxSpanTimes(uart);
-        
-        // Now let the removed time and value be processed into bits if they are valid
-        if (removedSpanTime != -1)
-        {
-            processSpanTimeAndValue(uart, removedSpanTime, removedOriginalSpanTime, removedSpanValue);
-        }
+        decodeSpan(&uart->decoder, rawBitTime, rawBitValue);
+    }
+    
+    // Once auto-baud locks on, the uart sends at that rate too, as the other end's clock is what it is
+    if (uart->decoder.autoBaud.state == GPIO_UART_AUTOBAUD_LOCKED && uart->baudRate != uart->decoder.baudRate)
+    {
+        uart->baudRate = uart->decoder.baudRate;
     }
     
     spin_unlock(&uart->rxProcessingLock);
+    
+    // Once for everything this run decoded, rather than for every byte.
+    // The unlock only releases, so the barrier is what keeps the bytes added ahead of looking for waiters.
+    smp_mb();
+    if (!isRxEmpty(uart) && waitqueue_active(&uart->rxWait))
+    {
+        wake_up_interruptible(&uart->rxWait);
+    }
 }
 
-// Interrupt handler for the rx pin
+// Interrupt handler for the rx pins of all the uarts, dev_id being the uart whose pin it is
 irqreturn_t rxIsr(int irq, void* dev_id, struct pt_regs* regs)
 {
     GpioUart* uart = (GpioUart*)dev_id;
@@ -886,11 +524,11 @@ irqreturn_t rxIsr(int irq, void* dev_id, struct pt_regs* regs)
     // invert the value if need be.
     rxPinValue = uart->invertingLogic ? !rxPinValue : rxPinValue;
 
-    // TESTING
-    uart->interruptsReceived++;
+    // An edge that finds the pin where it already was means one went by without an interrupt
+    uart->counters.interrupts++;
     if (rxPinValue == uart->rxLastValue)
     {
-        uart->interruptErrors++;
+        uart->counters.spuriousInterrupts++;
     }
     //uart->rxLastValue = rxPinValue;
     //return IRQ_HANDLED; 
@@ -973,20 +611,35 @@ int startUart(GpioUart* uart)
     }
     
     // Get the GPIOs for our interrupt handler
-    if (gpio_request(uart->rxPin, "GPIO UART rx") ||
-        gpio_direction_input(uart->rxPin) ||
-        gpio_export(uart->rxPin, 0))
+    // Whatever was got before a failure is given back, and only that
+    if (gpio_request(uart->rxPin, "GPIO UART rx"))
     {
         printk(KERN_ERR "Could not obtain rx GPIO UART pin\n");
         return -1;
     }
+    if (gpio_direction_input(uart->rxPin) ||
+        gpio_export(uart->rxPin, 0))
+    {
+        printk(KERN_ERR "Could not set up rx GPIO UART pin\n");
+        gpio_free(uart->rxPin);
+        return -1;
+    }
     
     // Output initializes high
-    if (gpio_request(uart->txPin, "GPIO UART tx") ||
-        gpio_direction_output(uart->txPin, 1) ||
-        gpio_export(uart->txPin, 0))
+    if (gpio_request(uart->txPin, "GPIO UART tx"))
     {
         printk(KERN_ERR "Could not obtain tx GPIO UART pin\n");
+        gpio_unexport(uart->rxPin);
+        gpio_free(uart->rxPin);
+        return -1;
+    }
+    if (gpio_direction_output(uart->txPin, 1) ||
+        gpio_export(uart->txPin, 0))
+    {
+        printk(KERN_ERR "Could not set up tx GPIO UART pin\n");
+        gpio_free(uart->txPin);
+        gpio_unexport(uart->rxPin);
+        gpio_free(uart->rxPin);
         return -1;
     }
     
@@ -998,18 +651,20 @@ int startUart(GpioUart* uart)
                          (1*IRQF_TRIGGER_RISING) | IRQF_TRIGGER_FALLING, "GPIO UART rx IRQ", uart))
     {
         printk(KERN_ERR "Could not register irq for GPIO UART rx\n");
+        gpio_unexport(uart->txPin);
+        gpio_free(uart->txPin);
+        gpio_unexport(uart->rxPin);
+        gpio_free(uart->rxPin);
         return -1;
     }
 
-    // Register our timer, which will do the job of sending out tx bytes
-    // Have it trigger in a jiffie =]
-    uart->txTimer.expires = jiffies + 1;
-    add_timer(&uart->txTimer);
-    
-    printk(KERN_INFO "Uart Started\n");
+    uartDebug(1, "Uart Started\n");
     
     uart->isRunning = true;
     
+    // Anything written before the start can go out now
+    kickTx(uart);
+    
     return 0;
 }
 
@@ -1017,15 +672,85 @@ int stopUart(GpioUart* uart)
 {
     if (uart->isRunning)
     {
-        // Release everything!
-        gpio_free(uart->rxPin);
-        gpio_free(uart->txPin);
-        free_irq(gpio_to_irq(uart->rxPin), uart);
-        del_timer(&uart->txTimer);
-        
+        // Writes from here on leave the timer be, and any kick already past its check
+        // has started the timer by the time the lock is got, for the cancel to stop
+        spin_lock(&uart->txLock);
         uart->isRunning = false;
+        spin_unlock(&uart->txLock);
+        
+        // Release everything! In the reverse of the order it was got, so neither the
+        // timer nor the interrupt can get at a pin that has been given back
+        hrtimer_cancel(&uart->txTimer);
+        free_irq(gpio_to_irq(uart->rxPin), uart);
+        gpio_free(uart->txPin);
+        gpio_free(uart->rxPin);
+        // Whatever frame was going out is cut short, and the next start begins with a new one
+        uart->isTxIdle = 1;
+    }
+    
+    return 0;
+}
+
+// Starts the decoder over with the uart's settings, and auto-baud training over if it was on
+void configureDecoder(GpioUart* uart)
+{
+    spin_lock_bh(&uart->rxProcessingLock);
+    bool isAutoBaud = uart->decoder.autoBaud.state != GPIO_UART_AUTOBAUD_OFF;
+    initDecoder(&uart->decoder, uart->baudRate, uart->parityBit, uart->secondStopBit, &uart->counters, rxByteDecoded, uart);
+    if (isAutoBaud)
+    {
+        startAutoBaud(&uart->decoder);
+    }
+    spin_unlock_bh(&uart->rxProcessingLock);
+}
+
+// Starts training for the baud rate, or stops, keeping whatever rate there is
+void setAutoBaud(GpioUart* uart, bool isOn)
+{
+    spin_lock_bh(&uart->rxProcessingLock);
+    if (isOn)
+    {
+        startAutoBaud(&uart->decoder);
+    }
+    else
+    {
+        stopAutoBaud(&uart->decoder);
+    }
+    spin_unlock_bh(&uart->rxProcessingLock);
+}
+
+// Copies how auto-baud is doing out to the user
+int getAutoBaud(GpioUart* uart, GpioUartAutoBaud* userAutoBaud)
+{
+    GpioUartAutoBaud autoBaud;
+    
+    spin_lock_bh(&uart->rxProcessingLock);
+    autoBaud = uart->decoder.autoBaud;
+    spin_unlock_bh(&uart->rxProcessingLock);
+    
+    if (copy_to_user(userAutoBaud, &autoBaud, sizeof(autoBaud)))
+    {
+        return -EFAULT;
     }
+    return 0;
+}
+
+// Copies the counters out to the user, those of the bottom half all from the same moment
+int getCounters(GpioUart* uart, GpioUartCounters* userCounters)
+{
+    GpioUartCounters counters;
     
+    // The bottom half is a tasklet, which must not get in while we hold its lock
+    spin_lock_bh(&uart->rxProcessingLock);
+    counters = uart->counters;
+    counters.baudRate = uart->baudRate;
+    counters.modifiedBaudRate = uart->decoder.modifiedBaudRate;
+    spin_unlock_bh(&uart->rxProcessingLock);
+    
+    if (copy_to_user(userCounters, &counters, sizeof(counters)))
+    {
+        return -EFAULT;
+    }
     return 0;
 }
 
@@ -1035,8 +760,14 @@ long uart_ioctl(struct file* filePointer, unsigned int cmd, unsigned long arg)
     switch (cmd)
     {
         case GPIO_UART_IOC_SETBAUD:
+            if ((long)arg <= 0)
+            {
+                return -EINVAL;
+            }
+            // A rate given is the rate to use
+            setAutoBaud(uart, false);
             uart->baudRate = arg;
-            uart->modifiedBaudRate = uart->baudRate;
+            configureDecoder(uart);
             return 0;
         case GPIO_UART_IOC_GETBAUD:
             return uart->baudRate;
@@ -1071,11 +802,13 @@ long uart_ioctl(struct file* filePointer, unsigned int cmd, unsigned long arg)
             return uart->invertingLogic;
         case GPIO_UART_IOC_SETPARITYBIT:
             uart->parityBit = arg;
+            configureDecoder(uart);
             return 0;
         case GPIO_UART_IOC_GETPARITYBIT:
             return uart->parityBit;
         case GPIO_UART_IOC_SETSECONDSTOPBIT:
             uart->secondStopBit = arg;
+            configureDecoder(uart);
             return 0;
         case GPIO_UART_IOC_GETSECONDSTOPBIT:
             return uart->secondStopBit;
@@ -1083,27 +816,82 @@ long uart_ioctl(struct file* filePointer, unsigned int cmd, unsigned long arg)
             return startUart(uart);
         case GPIO_UART_IOC_STOP:
             return stopUart(uart);
+        case GPIO_UART_IOC_GETCOUNTERS:
+            return getCounters(uart, (GpioUartCounters*)arg);
+        case GPIO_UART_IOC_SETAUTOBAUD:
+            setAutoBaud(uart, arg != 0);
+            return 0;
+        case GPIO_UART_IOC_GETAUTOBAUD:
+            return getAutoBaud(uart, (GpioUartAutoBaud*)arg);
     }
     printk(KERN_ERR "Uart IOCTL unknown, not %d or similar\n", GPIO_UART_IOC_START);
     return -ENOTTY;
 }
 
+void freeUarts(void)
+{
+    for (int i = 0; i < GPIO_UART_MAX_INSTANCES; i++)
+    {
+        if (uarts[i])
+        {
+            stopUart(uarts[i]);
+            // Whether or not it was running, the timer must not go off on freed memory
+            hrtimer_cancel(&uarts[i]->txTimer);
+            tasklet_kill(&uarts[i]->rxIsrBottomHalfTasklet);
+            kfree(uarts[i]);
+            uarts[i] = NULL;
+        }
+    }
+}
+
 int uart_init(void) {
+    if (instances < 1 || instances > GPIO_UART_MAX_INSTANCES)
+    {
+        printk(KERN_ERR "GPIO UART Device: Cannot have %d uarts, only 1 to %d\n", instances, GPIO_UART_MAX_INSTANCES);
+        return -EINVAL;
+    }
+    
+    // Each uart is set up once here, and given its defaults each time it is opened
+    for (int i = 0; i < instances; i++)
+    {
+        // GFP_KERNEL for an allocation that can take its time
+        GpioUart* uart = kmalloc(sizeof(GpioUart), GFP_KERNEL);
+        if (!uart)
+        {
+            freeUarts();
+            return -ENOMEM;
+        }
+        uart->index = i;
+        uart->isOpen = 0;
+        uart->isRunning = false;
+        tasklet_init(&uart->rxIsrBottomHalfTasklet, rxIsrBottomHalfFunction, (unsigned long)uart);
+        spin_lock_init(&uart->rxProcessingLock);
+        spin_lock_init(&uart->txLock);
+        hrtimer_init(&uart->txTimer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+        uart->txTimer.function = txEdge;
+        uart->isTxIdle = 1;
+        init_waitqueue_head(&uart->rxWait);
+        init_waitqueue_head(&uart->txWait);
+        uarts[i] = uart;
+    }
+    
     //Register the device
     int result = register_chrdev(majorNumber, "gpio_uart", &uart_operations);
     if (result < 0) {
         printk(
             KERN_ERR "GPIO UART Device: Cannot obtain major number %d\n", majorNumber);
+        freeUarts();
         return result;
     }
     
-    printk(KERN_INFO "Inserting gpio_uart module\n");
+    printk(KERN_INFO "Inserting gpio_uart module with %d uarts\n", instances);
     return 0;
 }
 
 void uart_exit(void) {
     //Unregister the device
     unregister_chrdev(majorNumber, "gpio_uart");
+    freeUarts();
     
     printk(KERN_INFO "Removing gpio_uart module\n");
 }
@@ -1111,19 +899,21 @@ void uart_exit(void) {
 
 int uart_open(struct inode* inode, struct file* filePointer)
 {
-    // Allocate memory for the GpioUart structure
-    // GFP_KERNEL for an allocation that can take its time
-    filePointer->private_data = kmalloc(sizeof(GpioUart), GFP_KERNEL);
-    if (!filePointer->private_data)
+    // The minor number picks the uart
+    int index = iminor(inode);
+    if (index >= instances)
     {
-        // Failed to open the uart... No memory!
-        return -ENOMEM;
+        return -ENODEV;
     }
+    GpioUart* uart = uarts[index];
+    if (!__sync_bool_compare_and_swap(&uart->isOpen, 0, 1))
+    {
+        return -EBUSY;
+    }
+    filePointer->private_data = uart;
     
     // SO MUCH INITIALIZATION!!!
-    GpioUart* uart = (GpioUart*)filePointer->private_data;
     // Defaults!
-    uart->isRunning = false;
     uart->rxPin = -1;
     uart->txPin = -1;
     uart->baudRate = 9600;
@@ -1133,33 +923,13 @@ int uart_open(struct inode* inode, struct file* filePointer)
     uart->rxBufferStart = uart->rxBufferTail = 0;
     uart->txBufferStart = uart->txBufferTail = 0;
     
-    uart->modifiedBaudRate = uart->baudRate;
-    
-    uart->bitBufferTail = 0;
-    uart->bitSpanBufferTail = 0;
     uart->rawBitBufferStart = uart->rawBitBufferTail = 0;
-    tasklet_init(&uart->rxIsrBottomHalfTasklet, rxIsrBottomHalfFunction, (unsigned long)uart);
-    spin_lock_init(&uart->rxProcessingLock);
     
-    // Prefill the bitScoreBuffer with -1 values to indicate none of the bits in it are valid
-    // Also prefill the bitValueBuffer with 1/true values (since the line held high is inactive)
-    // And just for fun (and prudence), the times to -1...
-    for (int i = 0; i < BIT_BUFFER_SIZE; i++)
-    {
-        uart->bitScoreBuffer[i] = -1;
-        uart->bitValueBuffer[i] = true;
-    }
+    memset(&uart->counters, 0, sizeof(uart->counters));
+    initDecoder(&uart->decoder, uart->baudRate, uart->parityBit, uart->secondStopBit, &uart->counters, rxByteDecoded, uart);
     
-    // Prefill the bit span buffer times to -1, to indicate invalid.
+    // Prefill the raw times to -1, to indicate invalid.
     // The bools to "-1" not really a bool value, for debugging help
-    for (int i = 0; i < BIT_SPAN_BUFFER_SIZE; i++)
-    {
-        uart->bitSpanTimeBuffer[i] = -1;
-        uart->bitSpanOriginalTimeBuffer[i] = -1;
-        uart->bitSpanValueBuffer[i] = -1;
-    }
-    
-    // Same as above for these values
     for (int i = 0; i < RAW_BIT_BUFFER_SIZE; i++)
     {
         uart->rawBitTimeBuffer[i] = -1;
@@ -1168,16 +938,8 @@ int uart_open(struct inode* inode, struct file* filePointer)
     
     get_monotonic_boottime(&uart->rxLastInterruptTime);
     uart->rxLastValue = true; // Line should default high (unused)
-    
-    init_timer(&uart->txTimer);
-    uart->txTimer.function = txSender;
-    uart->txTimer.data = (unsigned long)uart;
    
-    // TESTING
-    uart->interruptsReceived = 0;
-    uart->interruptErrors = 0;
- 
-    printk(KERN_INFO "Uart opened");
+    uartDebug(1, "Uart %d opened\n", uart->index);
     
     return 0;
 }
@@ -1189,18 +951,16 @@ int uart_release(struct inode* inode, struct file* filePointer)
     // Make sure to stop it!
     stopUart(uart);
    
-    // TESTING
-    printk(KERN_INFO "Time per bit (original): %ld\n", 1000000000L / uart->baudRate);
-    printk(KERN_INFO "Time per bit (modified): %ld\n", 1000000000L / uart->modifiedBaudRate);
-    printk(KERN_INFO "We have %d interrupts at end!\n", uart->interruptsReceived);
-    printk(KERN_INFO "We have %d interrupt errors at end!\n",uart->interruptErrors);
+    uartDebug(1, "Time per bit (original): %ld\n", 1000000000L / uart->baudRate);
+    uartDebug(1, "Time per bit (modified): %ld\n", 1000000000L / uart->decoder.modifiedBaudRate);
+    uartDebug(1, "We have %llu interrupts at end, %llu spurious\n",
+              (unsigned long long)uart->counters.interrupts, (unsigned long long)uart->counters.spuriousInterrupts);
  
-    // Release the memory
-    kfree(filePointer->private_data);
     // Just for extra safety...
     filePointer->private_data = NULL;
+    uart->isOpen = 0;
     
-    printk(KERN_INFO "Uart closed");
+    uartDebug(1, "Uart %d closed\n", uart->index);
     
     return 0;
 }
@@ -1209,22 +969,44 @@ ssize_t uart_read(struct file* filePointer, char* dataBuffer, size_t dataLength,
 {
     GpioUart* uart = (GpioUart*)filePointer->private_data;
     
-    // Copy byte by byte
-    for (int i = 0;i < dataLength; i++)
+    // With nothing received yet, wait for a byte, unless the reader would rather not.
+    // Another reader can take the bytes between our wake and the copy, so this goes
+    // around until it has one, as returning 0 would look like the end of the file
+    int i = 0;
+    while (i == 0 && dataLength > 0)
     {
-        int value = removeRxByte(uart);
-        if (value == -1)
+        if (isRxEmpty(uart))
         {
-            // No more bytes to copy...
-            return i;
+            if (filePointer->f_flags & O_NONBLOCK)
+            {
+                return -EAGAIN;
+            }
+            if (wait_event_interruptible(uart->rxWait, !isRxEmpty(uart)))
+            {
+                return -ERESTARTSYS;
+            }
         }
-        unsigned char byteValue = value;
         
-        printk(KERN_INFO "Byte %d transferred to user.\n", byteValue);
-        copy_to_user(dataBuffer + i, &byteValue, 1);
+        // Copy byte by byte, as many as there are
+        for (;i < dataLength; i++)
+        {
+            int value = removeRxByte(uart);
+            if (value == -1)
+            {
+                // No more bytes to copy...
+                break;
+            }
+            unsigned char byteValue = value;
+            
+            uartDebug(2, "Byte %d transferred to user.\n", byteValue);
+            if (copy_to_user(dataBuffer + i, &byteValue, 1))
+            {
+                return -EFAULT;
+            }
+        }
     }
     
-    return dataLength;
+    return i;
 }
 
 ssize_t uart_write(struct file* filePointer, const char* dataBuffer, size_t dataLength, loff_t* filePosition)
@@ -1232,14 +1014,61 @@ ssize_t uart_write(struct file* filePointer, const char* dataBuffer, size_t data
     GpioUart* uart = (GpioUart*)filePointer->private_data;
     
     // Copy byte by byte
-    for (int i = 0;i < dataLength; i++)
+    int i;
+    for (i = 0;i < dataLength; i++)
     {
+        // Waiting for room rather than overrunning what is still to go out
+        if (isTxFull(uart))
+        {
+            if (filePointer->f_flags & O_NONBLOCK)
+            {
+                break;
+            }
+            kickTx(uart);
+            if (wait_event_interruptible(uart->txWait, !isTxFull(uart)))
+            {
+                // Whatever went in before the signal is still written
+                if (i == 0)
+                {
+                    return -ERESTARTSYS;
+                }
+                break;
+            }
+        }
         unsigned char byteValue;
-        copy_from_user(&byteValue, dataBuffer, 1);
-        printk(KERN_INFO "Byte %d transferred from user.\n", byteValue);
+        if (copy_from_user(&byteValue, dataBuffer + i, 1))
+        {
+            break;
+        }
+        uartDebug(2, "Byte %d transferred from user.\n", byteValue);
         addTxByte(uart, byteValue);
     }
     
-    return dataLength;
+    kickTx(uart);
+    
+    if (i == 0 && dataLength > 0)
+    {
+        return (filePointer->f_flags & O_NONBLOCK) ? -EAGAIN : -EFAULT;
+    }
+    return i;
 }
 
+// Readable while there are received bytes, writable while the tx buffer has room
+unsigned int uart_poll(struct file* filePointer, poll_table* wait)
+{
+    GpioUart* uart = (GpioUart*)filePointer->private_data;
+    unsigned int mask = 0;
+    
+    poll_wait(filePointer, &uart->rxWait, wait);
+    poll_wait(filePointer, &uart->txWait, wait);
+    
+    if (!isRxEmpty(uart))
+    {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    if (!isTxFull(uart))
+    {
+        mask |= POLLOUT | POLLWRNORM;
+    }
+    return mask;
+}
@@ -1,10 +1,60 @@
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 #ifndef GPIO_UART_H
 #define GPIO_UART_H
 
 #define GPIO_UART_IOC_MAGIC '-'
 
+// What a uart has been doing since it was opened
+typedef struct
+{
+    // Edges on the rx pin, and those that found the pin already at its new value, so an edge was missed
+    __u64 interrupts;
+    __u64 spuriousInterrupts;
+    // Spans between edges turned into bits
+    __u64 spansProcessed;
+    // Bit alignments that frame correctly, start and stop bits (and parity) right. Every byte
+    // received is one of them, but a byte usually lines up more than one way, so there are more of these.
+    __u64 candidateFrames;
+    // Bytes taken from the best scored of those frames
+    __u64 bytesReceived;
+    // Frames that were right but lost out to better scored frames around them, and were never taken
+    __u64 scoreFailures;
+    // Edges, received bytes and bytes to send thrown away because their buffer was full
+    __u64 rawOverruns;
+    __u64 rxOverruns;
+    __u64 txOverruns;
+    __u64 bytesSent;
+    // Edges put on the tx line, and how many nanoseconds after they were due they were put there,
+    // in all and at the most, which is how accurately the uart sends
+    __u64 txEdges;
+    __u64 txLateNs;
+    __u64 txMostLateNs;
+    // The baud rate set, and the rate the receiver has drifted to following the bits that arrive
+    __s32 baudRate;
+    __s32 modifiedBaudRate;
+} GpioUartCounters;
+
+// Where a uart's auto-baud has got to
+#define GPIO_UART_AUTOBAUD_OFF 0
+#define GPIO_UART_AUTOBAUD_TRAINING 1
+#define GPIO_UART_AUTOBAUD_LOCKED 2
+
+// How the uart's auto-baud is doing
+typedef struct
+{
+    // One of GPIO_UART_AUTOBAUD_OFF, _TRAINING or _LOCKED
+    __s32 state;
+    // The rate the last training came to, and the percentage of its spans that were a whole
+    // number of bits at that rate. It locks on once that is high enough.
+    __s32 estimatedBaudRate;
+    __s32 confidence;
+    // Spans taken so far by the training going on, and trainings thrown out for too little confidence
+    __s32 trainingSpans;
+    __s32 failedTrainings;
+} GpioUartAutoBaud;
+
 // Set the baud rate of the uart
 #define GPIO_UART_IOC_SETBAUD _IO(GPIO_UART_IOC_MAGIC, 0)
 // Get the baud rate of the uart
@@ -42,5 +92,14 @@
 // Stops the uart, allowing settings to be changed
 #define GPIO_UART_IOC_STOP _IO(GPIO_UART_IOC_MAGIC, 13)
 
+// Copies the uart's GpioUartCounters to the pointer given
+#define GPIO_UART_IOC_GETCOUNTERS _IOR(GPIO_UART_IOC_MAGIC, 14, GpioUartCounters)
+
+// Non-zero to work the baud rate out from what arrives, and lock on to it, 0 to keep the rate there is.
+// Nothing is received while it trains. Setting the baud rate turns it off, changing the frame settings starts it over.
+#define GPIO_UART_IOC_SETAUTOBAUD _IO(GPIO_UART_IOC_MAGIC, 15)
+// Copies the uart's GpioUartAutoBaud to the pointer given
+#define GPIO_UART_IOC_GETAUTOBAUD _IOR(GPIO_UART_IOC_MAGIC, 16, GpioUartAutoBaud)
+
 
 #endif
\ No newline at end of file
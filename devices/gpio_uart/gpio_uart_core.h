@@ -0,0 +1,764 @@
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <asm/div64.h>
+#else
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#endif
+#include "gpio_uart.h"
+
+#ifndef GPIO_UART_CORE_H
+#define GPIO_UART_CORE_H
+
+// The decoding of the rx line, from the time spans between its edges to bytes,
+// and the framing of bytes into the edges of the tx line.
+//
+// This is everything the bottom half of the rx interrupt does once it has the spans, with no
+// locking, gpio or time of its own, so that it builds both into the module and into userspace
+// programs such as gpioUartHarness, which can try it on made up signals as fast as it runs.
+// Whoever includes it looks after the locking: one span at a time per decoder.
+//
+// Define uartDebug(level, ...) before including this to hear about every span and frame.
+
+#ifndef uartDebug
+#define uartDebug(level, ...)
+#endif
+
+#ifdef __KERNEL__
+#define gpioUartCoreError(...) printk_ratelimited(KERN_ERR __VA_ARGS__)
+#else
+#define gpioUartCoreError(...) fprintf(stderr, __VA_ARGS__)
+#endif
+
+//#define BIT_BUFFER_SIZE 192
+#define BIT_BUFFER_SIZE 22
+
+// Make this buffer fairly small, so that values do not get
+// stuck in here for too long, but big enough to allow some interesting
+// moving around of the time values.
+#define BIT_SPAN_BUFFER_SIZE 5
+
+// Auto-baud bins the spans it trains on by length, 16 bins to an octave (about 4% wide) from
+// 256 ns up to 16.7 ms, which is from a single bit at 3.9 Mbaud to a whole frame at 1200 baud.
+#define AUTO_BAUD_LOWEST_OCTAVE 8
+#define AUTO_BAUD_OCTAVES 16
+#define AUTO_BAUD_BINS (AUTO_BAUD_OCTAVES * 16)
+// Spans to a training, about 40 bytes worth
+#define AUTO_BAUD_TRAINING_SPANS 200
+// Percent of the spans that have to be a whole number of bits at the rate found for it to lock on
+#define AUTO_BAUD_MIN_CONFIDENCE 80
+
+// All the state of decoding one rx line
+typedef struct
+{
+    int baudRate;
+    bool parityBit;
+    bool secondStopBit;
+    
+    // This is modified as timings are received to attempt to correct for
+    // imperfect oscillator timings on the remote device
+    int modifiedBaudRate;
+    
+    // Circular buffer for bit values and scores
+    bool bitValueBuffer[BIT_BUFFER_SIZE];
+    int bitScoreBuffer[BIT_BUFFER_SIZE];
+    // Since this buffer will never be explicitly removed from,
+    // we will only have a tail for it. It will always be "full".
+    int bitBufferTail;
+    
+    // Circular buffer for raw bit time spans and their values. This is where they may be processed and modified,
+    // unlike the spans straight from the interrupts, which are only being passed along.
+    long bitSpanTimeBuffer[BIT_SPAN_BUFFER_SIZE];
+    // We also keep the original unmassaged times for comparison
+    long bitSpanOriginalTimeBuffer[BIT_SPAN_BUFFER_SIZE];
+    bool bitSpanValueBuffer[BIT_SPAN_BUFFER_SIZE];
+    // This buffer operates just like the "bitBuffer"
+    int bitSpanBufferTail;
+    
+    // Given every byte decoded, along with the context
+    void (*byteReceived)(void* context, unsigned char value);
+    void* context;
+    
+    // Where the spans, frames, bytes and score failures are counted
+    GpioUartCounters* counters;
+    
+    // While auto-baud trains, the spans are only binned by length, not decoded, with the number
+    // of spans in each bin and the sum of their times
+    GpioUartAutoBaud autoBaud;
+    uint16_t autoBaudCounts[AUTO_BAUD_BINS];
+    uint64_t autoBaudSums[AUTO_BAUD_BINS];
+} GpioUartDecoder;
+
+// Empties the bit and span buffers, so what is decoded next starts with nothing before it
+static inline void clearDecoder(GpioUartDecoder* decoder)
+{
+    decoder->bitBufferTail = 0;
+    decoder->bitSpanBufferTail = 0;
+    
+    // Prefill the bitScoreBuffer with -1 values to indicate none of the bits in it are valid
+    // Also prefill the bitValueBuffer with 1/true values (since the line held high is inactive)
+    for (int i = 0; i < BIT_BUFFER_SIZE; i++)
+    {
+        decoder->bitScoreBuffer[i] = -1;
+        decoder->bitValueBuffer[i] = true;
+    }
+    
+    // Prefill the bit span buffer times to -1, to indicate invalid.
+    // The bools to "-1" not really a bool value, for debugging help
+    for (int i = 0; i < BIT_SPAN_BUFFER_SIZE; i++)
+    {
+        decoder->bitSpanTimeBuffer[i] = -1;
+        decoder->bitSpanOriginalTimeBuffer[i] = -1;
+        decoder->bitSpanValueBuffer[i] = -1;
+    }
+}
+
+// Starts a decoder over for the frame settings given, with nothing received.
+// Bytes go to byteReceived(context, byte), and what is decoded is added to the counters.
+static inline void initDecoder(GpioUartDecoder* decoder, int baudRate, bool parityBit, bool secondStopBit,
+                               GpioUartCounters* counters, void (*byteReceived)(void*, unsigned char), void* context)
+{
+    decoder->baudRate = baudRate;
+    decoder->parityBit = parityBit;
+    decoder->secondStopBit = secondStopBit;
+    decoder->modifiedBaudRate = baudRate;
+    decoder->byteReceived = byteReceived;
+    decoder->context = context;
+    decoder->counters = counters;
+    
+    decoder->autoBaud.state = GPIO_UART_AUTOBAUD_OFF;
+    decoder->autoBaud.estimatedBaudRate = 0;
+    decoder->autoBaud.confidence = 0;
+    decoder->autoBaud.trainingSpans = 0;
+    decoder->autoBaud.failedTrainings = 0;
+    
+    clearDecoder(decoder);
+}
+
+// Adds a bit with the value and a score of 0 to the circular bit buffer.
+// No thread-safety stuff in this method itself.
+// Locking should be done separately...
+static inline void addBitWithValue(GpioUartDecoder* decoder, bool bitValue)
+{
+    int nextTail = (decoder->bitBufferTail + 1) % BIT_BUFFER_SIZE;
+    
+    // The oldest bit is about to go; if it still starts a scored frame, that frame was never taken
+    if (decoder->bitScoreBuffer[nextTail] > 0)
+    {
+        decoder->counters->scoreFailures++;
+    }
+    
+    decoder->bitValueBuffer[nextTail] = bitValue;
+    decoder->bitScoreBuffer[nextTail] = 0;
+    decoder->bitBufferTail = nextTail;
+}
+
+// Index may range from 0 to BIT_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline bool getBitValueAt(GpioUartDecoder* decoder, int index)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    return decoder->bitValueBuffer[(decoder->bitBufferTail + 1 + index) % BIT_BUFFER_SIZE];
+}
+
+// Index may range from 0 to BIT_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline int getBitScoreAt(GpioUartDecoder* decoder, int index)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    return decoder->bitScoreBuffer[(decoder->bitBufferTail + 1 + index) % BIT_BUFFER_SIZE];
+}
+
+// Index may range from 0 to BIT_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline void setBitScoreAt(GpioUartDecoder* decoder, int index, int newScore)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    decoder->bitScoreBuffer[(decoder->bitBufferTail + 1 + index) % BIT_BUFFER_SIZE] = newScore;
+}
+
+// Adds a bit span with the value and time given the circular bit span buffer.
+// No thread-safety stuff in this method itself.
+// Locking should be done separately...
+static inline void addSpanTimeAndValue(GpioUartDecoder* decoder, long time, bool value)
+{
+    int nextTail = (decoder->bitSpanBufferTail + 1) % BIT_SPAN_BUFFER_SIZE;
+    
+    decoder->bitSpanValueBuffer[nextTail] = value;
+    decoder->bitSpanTimeBuffer[nextTail] = time;
+    decoder->bitSpanOriginalTimeBuffer[nextTail] = time;
+    decoder->bitSpanBufferTail = nextTail;
+}
+
+// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline bool getSpanValueAt(GpioUartDecoder* decoder, int index)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    return decoder->bitSpanValueBuffer[(decoder->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE];
+}
+
+// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline long getSpanTimeAt(GpioUartDecoder* decoder, int index)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    return decoder->bitSpanTimeBuffer[(decoder->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE];
+}
+
+// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline long getOriginalSpanTimeAt(GpioUartDecoder* decoder, int index)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    return decoder->bitSpanOriginalTimeBuffer[(decoder->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE];
+}
+
+// Index may range from 0 to BIT_SPAN_BUFFER_SIZE - 1
+// Where 0 will retrieve the oldest element.
+static inline void setSpanTimeAt(GpioUartDecoder* decoder, int index, long newTime)
+{
+    // The tail + 1 is the next element to be overwritten, hence the oldest. They get slowly newer from there.
+    decoder->bitSpanTimeBuffer[(decoder->bitSpanBufferTail + 1 + index) % BIT_SPAN_BUFFER_SIZE] = newTime;
+}
+
+// Check whether the bit buffer currently holds a valid byte at the location index.
+// If so, we return the value. If not, we return -1.
+static inline int getByteInBitBufferAt(GpioUartDecoder* decoder, int index)
+{
+    // What is the size of a valid frame for us?
+    // We start with at least one stop bit, then a start bit, then 8 data bits, 1 possible parity, then 1 or 2 stop bits
+    int frameSize = 11 + (decoder->secondStopBit ? 2 : 0) + (decoder->parityBit ? 1 : 0);
+    
+    // The very first thing we do is extract the desired bits from the bit buffer
+    // The bit at index is the oldest (chronoligically) of the bits in the buffer being checked.
+    // We want the oldest bit at bit 0 of targetBits, since we want the data bytes to be already in the right order.
+    // The bits come in least significant first time-wise, so we want the oldest data bits in the least significant bits of targetBits.
+    int targetBits = 0;
+    // Go from newest to oldest
+    for (int i = frameSize; i-- > 0;)
+    {
+        // Shift existing bits
+        targetBits <<= 1;
+        if (getBitValueAt(decoder, index + i))
+        {
+            // This bit is on!
+            targetBits |= 1;
+        }
+    }
+    //printk(KERN_INFO "Checking target bits with value of %d\n", targetBits);
+    
+    // Are the stop bit(s) and start bit in position?
+    
+    // This is the mask of just the stop (high) bits, depending on frame configuration
+    // With one stop bit, we have stop bits at the beginning and end of the frame
+    int stopBitmask = 1 | (1 << (frameSize - 1));
+    
+    // This mask selects all the start and stop bits, depending on frame configuration
+    int startStopBitmask = 0;
+    
+    if (decoder->secondStopBit)
+    {
+        // The second and second to last bits are stop bits
+        stopBitmask |= 2 | (1 << (frameSize - 2));
+        // The third bit will be the start bit if there are two stop bits
+        startStopBitmask |= stopBitmask | 4;
+    }
+    else
+    {
+        // The second bit is the start bit
+        startStopBitmask = stopBitmask | 2;
+    }
+    
+    // Now, looking at just these specific bits, are all (and only) the stop bits high?
+    if ((targetBits & startStopBitmask) == stopBitmask)
+    {
+        // The data are bits 2 through 9 or 3 through 10 
+        int dataByte = (targetBits >> (2 + (decoder->secondStopBit ? 1 : 0))) & 0xff;
+        
+        // If we have a parity bit, is it correct?
+        if (decoder->parityBit)
+        {
+            int parityBitValue = 0;
+            // Parity bit is the second or third to last
+            if (targetBits & (1 << (frameSize - 2 - (decoder->secondStopBit ? 1 : 0))))
+            {
+                parityBitValue = 1;
+            }
+            
+            //int bits = dataByte;
+            //int parity = 0;
+            //for (int i = 0;i < 8; i++)
+            //{
+            //    parity ^= (bits & 1);
+            //    bits >>= 1;
+            //}
+            // Quicker parity calculation from http://graphics.stanford.edu/~seander/bithacks.html#ParityParallel
+            int parity = dataByte;
+            parity ^= parity >> 4;
+            parity &= 0xf;
+            parity = (0x6996 >> parity) & 1;
+            
+            if (parityBitValue == parity)
+            {
+                // We have a byte!
+                return dataByte;
+            }
+            else
+            {
+                //printf("Parity failed: %d\n", bitBuffer);
+            }
+        }
+        else
+        {
+            return dataByte;
+        }
+    }
+    // No byte for us!
+    return -1;
+}
+
+static inline void processSpanTimeAndValue(GpioUartDecoder* decoder, long spanTime, long originalSpanTime, bool spanValue)
+{
+    // Divide it into bits...
+    
+    // The length of time a single bit should occupy ideally.
+    long bitDelay = 1000000000L / decoder->baudRate;
+    
+    // How many bit times have there been?
+    // We round this up to help with slight misalignment, so 0.5 -> 1, 1.5 -> 2
+    long bitNumber = (spanTime + bitDelay / 2) / bitDelay;
+                    
+    // What is the size of a valid frame for us?
+    // We start with one or two stop bits (not technically in the frame), then a start bit, then 8 data bits, 1 possible parity, then 1 or 2 stop bits
+    int frameSize = 11 + (decoder->secondStopBit ? 2 : 0) + (decoder->parityBit ? 1 : 0);
+    // The base frame size does not include the beginning stop bits, which do not technically belong to the frame.
+    // This base frame size makes more sense to use, if say, you want to go up to the next frame; this is the number of bits away it is.
+    int baseFrameSize = 10 + (decoder->secondStopBit ? 1 : 0) + (decoder->parityBit ? 1 : 0);
+    
+    // No point in flushing our buffer out with more bits than it holds.
+    bitNumber = (bitNumber > BIT_BUFFER_SIZE) ? BIT_BUFFER_SIZE : bitNumber;
+    
+    decoder->counters->spansProcessed++;
+    uartDebug(2, "Processed time: %ld (was %ld) at value: %d -- %d bits\n", spanTime, originalSpanTime, (int)spanValue, (int)bitNumber);
+    
+    // We add in each one at a time...
+    for (int i = 0; i < bitNumber; i++)
+    {
+        // Add the bit to our bit buffer, use either the firstLastBitTime or bitDelay as the time, depending
+        addBitWithValue(decoder, spanValue);
+        
+        // There will now be another bit whose UART frame this new bit may have just completed.
+        int newlyCompletedFrameBitIndex = BIT_BUFFER_SIZE - frameSize;
+        // But we must make sure it is a valid bit (score of 0, not -1)
+        if (getBitScoreAt(decoder, newlyCompletedFrameBitIndex) == 0 &&
+            getByteInBitBufferAt(decoder, newlyCompletedFrameBitIndex) != -1)
+        {
+            // The score of this bit is 1 plus the score of the bit preceding it by exactly one frame
+            // This score gauges how "sure" we can be that a real byte is contained in the frame starting at this bit.
+            // Of course, if the previous frame bit has a score of -1 (meaning invalid) we don't add that.
+            // With a parity or second stop bit, a whole frame back is older than the buffer holds,
+            // which is as good as invalid.
+            int previousFrameBitScore = (newlyCompletedFrameBitIndex >= baseFrameSize) ?
+                getBitScoreAt(decoder, newlyCompletedFrameBitIndex - baseFrameSize) : -1;
+            int newBitScore = 1 + ((previousFrameBitScore != -1) ? previousFrameBitScore : 0);
+            
+            setBitScoreAt(decoder, newlyCompletedFrameBitIndex, newBitScore);
+            decoder->counters->candidateFrames++;
+            uartDebug(2, "We got a valid frame at %d, scored at %d\n", newlyCompletedFrameBitIndex, newBitScore);
+        }
+        
+        // Only check for a byte at the end of the buffer if we do not have any bits marked with a score of -1
+        // If we do, these bits have already been interpreted as a byte and we want to finish filling up the bit buffer
+        // before we try to look for another byte. (they would be the oldest bits, and contiguous, hence we only check index 0)
+        if (getBitScoreAt(decoder, 0) != -1)
+        {
+            int bestScore = 0;
+            int bestScoreIndex = 0;
+            // Check all the oldest entries in the bit buffer for a byte
+            for (int k = 0; k < baseFrameSize; k++)
+            {
+                int score = getBitScoreAt(decoder, k);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestScoreIndex = k;
+                }
+            }
+            
+            // Do we have a byte at all? If so, let us take it!
+            if (bestScore >= 1)
+            {
+                int dataByte = getByteInBitBufferAt(decoder, bestScoreIndex);
+                if (dataByte == -1)
+                {
+                    gpioUartCoreError("Something has gone terribly wrong! Bit buffer corrupt!\n");
+                }
+                else
+                {
+                    decoder->byteReceived(decoder->context, dataByte);
+                    decoder->counters->bytesReceived++;
+                }
+                
+                // Clear the scores of the frame bits that we read as a bit to invalid (-1), so they can't be interpreted again.
+                // The frame has bits from the base index (the oldest bit) to the newer ones, at higher indexes.
+                for (int k = 0; k < baseFrameSize; k++)
+                {
+                    int index = bestScoreIndex + k;
+                    setBitScoreAt(decoder, index, -1);
+                }
+            }
+        }
+    }
+}
+
+// This does span time messaging, but only gives time to spans that are at least at level percent.
+// So if level = 90, only spans at say 190% or 290% of bitDelay, will steal more time.
+// However, if spans with less than 100% will always steal time.
+static inline void relaxSpanTimesAtLevel(GpioUartDecoder* decoder, int level)
+{
+    // The length of time a single bit should occupy ideally.
+    long bitDelay = 1000000000L / decoder->baudRate;
+    
+    // printk(KERN_INFO "Now at level %d", level);
+    
+    // Go through all but the last element in the buffer
+    // Those will either get their turn when more elements are added, or have already.
+    // This way we do not have to worry about going out of index.
+    // We go through them backwards, since we are mostly pulling time from the previous element
+    for (int i = BIT_SPAN_BUFFER_SIZE; i-- > 1;)
+    {
+        long spanTime = getSpanTimeAt(decoder, i);
+        // Do not bother trying to give time to the span if it is very long (> 12 bits worth, the maximum uart frame size)
+        if (spanTime > bitDelay * 12)
+        {
+            continue;
+        }
+        // Do nothing if the span before it (and thus this one, too) is invalid
+        if (getSpanTimeAt(decoder, i - 1) != -1)
+        {
+            // Is this span a single bit that has been short changed?
+            // If so, we want to get it to full time
+            // This is independant of our "level" -- it just takes the highest priority
+            // Though this also assumes we do not have false interrupts.
+            if (spanTime < bitDelay)
+            {
+                //printk(KERN_INFO "Victim timespan start: %ld", getSpanTimeAt(decoder, i - 1));
+                //printk(KERN_INFO "Thief timespan start: %ld", getSpanTimeAt(decoder, i));
+                
+                // We take the loss from the span preceding it. That seems to be where
+                // the losses are from. (this may not hold generally... but does in virtual machine testing)
+                int missing = bitDelay - spanTime;
+                setSpanTimeAt(decoder, i - 1, getSpanTimeAt(decoder, i - 1) - missing);
+                setSpanTimeAt(decoder, i, spanTime + missing);
+                
+                //printk(KERN_INFO "Victim timespan end: %ld", getSpanTimeAt(decoder, i - 1));
+                //printk(KERN_INFO "Thief timespan end: %ld", getSpanTimeAt(decoder, i));
+            }
+            // Does this span have more than a single bit, but only level% or more of the last bit?
+            else if (spanTime % bitDelay > bitDelay * level / 100)
+            {
+                //printk(KERN_INFO "Victim timespan start: %ld", getSpanTimeAt(decoder, i - 1));
+                //printk(KERN_INFO "Thief timespan start: %ld", getSpanTimeAt(decoder, i));
+                
+                int missing = bitDelay - (spanTime % bitDelay);
+                setSpanTimeAt(decoder, i - 1, getSpanTimeAt(decoder, i - 1) - missing);
+                setSpanTimeAt(decoder, i, spanTime + missing);
+                
+                //printk(KERN_INFO "Victim timespan end: %ld", getSpanTimeAt(decoder, i - 1));
+                //printk(KERN_INFO "Thief timespan end: %ld", getSpanTimeAt(decoder, i));
+            }
+        }
+    }
+}
+
+// This takes the spans in the bit span buffer and massages the times around
+// If we have a time with less than a bits worth of time, for example, we can tell
+// that there has been an error, and we pull time from the surrounding spans.
+// We message like this hoping to improve on noisey timings.
+// Since this is always based on original timings, calling it multiple times
+// will allways yield the same result, instead of them stacking.
+static inline void relaxSpanTimes(GpioUartDecoder* decoder)
+{
+    // Reset all times to the original times
+    /*for (int i = 0; i < BIT_SPAN_BUFFER_SIZE; i++)
+    {
+        setSpanTimeAt(decoder, i, getOriginalSpanTimeAt(decoder, i));
+    }*/
+    
+    // Progressively relax times from levels of 100% down to 50%
+    // This will allow the spans that are more sure (say 90%) to steal from those
+    // that are less sure (say 50%), such that then the 50% one may be out of the game.
+    // 100% is done first because regardless of level, times with less than a single bit
+    // should always win.
+    for (int level = 100; level >= 50; level -= 5)
+    {
+        relaxSpanTimesAtLevel(decoder, level);
+    }
+}
+
+// The kernel has no plain 64-bit division on 32-bit machines, do_div does it whatever the machine.
+static inline uint64_t divide64(uint64_t dividend, uint32_t divisor)
+{
+#ifdef __KERNEL__
+    do_div(dividend, divisor);
+#else
+    dividend /= divisor;
+#endif
+    return dividend;
+}
+
+// time * numerator / denominator, which overflows 32-bit longs, so is worked out in 64 bits.
+static inline long scaleTime(long time, int numerator, int denominator)
+{
+    return (long)divide64((uint64_t)time * numerator, denominator);
+}
+
+// Throws away what auto-baud has trained on so far
+static inline void clearAutoBaudTraining(GpioUartDecoder* decoder)
+{
+    decoder->autoBaud.trainingSpans = 0;
+    for (int i = 0; i < AUTO_BAUD_BINS; i++)
+    {
+        decoder->autoBaudCounts[i] = 0;
+        decoder->autoBaudSums[i] = 0;
+    }
+}
+
+// Starts training for the baud rate, decoding nothing until it locks on
+static inline void startAutoBaud(GpioUartDecoder* decoder)
+{
+    decoder->autoBaud.state = GPIO_UART_AUTOBAUD_TRAINING;
+    decoder->autoBaud.failedTrainings = 0;
+    clearAutoBaudTraining(decoder);
+}
+
+// Goes on with whatever rate there is, dropping any training half done
+static inline void stopAutoBaud(GpioUartDecoder* decoder)
+{
+    if (decoder->autoBaud.state == GPIO_UART_AUTOBAUD_TRAINING)
+    {
+        clearDecoder(decoder);
+    }
+    decoder->autoBaud.state = GPIO_UART_AUTOBAUD_OFF;
+}
+
+// The bin for a span of time, or -1 if it is too short or long to have one
+static inline int getAutoBaudBin(long time)
+{
+    if (time < (1L << AUTO_BAUD_LOWEST_OCTAVE) || time >= (1L << (AUTO_BAUD_LOWEST_OCTAVE + AUTO_BAUD_OCTAVES)))
+    {
+        return -1;
+    }
+    // The octave from the highest bit set, and the 16th of it from the four bits below that
+    int octave = 31 - __builtin_clz((unsigned int)time);
+    return (octave - AUTO_BAUD_LOWEST_OCTAVE) * 16 + (int)((time >> (octave - 4)) & 15);
+}
+
+// Works out the time of a bit from the spans trained on, and how many percent of them are a whole
+// number of bits long at it. Returns -1 if the spans have no sensible bit time.
+//
+// The shortest spans there are plenty of are single bits (any byte with two different bits
+// next to each other has one), which gives a first guess. A glitch now and then is too short
+// to have company. Then the spans up to a frame long are each counted as the whole number of
+// bits nearest, and the time of them all over the bits of them all is the bit time, which is
+// pinned down mostly by the longer spans, as edge jitter counts for less over them.
+static inline long estimateBitTime(GpioUartDecoder* decoder, int* confidence)
+{
+    GpioUartAutoBaud* autoBaud = &decoder->autoBaud;
+    // The spans of a frame can be as long as this many bits, anything longer is the line idling
+    int mostFrameBits = 10 + (decoder->secondStopBit ? 1 : 0) + (decoder->parityBit ? 1 : 0);
+    *confidence = 0;
+    
+    // The lowest bin that, with those either side of it, has enough spans to be more than glitches
+    int enough = autoBaud->trainingSpans / 8;
+    int bin = 1;
+    while (bin < AUTO_BAUD_BINS - 1 &&
+           decoder->autoBaudCounts[bin - 1] + decoder->autoBaudCounts[bin] + decoder->autoBaudCounts[bin + 1] < enough)
+    {
+        bin++;
+    }
+    // That may be the bottom of the single bits, so go up to their peak
+    for (int i = bin + 1; i <= bin + 2 && i < AUTO_BAUD_BINS - 1; i++)
+    {
+        if (decoder->autoBaudCounts[i] > decoder->autoBaudCounts[bin])
+        {
+            bin = i;
+        }
+    }
+    if (bin >= AUTO_BAUD_BINS - 1)
+    {
+        return -1;
+    }
+    long bitTime = (long)divide64(decoder->autoBaudSums[bin - 1] + decoder->autoBaudSums[bin] + decoder->autoBaudSums[bin + 1],
+                                  decoder->autoBaudCounts[bin - 1] + decoder->autoBaudCounts[bin] + decoder->autoBaudCounts[bin + 1]);
+    
+    // First all the single bits, as a guess a few percent out would be a bit out over a whole frame,
+    // then everything up to a frame long with the better bit time that gives
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int mostBits = (pass == 0) ? 1 : mostFrameBits;
+        uint64_t totalTime = 0;
+        uint32_t totalBits = 0;
+        int fitting = 0;
+        int considered = 0;
+        for (int i = 0; i < AUTO_BAUD_BINS; i++)
+        {
+            if (decoder->autoBaudCounts[i] == 0)
+            {
+                continue;
+            }
+            long spanTime = (long)divide64(decoder->autoBaudSums[i], decoder->autoBaudCounts[i]);
+            long bits = (spanTime + bitTime / 2) / bitTime;
+            // Glitches are left out, but not idle line, of which there should be too little to
+            // matter at the right rate, and a great deal at too high a rate
+            if (bits < 1)
+            {
+                continue;
+            }
+            considered += decoder->autoBaudCounts[i];
+            long offBy = spanTime - bits * bitTime;
+            if (bits <= mostBits && offBy < bitTime / 4 && offBy > -bitTime / 4)
+            {
+                totalTime += decoder->autoBaudSums[i];
+                totalBits += bits * decoder->autoBaudCounts[i];
+                fitting += decoder->autoBaudCounts[i];
+            }
+        }
+        if (totalBits == 0)
+        {
+            return -1;
+        }
+        bitTime = (long)divide64(totalTime, totalBits);
+        *confidence = fitting * 100 / considered;
+    }
+    return bitTime;
+}
+
+// Bins a span for auto-baud, and once there are enough of them, locks on to the rate they give,
+// or starts over if they do not give one clearly enough
+static inline void trainAutoBaud(GpioUartDecoder* decoder, long rawBitTime)
+{
+    GpioUartAutoBaud* autoBaud = &decoder->autoBaud;
+    int bin = getAutoBaudBin(rawBitTime);
+    if (bin == -1)
+    {
+        return;
+    }
+    decoder->autoBaudCounts[bin]++;
+    decoder->autoBaudSums[bin] += rawBitTime;
+    if (++autoBaud->trainingSpans < AUTO_BAUD_TRAINING_SPANS)
+    {
+        return;
+    }
+    
+    int confidence;
+    long bitTime = estimateBitTime(decoder, &confidence);
+    autoBaud->estimatedBaudRate = (bitTime > 0) ? (1000000000L + bitTime / 2) / bitTime : 0;
+    autoBaud->confidence = confidence;
+    uartDebug(1, "Auto-baud estimated %d baud at %d%% confidence\n", autoBaud->estimatedBaudRate, confidence);
+    if (bitTime <= 0 || confidence < AUTO_BAUD_MIN_CONFIDENCE)
+    {
+        autoBaud->failedTrainings++;
+        clearAutoBaudTraining(decoder);
+        return;
+    }
+    
+    // Locked on, and from here the rate follows the bits that arrive as it would after SETBAUD
+    autoBaud->state = GPIO_UART_AUTOBAUD_LOCKED;
+    decoder->baudRate = decoder->modifiedBaudRate = autoBaud->estimatedBaudRate;
+    clearDecoder(decoder);
+}
+
+// Decodes the span of time the rx line held a value, up to the edge that ended it.
+// Bytes are given out as the spans complete them, a couple of spans behind.
+static inline void decodeSpan(GpioUartDecoder* decoder, long rawBitTime, bool rawBitValue)
+{
+    // Nothing is decoded until auto-baud knows the rate
+    if (decoder->autoBaud.state == GPIO_UART_AUTOBAUD_TRAINING)
+    {
+        trainAutoBaud(decoder, rawBitTime);
+        return;
+    }
+    
+    // We take our very raw timings and modify them with our hopefully more correct baud rate
+    // To calibrate this, the modifiedBaudRate is originally the same as the set value.
+    // Every time we get a single bit timing in the range of 75% to 125% of the current modified baud rate,
+    // then we slightly modify our modified baud rate value to incorporate the new timing. The single timing
+    // has a low relative weight to insure that changes happen only "slowly"
+    long bitDelay = 1000000000L / decoder->modifiedBaudRate;
+    if (rawBitTime >= bitDelay * 75 / 100 && rawBitTime <= bitDelay * 125 / 100)
+    {
+        long modifiedBitDelay = (bitDelay * 63 + rawBitTime) / 64;
+        decoder->modifiedBaudRate = 1000000000L / modifiedBitDelay;
+    }
+    
+    // To keep use of this modified baud rate local, we will normalize our times using it to be
+    // in terms of the original baud rate again. This way the times we record for testing will not
+    // be based on different baud rates over time.
+    uartDebug(2, "Raw time (original): %ld at value: %d\n", rawBitTime, (int)rawBitValue);
+    rawBitTime = scaleTime(rawBitTime, decoder->modifiedBaudRate, decoder->baudRate);
+    uartDebug(2, "Raw time (modified): %ld at value: %d\n", rawBitTime, (int)rawBitValue);
+    
+    // We read out time spans when they are in the second-to-last position.
+    // We do this because when the last position time spans are in the "relaxing" process,
+    // they are not able to steal time. We want our read values to have just had this opportunity.
+    long removedSpanTime = getSpanTimeAt(decoder, 1);
+    long removedOriginalSpanTime = getOriginalSpanTimeAt(decoder, 1);
+    bool removedSpanValue = getSpanValueAt(decoder, 1);
+    
+    // Now we overwrite the oldest values by placing our new ones into the buffer
+    addSpanTimeAndValue(decoder, rawBitTime, rawBitValue);
+    
+    // Do the relaxation of time values with our new value.
+    relaxSpanTimes(decoder);
+    
+    // Now let the removed time and value be processed into bits if they are valid
+    if (removedSpanTime != -1)
+    {
+        processSpanTimeAndValue(decoder, removedSpanTime, removedOriginalSpanTime, removedSpanValue);
+    }
+}
+
+// The bits of a frame sending value, in the order they go out from bit 0: a start bit (0),
+// the data least significant first, the parity bit if there is one, then the stop bits (1).
+// The number of bits is put in bitCount.
+static inline int makeTxFrame(unsigned char value, bool parityBit, bool secondStopBit, int* bitCount)
+{
+    int frame = value << 1;
+    int bits = 9;
+    if (parityBit)
+    {
+        // Quicker parity calculation from http://graphics.stanford.edu/~seander/bithacks.html#ParityParallel
+        int parity = value;
+        parity ^= parity >> 4;
+        parity &= 0xf;
+        parity = (0x6996 >> parity) & 1;
+        frame |= parity << bits;
+        bits++;
+    }
+    frame |= 1 << bits;
+    bits++;
+    if (secondStopBit)
+    {
+        frame |= 1 << bits;
+        bits++;
+    }
+    *bitCount = bits;
+    return frame;
+}
+
+// The first bit after index with a different value, which is where the line next needs an edge,
+// or bitCount if the frame holds its value to the end
+static inline int nextTxEdge(int frame, int bitCount, int index)
+{
+    int value = (frame >> index) & 1;
+    do
+    {
+        index++;
+    } while (index < bitCount && ((frame >> index) & 1) == value);
+    return index;
+}
+
+#endif
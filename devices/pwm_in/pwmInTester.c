@@ -14,9 +14,9 @@
 
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    if (argc < 2 || argc > PWM_IN_MAX_CHANNELS + 1)
     {
-        fprintf(stderr, "%s: <gpio number>\n", argv[0]);
+        fprintf(stderr, "%s: <gpio number> [more gpio numbers, up to %d]\n", argv[0], PWM_IN_MAX_CHANNELS);
         return -1;
     }
     
@@ -37,23 +37,51 @@ int main(int argc, char* argv[])
         printf("Pwm In: setting interrupt\n");
         return -1;
     }
+
+    // Any more gpios become the following channels
+    for (int i = 2; i < argc; i++)
+    {
+        gpioNumber = (int)strtol(argv[i], NULL, 10);
+        if (ioctl(pwmIn, PWM_IN_ADD_GPIO, gpioNumber) < 0)
+        {
+            printf("Pwm In: adding gpio %d\n", gpioNumber);
+            return -1;
+        }
+    }
     
     // We can only exit by Ctrl-C or escape
     while (1)
     {
-        long pulseWidthValue;
-        // Do we have characters from the terminal?
-        while ((pulseWidthValue = ioctl(pwmIn, PWM_IN_READ_PULSE_WIDTH)) != -1)
+        if (argc == 2)
         {
-            printf("Pulse width: %ld\n", pulseWidthValue);
+            long pulseWidthValue;
+            // Do we have characters from the terminal?
+            while ((pulseWidthValue = ioctl(pwmIn, PWM_IN_READ_PULSE_WIDTH)) != -1)
+            {
+                printf("Pulse width: %ld\n", pulseWidthValue);
+            }
+            
+            // Give them some time to rest...
+            struct timespec sleepTime;
+            sleepTime.tv_sec = 0;
+            sleepTime.tv_nsec = 1000000; // a millisecond
+            nanosleep(&sleepTime, NULL);
+        }
+        else
+        {
+            // Sleeps until there are pulses
+            PwmInPulse pulses[PWM_IN_FIFO_SIZE];
+            ssize_t bytes = read(pwmIn, pulses, sizeof(pulses));
+            if (bytes < 0)
+            {
+                perror("Pwm In: reading pulses");
+                return -1;
+            }
+            for (int i = 0; i < bytes / (ssize_t)sizeof(PwmInPulse); i++)
+            {
+                printf("Channel %u (gpio %u): %u ns at %llu ns\n", pulses[i].channel, pulses[i].gpio, pulses[i].widthNs, (unsigned long long)pulses[i].risingNs);
+            }
         }
-        
-        // Give them some time to rest...
-        struct timespec sleepTime;
-        sleepTime.tv_sec = 0;
-        sleepTime.tv_nsec = 1000000; // a millisecond
-        nanosleep(&sleepTime, NULL);
     }
     return 0;
 }
-
@@ -24,8 +24,11 @@
 #include <linux/spinlock.h>
 #include <linux/time.h>
 #include <linux/delay.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
 
 #include "pwm_in.h"
+#include "pwm_in_fifo.h"
 
 MODULE_LICENSE("Dual BSD/GPL");
 
@@ -39,6 +42,7 @@ int pwm_in_release(struct inode* inode, struct file* filePointer);
 ssize_t pwm_in_read(struct file* filePointer, char* dataBuffer, size_t dataLength, loff_t* filePosition);
 ssize_t pwm_in_write(struct file* filePointer, const char* dataBuffer, size_t dataLength, loff_t* filePosition);
 long pwm_in_ioctl(struct file* filePointer, unsigned int cmd, unsigned long arg);
+unsigned int pwm_in_poll(struct file* filePointer, poll_table* wait);
 
 module_init(pwm_in_init)
 module_exit(pwm_in_exit)
@@ -49,7 +53,8 @@ struct file_operations pwm_in_operations = {
     .write = pwm_in_write,
     .open = pwm_in_open,
     .release = pwm_in_release,
-    .unlocked_ioctl = pwm_in_ioctl
+    .unlocked_ioctl = pwm_in_ioctl,
+    .poll = pwm_in_poll
 };
 
 //Major Number of the driver, used for linking to a file by linux.
@@ -59,25 +64,35 @@ int majorNumber = 445;
 //Use to keep track of interrupt enabling/disabling
 int deviceOpens = 0;
 
-// Structure that contains all the state that governs how the GPIO UART works
+typedef struct PwmIn PwmIn;
+
+// A single gpio being captured
 typedef struct
 {
-    // -1 before system is started.
-    int pwmGpio;
+    PwmIn* pwmIn;
+    int channel;
+    int gpio;
     
-    struct timespec lastRisingEdge;
+    // Made into pulses by the interrupt
+    PwmInEdges edges;
+} PwmInChannel;
+
+// Structure that contains all the state of one open of the device
+struct PwmIn
+{
+    PwmInChannel channels[PWM_IN_MAX_CHANNELS];
+    int channelCount;
     
-    // The tasklet structure that runs the bottom half of the interrupt handling
-    struct tasklet_struct pwmIsrBottomHalfTasklet;
+    // Filled by the interrupts, emptied by read
+    PwmInFifo fifo;
+    // Guards the fifo between the interrupts and read
+    spinlock_t fifoLock;
+    // Where poll waits for pulses
+    wait_queue_head_t pulseWait;
     
-    // Microseconds measured pulse width. -1 if there is none or it has already been read.
+    // Microseconds measured pulse width of channel 0. -1 if there is none or it has already been read.
     long pulseWidth;
-    
-    // For TESTING
-    int interruptsReceived;
-    int interruptErrors;
-    int interruptLastValue;
-} PwmIn;
+};
 
 
 void addTime(struct timespec* time, long nanoseconds)
@@ -96,109 +111,117 @@ void addTime(struct timespec* time, long nanoseconds)
     }
 }
 
-long timeDifference(const struct timespec* currentTime, const struct timespec* oldTime)
-{
-    return  ((currentTime->tv_sec - oldTime->tv_sec) * 1000000000L +
-             (currentTime->tv_nsec - oldTime->tv_nsec));
-}
-
-irqreturn_t pwmIsr(int irq, void* dev_id, struct pt_regs* regs);
-
-// The bottom half of the px pin interrupt handler
-// This bottom half is implemented as a tasklet
-void pwmIsrBottomHalfFunction(unsigned long data)
-{
-    PwmIn* pwmIn = (PwmIn*)data;
-    
-    printk(KERN_INFO "PWM In: Measured pulse width of: %ld", pwmIn->pulseWidth);
-}
-
-// Interrupt handler for the rx pin
+// Interrupt handler for a captured pin, one for each channel
 irqreturn_t pwmIsr(int irq, void* dev_id, struct pt_regs* regs)
 {
-    PwmIn* pwmIn = (PwmIn*)dev_id;
+    PwmInChannel* pwmChannel = (PwmInChannel*)dev_id;
+    PwmIn* pwmIn = pwmChannel->pwmIn;
+    PwmInPulse pulse;
     
     // First, sample the pin
-    int pinValue = gpio_get_value(pwmIn->pwmGpio);
-
-    // TESTING
-    pwmIn->interruptsReceived++;
-    if (pinValue == pwmIn->interruptLastValue)
-    {
-        pwmIn->interruptErrors++;
-    }
+    int pinValue = gpio_get_value(pwmChannel->gpio);
 
     // Get current time
     struct timespec currentTime;
-    get_monotonic_boottime(&currentTime);
+    ktime_get_ts(&currentTime);
     
-    // Falling edge? Without lost interrupt?
-    if (pinValue == 0 && pwmIn->interruptLastValue != 0)
-    {
-        long timePassed = timeDifference(&currentTime, &pwmIn->lastRisingEdge);
-        pwmIn->pulseWidth = timePassed / 1000; // nano to micro
-    }
-    else if (pinValue == 1)
+    // A falling edge ends a pulse
+    if (pwmInEdge(&pwmChannel->edges, pinValue, timespec_to_ns(&currentTime), &pulse))
     {
-        pwmIn->lastRisingEdge = currentTime;
+        pulse.channel = pwmChannel->channel;
+        pulse.gpio = pwmChannel->gpio;
+        
+        spin_lock(&pwmIn->fifoLock);
+        pwmInFifoPut(&pwmIn->fifo, &pulse);
+        if (pwmChannel->channel == 0)
+        {
+            pwmIn->pulseWidth = pulse.widthNs / 1000; // nano to micro
+        }
+        spin_unlock(&pwmIn->fifoLock);
+        
+        wake_up_interruptible(&pwmIn->pulseWait);
     }
     
-    pwmIn->interruptLastValue = pinValue;
-    
-    // Schedule tasklet bottom half
-    // This will do the job of processing the passed time and making sense out of it
-    // turning it into bits and bits into uart frames and those into bytes.
-    tasklet_schedule(&pwmIn->pwmIsrBottomHalfTasklet);
-    
     return IRQ_HANDLED;
 }
 
-// Opens and configures the needed GPIO pins
-// And sets up the appropraite interrupts on them
-int initInterrupt(PwmIn* pwmIn, int interruptNumber)
+// Opens and configures the given GPIO pin as the next channel
+// And sets up the appropraite interrupt on it
+// Returns the channel number
+int addChannel(PwmIn* pwmIn, int interruptNumber)
 {
-    // Do not allow init if we already have done it
-    if (pwmIn->pwmGpio != -1)
+    PwmInChannel* pwmChannel;
+    int i;
+    
+    if (pwmIn->channelCount >= PWM_IN_MAX_CHANNELS)
     {
-        return -EPERM;
+        return -ENOSPC;
     }
+    // Each gpio only once
+    for (i = 0; i < pwmIn->channelCount; i++)
+    {
+        if (pwmIn->channels[i].gpio == interruptNumber)
+        {
+            return -EBUSY;
+        }
+    }
+    
+    pwmChannel = &pwmIn->channels[pwmIn->channelCount];
+    pwmChannel->pwmIn = pwmIn;
+    pwmChannel->channel = pwmIn->channelCount;
+    pwmChannel->gpio = interruptNumber;
+    pwmInEdgesInit(&pwmChannel->edges);
     
     // Get the GPIOs for our interrupt handler
-    if (gpio_request(interruptNumber, "PWM In Interrupt") ||
-        gpio_direction_input(interruptNumber) ||
+    // Only what we got is given back, as the pin may belong to someone else
+    if (gpio_request(interruptNumber, "PWM In Interrupt"))
+    {
+        printk(KERN_ERR "PWM In: Could not obtain pwm interrupt pin %d\n", interruptNumber);
+        return -1;
+    }
+    if (gpio_direction_input(interruptNumber) ||
         gpio_export(interruptNumber, 0))
     {
-        printk(KERN_ERR "PWM In: Could not obtain pwm interrupt pin\n");
+        printk(KERN_ERR "PWM In: Could not set up pwm interrupt pin %d\n", interruptNumber);
+        gpio_free(interruptNumber);
         return -1;
     }
     
     // Register our interrupt handler
     // We want to get interrupts on both the rising and falling edges so we can get the full picture
-    // of what the input signal is on the rx pin.
+    // of what the input signal is on the pin.
     if(request_irq(gpio_to_irq(interruptNumber),
                          (irq_handler_t)pwmIsr, //TESTING
-                         (1*IRQF_TRIGGER_RISING) | IRQF_TRIGGER_FALLING, "PWM In interrupt ISR", pwmIn))
+                         (1*IRQF_TRIGGER_RISING) | IRQF_TRIGGER_FALLING, "PWM In interrupt ISR", pwmChannel))
     {
-        printk(KERN_ERR "PWM In: Could not register irq\n");
+        printk(KERN_ERR "PWM In: Could not register irq for pin %d\n", interruptNumber);
+        gpio_unexport(interruptNumber);
+        gpio_free(interruptNumber);
         return -1;
     }
     
-    pwmIn->pwmGpio = interruptNumber;
+    pwmIn->channelCount++;
     
-    printk(KERN_INFO "PWM In: Started\n");
+    printk(KERN_INFO "PWM In: Started channel %d on gpio %d\n", pwmChannel->channel, interruptNumber);
     
-    return 0;
+    return pwmChannel->channel;
 }
 
 int releasePwmIn(PwmIn* pwmIn)
 {
-    if (pwmIn->pwmGpio != -1)
+    int i;
+    for (i = 0; i < pwmIn->channelCount; i++)
     {
+        PwmInChannel* pwmChannel = &pwmIn->channels[i];
+        
         // Release everything!
-        gpio_free(pwmIn->pwmGpio);
-        free_irq(gpio_to_irq(pwmIn->pwmGpio), pwmIn);
-        pwmIn->pwmGpio = -1;
+        free_irq(gpio_to_irq(pwmChannel->gpio), pwmChannel);
+        gpio_free(pwmChannel->gpio);
+        
+        printk(KERN_INFO "PWM In: Channel %d interrupts received: %u", i, pwmChannel->edges.edges);
+        printk(KERN_INFO "PWM In: Channel %d interrupt errors: %u", i, pwmChannel->edges.edgeErrors);
     }
+    pwmIn->channelCount = 0;
     
     return 0;
 }
@@ -206,15 +229,34 @@ int releasePwmIn(PwmIn* pwmIn)
 long pwm_in_ioctl(struct file* filePointer, unsigned int cmd, unsigned long arg)
 {
     PwmIn* pwmIn = (PwmIn*)filePointer->private_data;
+    unsigned long flags;
+    long result;
     switch (cmd)
     {
         case PWM_IN_SET_GPIO:
-            return initInterrupt(pwmIn, arg);
+            // Do not allow init if we already have done it
+            if (pwmIn->channelCount != 0)
+            {
+                return -EPERM;
+            }
+            result = addChannel(pwmIn, arg);
+            return result < 0 ? result : 0;
         case PWM_IN_GET_GPIO:
-            return pwmIn->pwmGpio;
-        case PWM_IN_READ_PULSE_WIDTH:;
-            long result = pwmIn->pulseWidth;
+            return pwmIn->channelCount > 0 ? pwmIn->channels[0].gpio : -1;
+        case PWM_IN_READ_PULSE_WIDTH:
+            spin_lock_irqsave(&pwmIn->fifoLock, flags);
+            result = pwmIn->pulseWidth;
             pwmIn->pulseWidth = -1;
+            spin_unlock_irqrestore(&pwmIn->fifoLock, flags);
+            return result;
+        case PWM_IN_ADD_GPIO:
+            return addChannel(pwmIn, arg);
+        case PWM_IN_GET_CHANNEL_COUNT:
+            return pwmIn->channelCount;
+        case PWM_IN_GET_DROPPED_PULSES:
+            spin_lock_irqsave(&pwmIn->fifoLock, flags);
+            result = pwmIn->fifo.dropped;
+            spin_unlock_irqrestore(&pwmIn->fifoLock, flags);
             return result;
     }
     printk(KERN_ERR "PWM In: IOCTL unknown");
@@ -255,17 +297,12 @@ int pwm_in_open(struct inode* inode, struct file* filePointer)
     
     // SO MUCH INITIALIZATION!!!
     PwmIn* pwmIn = (PwmIn*)filePointer->private_data;
-    // No pin set, no pulse width measured yet
-    pwmIn->pwmGpio = -1;
+    // No pins set, no pulse width measured yet
+    pwmIn->channelCount = 0;
     pwmIn->pulseWidth = -1;
-    
-    tasklet_init(&pwmIn->pwmIsrBottomHalfTasklet, pwmIsrBottomHalfFunction, (unsigned long)pwmIn);
-    
-    pwmIn->interruptLastValue = false; // No pulse yet
-   
-    // TESTING
-    pwmIn->interruptsReceived = 0;
-    pwmIn->interruptErrors = 0;
+    pwmInFifoInit(&pwmIn->fifo);
+    spin_lock_init(&pwmIn->fifoLock);
+    init_waitqueue_head(&pwmIn->pulseWait);
  
     printk(KERN_INFO "PWM In: Device opened");
     
@@ -284,17 +321,97 @@ int pwm_in_release(struct inode* inode, struct file* filePointer)
     // Just for extra safety...
     filePointer->private_data = NULL;
     
-    printk(KERN_INFO "PWM In: Interrupts received: %d", pwmIn->interruptsReceived);
-    printk(KERN_INFO "PWM In: Interrupt errors: %d", pwmIn->interruptErrors);
-    
     printk(KERN_INFO "PWM In: Device closed");
     
     return 0;
 }
 
+// Whether there are pulses to read
+bool hasPulses(PwmIn* pwmIn)
+{
+    unsigned long flags;
+    spin_lock_irqsave(&pwmIn->fifoLock, flags);
+    bool isAny = pwmInFifoLength(&pwmIn->fifo) > 0;
+    spin_unlock_irqrestore(&pwmIn->fifoLock, flags);
+    return isAny;
+}
+
+// Gives out as many whole pulses as fit, in the order they were measured,
+// first waiting for there to be some unless the device was opened O_NONBLOCK
 ssize_t pwm_in_read(struct file* filePointer, char* dataBuffer, size_t dataLength, loff_t* filePosition)
 {
-    return -1;
+    PwmIn* pwmIn = (PwmIn*)filePointer->private_data;
+    // A part of the fifo at a time, as copy_to_user cannot be done holding the lock
+    // and the whole of it is too much for the kernel stack
+    PwmInPulse pulses[32];
+    size_t maxPulses = dataLength / sizeof(PwmInPulse);
+    size_t pulsesRead = 0;
+    unsigned long flags;
+    
+    // Nothing would ever fit, and returning 0 would look like the end of the file
+    if (maxPulses == 0)
+    {
+        return -EINVAL;
+    }
+    
+    // Another reader can empty the fifo between our wake and the copy, so this goes
+    // around until it has a pulse, as returning 0 would look like the end of the file
+    while (pulsesRead == 0)
+    {
+        if (!hasPulses(pwmIn))
+        {
+            if (filePointer->f_flags & O_NONBLOCK)
+            {
+                return -EAGAIN;
+            }
+            // Sleeps until the interrupt wakes us with a pulse, or a signal comes
+            if (wait_event_interruptible(pwmIn->pulseWait, hasPulses(pwmIn)))
+            {
+                return -ERESTARTSYS;
+            }
+        }
+        
+        while (pulsesRead < maxPulses)
+        {
+            unsigned int count = maxPulses - pulsesRead;
+            if (count > sizeof(pulses) / sizeof(*pulses))
+            {
+                count = sizeof(pulses) / sizeof(*pulses);
+            }
+            
+            spin_lock_irqsave(&pwmIn->fifoLock, flags);
+            count = pwmInFifoGet(&pwmIn->fifo, pulses, count);
+            spin_unlock_irqrestore(&pwmIn->fifoLock, flags);
+            
+            if (count == 0)
+            {
+                break;
+            }
+            if (copy_to_user(dataBuffer + pulsesRead * sizeof(PwmInPulse), pulses, count * sizeof(PwmInPulse)))
+            {
+                return -EFAULT;
+            }
+            pulsesRead += count;
+        }
+    }
+    
+    return pulsesRead * sizeof(PwmInPulse);
+}
+
+// Readable when there are pulses in the fifo
+unsigned int pwm_in_poll(struct file* filePointer, poll_table* wait)
+{
+    PwmIn* pwmIn = (PwmIn*)filePointer->private_data;
+    unsigned int mask = 0;
+    
+    poll_wait(filePointer, &pwmIn->pulseWait, wait);
+    
+    if (hasPulses(pwmIn))
+    {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    
+    return mask;
 }
 
 ssize_t pwm_in_write(struct file* filePointer, const char* dataBuffer, size_t dataLength, loff_t* filePosition)
@@ -1,18 +1,55 @@
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 #ifndef PWM_IN_H
 #define PWM_IN_H
 
 #define PWM_IN_IOC_MAGIC '!'
 
+// Most gpios one open of the device can capture
+#define PWM_IN_MAX_CHANNELS 8
+
+// Pulses kept until they are read, for every channel together, a power of two.
+// When the stream is full its oldest pulse is dropped for the newest.
+#define PWM_IN_FIFO_SIZE 256
+
+// A single measured pulse, as read(2) streams them out
+typedef struct
+{
+    // The channel, in the order the gpios were added
+    __u16 channel;
+    // The gpio the pulse was measured on
+    __u16 gpio;
+    // Nanoseconds from the rising to the falling edge
+    __u32 widthNs;
+    // CLOCK_MONOTONIC nanoseconds of the rising edge
+    __u64 risingNs;
+} __attribute__((packed)) PwmInPulse;
+
 // Set the interrupt number and start the beast. You can only call this once. (unless it fails, then you can try again)
+// The gpio becomes channel 0.
 #define PWM_IN_SET_GPIO _IO(PWM_IN_IOC_MAGIC, 0)
-// Get the interrupt number
+// Get the interrupt number of channel 0
 #define PWM_IN_GET_GPIO _IO(PWM_IN_IOC_MAGIC, 1)
 
-// Read the most recent new pulse width from the PWM interrupt.
+// Read the most recent new pulse width of channel 0 from the PWM interrupt.
 // -1 if there has not been a new one since the last time this was called.
 #define PWM_IN_READ_PULSE_WIDTH _IO(PWM_IN_IOC_MAGIC, 2)
 
+// Start capturing another gpio. Returns its channel number.
+// Once there is more than one channel, read(2) is the way to get their pulses.
+#define PWM_IN_ADD_GPIO _IO(PWM_IN_IOC_MAGIC, 3)
+
+// How many channels are capturing
+#define PWM_IN_GET_CHANNEL_COUNT _IO(PWM_IN_IOC_MAGIC, 4)
+
+// How many pulses have been dropped from a full stream
+#define PWM_IN_GET_DROPPED_PULSES _IO(PWM_IN_IOC_MAGIC, 5)
+
+// read(2) gives out as many whole PwmInPulse records as fit in the buffer,
+// every channel's together in the order their falling edges came.
+// If no pulses have been measured since the last read it waits for one, or fails with
+// EAGAIN if the device was opened O_NONBLOCK; poll(2) says when there are some.
+// A buffer too small for a single record fails with EINVAL.
 
-#endif
\ No newline at end of file
+#endif
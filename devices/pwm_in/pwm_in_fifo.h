@@ -0,0 +1,105 @@
+#include "pwm_in.h"
+
+#ifndef PWM_IN_FIFO_H
+#define PWM_IN_FIFO_H
+
+// The pulse stream of pwm_in, shared by the driver and by userspace so that the
+// same code can be run, and tested, outside of the kernel.
+// Nothing here locks; the driver holds its spinlock around each call.
+
+// Pulses in the order they were measured. Like a kfifo the counters only ever increase
+// and are taken modulo the size, but a full fifo drops its oldest pulse rather than the newest,
+// as a radio control wants the latest pulses.
+typedef struct
+{
+    PwmInPulse pulses[PWM_IN_FIFO_SIZE];
+    unsigned int in;
+    unsigned int out;
+    unsigned long dropped;
+} PwmInFifo;
+
+// Edges seen so far on one gpio, to make pulses of them
+typedef struct
+{
+    __u64 lastRisingNs;
+    int lastValue;
+
+    // For TESTING
+    unsigned int edges;
+    // Edges with the same value as the last, so one in between was lost
+    unsigned int edgeErrors;
+} PwmInEdges;
+
+static inline void pwmInFifoInit(PwmInFifo* fifo)
+{
+    fifo->in = 0;
+    fifo->out = 0;
+    fifo->dropped = 0;
+}
+
+static inline unsigned int pwmInFifoLength(const PwmInFifo* fifo)
+{
+    return fifo->in - fifo->out;
+}
+
+// Adds a pulse, dropping the oldest if the fifo is full
+static inline void pwmInFifoPut(PwmInFifo* fifo, const PwmInPulse* pulse)
+{
+    if (fifo->in - fifo->out >= PWM_IN_FIFO_SIZE)
+    {
+        fifo->out++;
+        fifo->dropped++;
+    }
+    fifo->pulses[fifo->in % PWM_IN_FIFO_SIZE] = *pulse;
+    fifo->in++;
+}
+
+// Takes up to maxPulses of the oldest pulses. Returns how many were taken.
+static inline unsigned int pwmInFifoGet(PwmInFifo* fifo, PwmInPulse* pulses, unsigned int maxPulses)
+{
+    unsigned int count = 0;
+    while (fifo->out != fifo->in && count < maxPulses)
+    {
+        pulses[count++] = fifo->pulses[fifo->out % PWM_IN_FIFO_SIZE];
+        fifo->out++;
+    }
+    return count;
+}
+
+static inline void pwmInEdgesInit(PwmInEdges* edges)
+{
+    edges->lastRisingNs = 0;
+    edges->lastValue = 0; // No pulse yet
+    edges->edges = 0;
+    edges->edgeErrors = 0;
+}
+
+// Takes the pin value just after an edge, and when it came.
+// Returns 1 and fills in the width and rising time of the pulse when a falling edge ends one, 0 otherwise.
+// A falling edge without a rising one before it (a lost interrupt) makes no pulse.
+static inline int pwmInEdge(PwmInEdges* edges, int value, __u64 nowNs, PwmInPulse* pulse)
+{
+    int isPulse = 0;
+
+    edges->edges++;
+    if (value == edges->lastValue)
+    {
+        edges->edgeErrors++;
+    }
+
+    if (value == 0 && edges->lastValue != 0)
+    {
+        pulse->widthNs = (__u32)(nowNs - edges->lastRisingNs);
+        pulse->risingNs = edges->lastRisingNs;
+        isPulse = 1;
+    }
+    else if (value != 0)
+    {
+        edges->lastRisingNs = nowNs;
+    }
+
+    edges->lastValue = value;
+    return isPulse;
+}
+
+#endif
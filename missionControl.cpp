@@ -5,31 +5,70 @@
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <iostream>
 #include <termios.h>
 #include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
 #include <string>
+#include <vector>
 
 #include "devices/Uart.h"
+#include "devices/ReplayUart.h"
 #include "devices/GPSDecoder.h"
 #include "devices/IMUDecoder.h"
 #include "devices/ADCSensor3008.h"
+#include "devices/ADCBank3008.h"
+#include "devices/AdcAcquisition.h"
+#include "devices/CalibrationTable.h"
+#include "devices/I2cDevice.h"
 #include "devices/CellDriver.h"
 #include "devices/PWMSensor.h"
+#include "devices/PwmInputBank.h"
 #include "devices/ServoDriver.h"
 #include "devices/HumiditySensor.h"
 #include "devices/TemperatureSensor.h"
 #include "devices/GpioOutput.h"
+#include "devices/StatusDisplay.h"
 
 #include "akp/cAkpParser/crc8.h"
 #include "akp/cAkpParser/cAkpParser.h"
 
+#include "recorder/FlightRecorder.h"
+#include "recorder/LatencyHistogram.h"
+
+#include "scheduler/TaskScheduler.h"
+
+#include "telemetry/TelemetryPolicy.h"
+
+#include "config/MissionConfig.h"
+
+#include "control/RcPassthrough.h"
+
+// Pins, uarts and timings as built, each can be changed with the config file
 #define STAY_ALIVE_PIN 2
+#define THROTTLE_IN_PIN 43
+#define TEMPERATURE_ADC_CHANNEL 1
+#define OUTSIDE_TEMPERATURE_ADC_CHANNEL 2
+#define HUMIDITY_ADC_CHANNEL 3
+// -1 for an analog humidity sensor on its adc channel, or the i2c bus of a HIH6130
+#define HUMIDITY_I2C_BUS -1
+#define TRANSCEIVER_BAUD 9600
+#define KILL_SWITCH_SECONDS 600
 #define CELL_MAX_TAGS 6
 
+// The throttle is the median of its last five pulses, held through a few microseconds of jitter
+#define THROTTLE_FILTER_LENGTH 5
+#define THROTTLE_JITTER_US 4
+
+// Longest to wait between polls of the devices when replaying, as replayed bytes have no handle to wake us
+#define REPLAY_POLL_US 1000
+
 #define STATUS_LED_2_PIN 33
 #define STATUS_LED_3_PIN 37
 #define STATUS_LED_4_PIN 63
@@ -39,6 +78,25 @@
 #define STATUS_LED_8_PIN 35
 #define STATUS_LED_9_PIN 39
 
+// What each status led shows, in the order of the STATUS_LED pins.
+// All but the overrun and backlog leds are lit when things are well.
+#define STATUS_GPS_FIX 0
+#define STATUS_IMU_RATE 1
+#define STATUS_CELL_REGISTERED 2
+#define STATUS_TRANSCEIVER_LINK 3
+#define STATUS_LOOP_OVERRUN 4
+#define STATUS_RECORDER_BACKLOG 5
+#define STATUS_ALIVE 6
+#define STATUS_HEARTBEAT 7
+
+// A gps fix or transceiver tag older than this no longer counts
+#define STATUS_GPS_FIX_NS 3000000000ULL
+#define STATUS_TRANSCEIVER_LINK_NS 10000000000ULL
+// Fewest imu sentences a second that count as the imu keeping up
+#define STATUS_MIN_IMU_RATE 20
+// Bytes the flight recorder may have written but not yet synced before it counts as behind
+#define STATUS_RECORDER_BACKLOG_BYTES (1024 * 1024)
+
 #define PWM_INPUT_1_PIN 26
 #define PWM_INPUT_2_PIN 27
 #define PWM_INPUT_3_PIN 38
@@ -50,25 +108,211 @@
 
 struct termios oldTerminalSettings;
 
-Uart transceiverUart(1, 9600);
-Uart imuUart(2, 115200);
-Uart servoDriverUart(3, 9600);
-Uart cellUart(4, 115200);
-Uart gpsUart(5, 9600);
+// The serial devices are made in main, either real uarts or replays of a capture
+ISerial* transceiverUart = NULL;
+ISerial* imuUart = NULL;
+ISerial* servoDriverUart = NULL;
+ISerial* cellUart = NULL;
+ISerial* gpsUart = NULL;
 
 IMUDecoder imuDecoder;
 GPSDecoder gpsDecoder;
-CellDriver cellDriver(&cellUart);
+CellDriver* cellDriver = NULL;
+
+// The pin devices are made in main, once the config has said where they are
+// Every adc channel is converted together, many times a second on a thread of its own,
+// and the sensors read the latest of the filtered conversions
+ADCBank3008* adcBank = NULL;
+AdcAcquisition* adcAcquisition = NULL;
+// Samples a second, filter order and samples to a value, and the spi clock, unless [adc] says otherwise.
+// Eight channels of 24 clocks each, 1000 times a second, need a clock of at least 192kHz.
+int32_t adcRateHz = 1000;
+int32_t adcFilterOrder = 2;
+int32_t adcDecimation = 32;
+int32_t adcSpiSpeedHz = 1000000;
+// The last filtered output the adc task recorded
+uint32_t adcRecordedOutput = 0;
+ADCSensor3008* temperatureAdc = NULL;
+TemperatureSensor* temperatureSensor = NULL;
+ADCSensor3008* outsideTemperatureAdc = NULL;
+TemperatureSensor* outsideTemperatureSensor = NULL;
+// The humidity sensor is either analog or a HIH6130 on an i2c bus, whichever [pins] says
+ADCSensor3008* humidityAdc = NULL;
+I2cDevice* humidityI2c = NULL;
+HumiditySensor* humiditySensor = NULL;
+
+// What each sensor's conversions stand for, worked out for every conversion from the [calibration] section
+CalibrationTable insideTemperatureCalibration;
+CalibrationTable outsideTemperatureCalibration;
+CalibrationTable humidityCalibration;
+
+// An LM335 with a 1k resistor: 10mV a kelvin, so 2.98V (610 of 1023 counts of 5V) at 298K
+const CalibrationPoint lm335Calibration[] = {{0, -273150}, {610, 24850}};
+// A HIH-4030 at 5V: 0.16 of the supply at 0%, and 0.0062 of it more for each percent
+const CalibrationPoint hih4030Calibration[] = {{164, 0}, {798, 100000}};
+
+typedef struct
+{
+    const char* name;
+    CalibrationTable* table;
+    // How it is calibrated unless the config says otherwise
+    const CalibrationPoint* points;
+    int pointCount;
+} SensorCalibration;
+
+SensorCalibration sensorCalibrations[] =
+{
+    {"insideTemperature", &insideTemperatureCalibration, lm335Calibration, 2},
+    {"outsideTemperature", &outsideTemperatureCalibration, lm335Calibration, 2},
+    {"humidity", &humidityCalibration, hih4030Calibration, 2}
+};
+
+GpioOutput* stayAliveGpio = NULL;
+
+// The eight status leds, showing the health of everything with a single update when it changes
+StatusDisplay* statusDisplay = NULL;
+
+PWMSensor* throttleIn = NULL;
+
+// The eight pwm inputs, all read with one read of the pwm_in driver
+PwmInputBank* pwmInputs = NULL;
+ServoDriver* throttleOut = NULL;
+
+// Passes the throttle and pwm inputs through to the servos on a thread of its own.
+// While it runs, nothing else reads those inputs or writes the servos.
+RcPassthrough* rcPassthrough = NULL;
+
+// How the servos follow the inputs unless the [rc] section says otherwise:
+// the throttle straight through to servo 1, closed when it goes stale.
+// input (0 throttle, 1-8 pwmInput1-8), servo, failsafe, min and max positions, curve points
+RcOutput rcOutputs[RC_MAX_OUTPUTS] =
+{
+    {0, 1, 0, 0, 5000, {{1000, 0}, {2000, 5000}}, 2}
+};
+int rcOutputCount = 1;
+int32_t rcRateHz = 100;
+int32_t rcStaleMs = 100;
+
+// Settings read from the config file given with -f, reread on SIGHUP
+MissionConfig config;
+const char* configPath = NULL;
 
-//HumiditySensor humiditySensor;
+// Where each serial device is and how fast it goes, from the [uarts] section as "uart number, baud rate"
+typedef struct
+{
+    const char* name;
+    ISerial** serial;
+    int32_t uartNumber;
+    int32_t baudRate;
+    // The uart itself, so its baud rate can be changed. NULL when replaying.
+    Uart* uart;
+} SerialDevice;
+
+SerialDevice serialDevices[] =
+{
+    {"transceiver", &transceiverUart, 1, TRANSCEIVER_BAUD, NULL},
+    {"imu", &imuUart, 2, 115200, NULL},
+    {"servo", &servoDriverUart, 3, 9600, NULL},
+    {"cell", &cellUart, 4, 115200, NULL},
+    {"gps", &gpsUart, 5, 9600, NULL}
+};
+
+// Pins and channels, from the [pins] section. They are only read at startup.
+int32_t stayAlivePin = STAY_ALIVE_PIN;
+int32_t throttleInPin = THROTTLE_IN_PIN;
+int32_t temperatureAdcChannel = TEMPERATURE_ADC_CHANNEL;
+int32_t outsideTemperatureAdcChannel = OUTSIDE_TEMPERATURE_ADC_CHANNEL;
+int32_t humidityAdcChannel = HUMIDITY_ADC_CHANNEL;
+int32_t humidityI2cBus = HUMIDITY_I2C_BUS;
+int32_t statusLedPins[] = {STATUS_LED_2_PIN, STATUS_LED_3_PIN, STATUS_LED_4_PIN, STATUS_LED_5_PIN,
+                           STATUS_LED_6_PIN, STATUS_LED_7_PIN, STATUS_LED_8_PIN, STATUS_LED_9_PIN};
+int32_t pwmInputPins[] = {PWM_INPUT_1_PIN, PWM_INPUT_2_PIN, PWM_INPUT_3_PIN, PWM_INPUT_4_PIN,
+                          PWM_INPUT_5_PIN, PWM_INPUT_6_PIN, PWM_INPUT_7_PIN, PWM_INPUT_8_PIN};
+
+typedef struct
+{
+    const char* name;
+    int32_t* value;
+} PinSetting;
+
+PinSetting pinSettings[] =
+{
+    {"stayAlive", &stayAlivePin},
+    {"throttleIn", &throttleInPin},
+    {"temperatureAdc", &temperatureAdcChannel},
+    {"outsideTemperatureAdc", &outsideTemperatureAdcChannel},
+    {"humidityAdc", &humidityAdcChannel},
+    {"humidityI2c", &humidityI2cBus},
+    {"statusLed2", &statusLedPins[0]},
+    {"statusLed3", &statusLedPins[1]},
+    {"statusLed4", &statusLedPins[2]},
+    {"statusLed5", &statusLedPins[3]},
+    {"statusLed6", &statusLedPins[4]},
+    {"statusLed7", &statusLedPins[5]},
+    {"statusLed8", &statusLedPins[6]},
+    {"statusLed9", &statusLedPins[7]},
+    {"pwmInput1", &pwmInputPins[0]},
+    {"pwmInput2", &pwmInputPins[1]},
+    {"pwmInput3", &pwmInputPins[2]},
+    {"pwmInput4", &pwmInputPins[3]},
+    {"pwmInput5", &pwmInputPins[4]},
+    {"pwmInput6", &pwmInputPins[5]},
+    {"pwmInput7", &pwmInputPins[6]},
+    {"pwmInput8", &pwmInputPins[7]}
+};
+
+// Who the cell shield texts our position to, [cell] textNumber
+std::string cellTextNumber = "12537408798";
+
+// How long each stage of the loop takes, while stage timing is on
+LatencyHistogram consoleDrainLatency;
+LatencyHistogram transceiverDrainLatency;
+LatencyHistogram gpsDrainLatency;
+LatencyHistogram gpsDecodeLatency;
+LatencyHistogram imuDrainLatency;
+LatencyHistogram imuDecodeLatency;
+LatencyHistogram cellUpdateLatency;
+LatencyHistogram frameBuildLatency;
+LatencyHistogram uartWriteLatency;
+// Not a stage of the loop: from an rc input pulse falling to its servo position being written
+LatencyHistogram rcPassthroughLatency;
+
+// The debug tag each stage's latencies are sent as
+typedef struct
+{
+    const char* tag;
+    LatencyHistogram* histogram;
+} TimedStage;
 
-ADCSensor3008 temperatureAdc(1);
-TemperatureSensor temperatureSensor(&temperatureAdc);
+TimedStage timedStages[] =
+{
+    {"QC", &consoleDrainLatency},
+    {"QT", &transceiverDrainLatency},
+    {"QG", &gpsDrainLatency},
+    {"QD", &gpsDecodeLatency},
+    {"QI", &imuDrainLatency},
+    {"QY", &imuDecodeLatency},
+    {"QL", &cellUpdateLatency},
+    {"QF", &frameBuildLatency},
+    {"QW", &uartWriteLatency},
+    {"QR", &rcPassthroughLatency}
+};
+
+// Keeps every sample and raw serial chunk, made in main. NULL if not recording.
+FlightRecorder* flightRecorder = NULL;
+
+// Directory that each uart's received bytes are captured to, or NULL
+const char* captureDirectory = NULL;
+std::vector<FlightRecorder*> captureRecorders;
 
-GpioOutput stayAliveGpio(STAY_ALIVE_PIN);
+// Prefix of the capture segments to replay instead of using the uarts, or NULL.
+// When replaying a capture directory this is the directory, and each uart has its own segments.
+const char* replayPath = NULL;
+bool isReplayingDirectory = false;
+ReplayClock* replayClock = NULL;
 
-PWMSensor throttleIn(43);
-ServoDriver throttleOut(&servoDriverUart);
+// What the loop sleeps on between passes along with the schedule: the uarts' and the console's handles
+std::vector<struct pollfd> deviceHandles;
 
 //Keep track of the last of these critical values
 int32_t lastLatitude;
@@ -81,8 +325,8 @@ int32_t lastCellMnc;
 int32_t lastCellLac;
 int32_t lastCellCid;
 
-//Killswitch timeout, initialized to 10 minutes at startup
-long secondsToTimeout = 600;
+//Killswitch timeout, initialized to 10 minutes (or [timeouts] killSwitch) at startup
+long secondsToTimeout = KILL_SWITCH_SECONDS;
 bool hasKickedBucket = false;
 
 //Tags to be forwarded from cell-shield
@@ -91,8 +335,62 @@ char cellStoredTags[CELL_MAX_TAGS][3];
 char cellStoredData[CELL_MAX_TAGS][10];
 int cellStoredTagOn = 0;
 
-//Keep track of time, second by second
-uint64_t secondStartTime;
+// Runs everything that happens on a schedule, from telemetry to the status leds
+TaskScheduler scheduler;
+
+//Keep track of what new data we have gotten since the last telemetry frame
+bool gottenGps = false;
+bool gottenImu = false;
+
+// When we last heard from the gps with a fix and from the transceiver, for the status display
+uint64_t lastGpsFixNs = 0;
+uint64_t lastTransceiverTagNs = 0;
+uint64_t imuSentenceCount = 0;
+
+// Temperatures and humidity to send with the next telemetry frame
+char insideTemperature[10];
+char outsideTemperature[10];
+char relativeHumidity[10];
+bool gottenInsideTemp = false;
+bool gottenOutsideTemp = false;
+bool gottenHumidity = false;
+
+// Decides which tags go out over the transceiver in each telemetry frame
+TelemetryPolicy telemetryPolicy(TRANSCEIVER_BAUD, 500);
+// File of telemetry settings applied over the rules below, or NULL
+const char* telemetrySettingsPath = NULL;
+
+// How each tag is sent unless the telemetry settings say otherwise:
+// tag, period in ms, priority (0 is shed last) and deadband
+TelemetryRule telemetryRules[] =
+{
+    {"LV", 1000, 0, 0},
+    {"LA", 500, 0, 0},
+    {"LO", 500, 0, 0},
+    {"AL", 1000, 1, 0},
+    {"YA", 500, 1, 0.5},
+    {"PI", 500, 1, 0.5},
+    {"RO", 500, 1, 0.5},
+    {"SP", 1000, 2, 0},
+    {"TH", 1000, 2, 0},
+    {"MH", 1000, 2, 0},
+    {"DT", 10000, 2, 0},
+    // Which servo outputs are at their failsafe positions, one bit each
+    {"RF", 1000, 1, 0},
+    {"GS", 5000, 3, 0},
+    {"HD", 5000, 3, 0},
+    {"TI", 5000, 3, 0},
+    {"TO", 5000, 3, 0},
+    {"HU", 5000, 3, 0},
+    {"AX", 1000, 4, 0.05},
+    {"AY", 1000, 4, 0.05},
+    {"AZ", 1000, 4, 0.05},
+    // The cell tower seldom changes, so these mostly go out when it does
+    {"MC", 10000, 5, 0.5},
+    {"MN", 10000, 5, 0.5},
+    {"LC", 10000, 5, 0.5},
+    {"CD", 10000, 5, 0.5}
+};
 
 // What to current echo/output to the console - with flags!
 // 1 = console
@@ -101,7 +399,8 @@ uint64_t secondStartTime;
 // 8 = IMU
 // 16 = CELL_SHIELD
 // 32 = tag data
-// Default to everything!
+// 64 = stage latencies, timed and sent as Q? tags each second
+// Default to everything but the stage latencies!
 // The characters that manipulate this from the console are
 // ) to turn everything off
 // ! for console
@@ -110,25 +409,43 @@ uint64_t secondStartTime;
 // $ for imu
 // % for cell shield
 // ^ for tag data
-// These correspond to the characters that are Shift+(0-5)
+// & for stage latencies
+// These correspond to the characters that are Shift+(0-7)
 int debugEchoMode = 64 - 1;
 
-uint64_t millis()
+// Puts the current GPS values into the flight recorder
+void recordGpsSample()
 {
-    timeval currentTime;
-    gettimeofday(&currentTime, NULL);
-    return currentTime.tv_sec * 1000 + currentTime.tv_usec / 1000;
+    if (flightRecorder)
+    {
+        GpsSampleRecord sample;
+        sample.latitude = gpsDecoder.getLatitude();
+        sample.longitude = gpsDecoder.getLongitude();
+        sample.altitude = gpsDecoder.getAltitude();
+        sample.satelliteCount = gpsDecoder.getSatelliteCount();
+        sample.hdop = gpsDecoder.getHDOP();
+        sample.speed = gpsDecoder.getSpeed();
+        sample.trueHeading = gpsDecoder.getTrueHeading();
+        sample.magneticHeading = gpsDecoder.getMagneticHeading();
+        flightRecorder->recordGps(sample);
+    }
 }
 
-void setup()
+// Puts the current IMU values into the flight recorder
+void recordImuSample()
 {
-    //Configure stay-alive pin, start low
-    //Preferably, this pin will have a resistor
-    //between it and the killswitch circuit
-    stayAliveGpio.setValue(0);
-
-    //Start keeping track of time
-    secondStartTime = millis();
+    if (flightRecorder)
+    {
+        ImuSampleRecord sample;
+        Vector3D acceleration = imuDecoder.getAcceleration();
+        sample.yaw = imuDecoder.getYaw();
+        sample.pitch = imuDecoder.getPitch();
+        sample.roll = imuDecoder.getRoll();
+        sample.accelX = acceleration.coordX;
+        sample.accelY = acceleration.coordY;
+        sample.accelZ = acceleration.coordZ;
+        flightRecorder->recordImu(sample);
+    }
 }
 
 //Handles general-from-anywhere things
@@ -151,6 +468,18 @@ void baseHandleTag(const char* tag, const char* data)
             secondsToTimeout = seconds;
         }
     }
+    else if (strcmp(tag, "TP") == 0)
+    {
+        //Change how telemetry is sent, a line as in the settings file
+        if (telemetryPolicy.applySetting(data))
+        {
+            scheduler.setPeriod(scheduler.findTask("telemetry"), telemetryPolicy.getFramePeriodMs());
+        }
+        else
+        {
+            std::cout << "Could not apply telemetry setting: " << data << "\n";
+        }
+    }
 }
 
 // Only does it if there is space...
@@ -200,7 +529,7 @@ char getHexOfNibble(char c)
     }
 }
 
-void sendTag(const char* tag, const char* data, Uart& uart)
+void sendTag(const char* tag, const char* data, ISerial& uart)
 {
     if (data && *data)
     {
@@ -210,6 +539,7 @@ void sendTag(const char* tag, const char* data, Uart& uart)
         char hex1 = getHexOfNibble(checksum >> 4);
         char hex2 = getHexOfNibble(checksum);
 
+        StageTimer timer(&uartWriteLatency);
         uart << tag << '^' << data << ':' << hex1 << hex2;
     }
 }
@@ -237,7 +567,7 @@ void sendTag(const char* tag, T data, std::ostream& stream)
 }
 
 template<class T>
-void sendTag(const char* tag, T data, Uart& uart)
+void sendTag(const char* tag, T data, ISerial& uart)
 {
     std::stringstream convertOutput;
     convertOutput << data;
@@ -250,7 +580,7 @@ void sendTag(const char* tag, T data, Uart& uart)
 template<class T>
 void mainSendTag(const char* tag, T data)
 {
-    sendTag(tag, data, transceiverUart);
+    sendTag(tag, data, *transceiverUart);
     if (debugEchoMode & 32)
     {
         sendTag(tag, data, std::cout);
@@ -265,47 +595,80 @@ void mainSendTag(const char* tag, int32_t data)
     }
 }
 
-void cellShieldSendInformation()
+// Sends a tag the telemetry policy let into the frame
+void sendTelemetryTag(const char* tag, const char* data)
 {
-    std::stringstream completeText;
-    
-    static int sendCounter = 0;
+    mainSendTag(tag, data);
+}
+
+//Offers a number to the telemetry frame being built
+//As with mainSendTag, INT32_MIN is considered empty data
+template<class T>
+void offerTag(const char* tag, T data)
+{
+    std::stringstream convertOutput;
+    convertOutput << data;
+    telemetryPolicy.offer(tag, convertOutput.str().c_str(), data);
+}
 
-    // Send every several minutes...
-    sendCounter++;
-    if (sendCounter >= 600)
+void offerTag(const char* tag, int32_t data)
+{
+    if (data != INT32_MIN)
     {
-        sendCounter = 0;
+        offerTag<int32_t>(tag, data);
+    }
+}
 
-        sendTag("LA", lastLatitude, completeText);
-        sendTag("LO", lastLongitude, completeText);
-        sendTag("GS", lastSatelliteCount, completeText);
-        sendTag("DT", secondsToTimeout, completeText);
-        sendTag("LV", hasKickedBucket ? "0" : "1", completeText);
+void offerTag(const char* tag, const char* data)
+{
+    telemetryPolicy.offer(tag, data);
+}
 
-        cellDriver.queueTextMessage("12537408798", completeText.str().c_str());
+// Sends what each timed stage took since the last time as its Q? tag,
+// count,p50,p99,max with the times in nanoseconds
+void sendStageLatencies()
+{
+    const int stageCount = sizeof(timedStages) / sizeof(*timedStages);
+    static LatencySnapshot snapshots[stageCount];
+    
+    // Snapshot everything first, so that sending these tags is not counted in them
+    for (int i = 0; i < stageCount; i++)
+    {
+        timedStages[i].histogram->takeSnapshot(&snapshots[i]);
+    }
+    for (int i = 0; i < stageCount; i++)
+    {
+        std::stringstream latencies;
+        latencies << snapshots[i].count << ','
+                  << latencyPercentile(snapshots[i], 0.5) << ','
+                  << latencyPercentile(snapshots[i], 0.99) << ','
+                  << snapshots[i].maxNs;
+        mainSendTag(timedStages[i].tag, latencies.str().c_str());
     }
 }
 
-void loop()
+// Sends the last known position and state as a text, every 10 minutes
+void cellShieldSendInformation()
 {
-    char insideTemperature[10];
-    char outsideTemperature[10];
-    bool gottenInsideTemp = false;
-    bool gottenOutsideTemp = false;
-    
-    int32_t temperature = temperatureSensor.readTemperature();
+    std::stringstream completeText;
+
+    sendTag("LA", lastLatitude, completeText);
+    sendTag("LO", lastLongitude, completeText);
+    sendTag("GS", lastSatelliteCount, completeText);
+    sendTag("DT", secondsToTimeout, completeText);
+    sendTag("LV", hasKickedBucket ? "0" : "1", completeText);
 
-    //Keep track of what new data we have gotten
-    bool gottenGps = false;
-    bool gottenImu = false;
+    cellDriver->queueTextMessage(cellTextNumber.c_str(), completeText.str().c_str());
+}
 
-    //We will loop around getting data from all sources until a second has passed.
-    while (secondStartTime + 1000 > millis())
+// Takes whatever every device has for us, without waiting on any of them
+void pollDevices()
+{
+    //Check for data from all sources...
+    static TagParseData debuggingData;
+    int c = -1;
     {
-        //Check for data from all sources...
-        static TagParseData debuggingData;
-        int c = -1;
+        StageTimer timer(&consoleDrainLatency);
         while ((c = getchar()) != -1)
         {
             // See the comments of debugEchoMode for details...
@@ -313,6 +676,7 @@ void loop()
             {
                 case ')':
                     debugEchoMode = 0;
+                    setStageTiming(false);
                     break;
                 case '!':
                     debugEchoMode ^= 1;
@@ -328,11 +692,15 @@ void loop()
                     break;
                 case '%':
                     debugEchoMode ^= 16;
-                    cellDriver.shouldEchoUartToStdout = (debugEchoMode & 16);
+                    cellDriver->shouldEchoUartToStdout = (debugEchoMode & 16);
                     break;
                 case '^':
                     debugEchoMode ^= 32;
                     break;
+                case '&':
+                    debugEchoMode ^= 64;
+                    setStageTiming(debugEchoMode & 64);
+                    break;
             }
             if (debugEchoMode & 1)
             {
@@ -341,77 +709,153 @@ void loop()
             if (parseTag(c, &debuggingData))
             {
                 baseHandleTag(debuggingData.tag, debuggingData.data);
+                // parseTag hands us these, they are ours to free
+                free(debuggingData.tag);
+                free(debuggingData.data);
             }
         }
-        
-        static TagParseData transceiverData;
+    }
+    
+    static TagParseData transceiverData;
+    {
+        StageTimer timer(&transceiverDrainLatency);
         c = -1;
-        while ((c = transceiverUart.readByte()) != -1)
+        while ((c = transceiverUart->readByte()) != -1)
         {
             if (debugEchoMode & 2)
             {
                 std::cout << (char)c;
             }
-            
+        
             if (parseTag(c, &transceiverData))
             {
                 // Handle the tag we just marvelously got!
+                lastTransceiverTagNs = TaskScheduler::now();
                 baseHandleTag(transceiverData.tag, transceiverData.data);
+                free(transceiverData.tag);
+                free(transceiverData.data);
             }
         }
+    }
 
+    {
+        StageTimer timer(&gpsDrainLatency);
         c = -1;
-        while ((c = gpsUart.readByte()) != -1)
+        while ((c = gpsUart->readByte()) != -1)
         {
             if (debugEchoMode & 4)
             {
                 std::cout << (char)c;
             }
-            if (gpsDecoder.decodeByte(c))
+            bool isDecoded;
+            {
+                StageTimer decodeTimer(&gpsDecodeLatency);
+                isDecoded = gpsDecoder.decodeByte(c);
+            }
+            if (isDecoded)
             {
                 gottenGps = true;
+                if (gpsDecoder.getSatelliteCount() > 0 && gpsDecoder.getSatelliteCount() != INT32_MIN)
+                {
+                    lastGpsFixNs = TaskScheduler::now();
+                }
+                recordGpsSample();
             }
         }
+    }
 
+    {
+        StageTimer timer(&imuDrainLatency);
         c = -1;
-        while ((c = imuUart.readByte()) != -1)
+        while ((c = imuUart->readByte()) != -1)
         {
             if (debugEchoMode & 8)
             {
                 std::cout << (char)c;
             }
-            if (imuDecoder.decodeByte(c))
+            bool isDecoded;
+            {
+                StageTimer decodeTimer(&imuDecodeLatency);
+                isDecoded = imuDecoder.decodeByte(c);
+            }
+            if (isDecoded)
             {
                 gottenImu = true;
+                imuSentenceCount++;
+                recordImuSample();
             }
         }
-        
-        static TagParseData cellData;
-        if (cellDriver.update())
-        {
-            TextMessage textMessage = cellDriver.getTextMessage();
-            const char* messageData = textMessage.messageData.c_str();
-            int length = textMessage.messageData.length();
+    }
+    
+    static TagParseData cellData;
+    bool hasTextMessage;
+    {
+        StageTimer timer(&cellUpdateLatency);
+        hasTextMessage = cellDriver->update();
+    }
+    if (hasTextMessage)
+    {
+        TextMessage textMessage = cellDriver->getTextMessage();
+        const char* messageData = textMessage.messageData.c_str();
+        int length = textMessage.messageData.length();
 
-            for (int i = 0; i < length; i++)
+        for (int i = 0; i < length; i++)
+        {
+            if (parseTag(messageData[i], &cellData))
             {
-                if (parseTag(messageData[i], &cellData))
-                {
-                    cellShieldHandleTag(cellData.tag, cellData.data);
-                }
+                cellShieldHandleTag(cellData.tag, cellData.data);
+                free(cellData.tag);
+                free(cellData.data);
             }
-
-            // Remove it from the module. it is a gonner now.
-            cellDriver.deleteMessage(textMessage);
         }
-        
-        // Give up a little time to the system...
-        struct timespec sleepTime = {0, 1000};
-        nanosleep(&sleepTime, NULL);
+
+        // Remove it from the module. it is a gonner now.
+        cellDriver->deleteMessage(textMessage);
     }
-    //Notice the start time of this next second
-    secondStartTime += 1000;
+}
 
+// Records every adc channel's latest filtered value, if there has been a new one
+void updateAdc()
+{
+    // The log has to say how many of the bits are below the count, as the filters do
+    static_assert(FLIGHT_ADC_FRACTION_BITS == ADC_FILTER_FRACTION_BITS, "adc records have the filters' fraction bits");
+    AdcFilteredSnapshot snapshot;
+    adcAcquisition->getSnapshot(&snapshot);
+    if (!flightRecorder || snapshot.outputCount == adcRecordedOutput)
+    {
+        return;
+    }
+    adcRecordedOutput = snapshot.outputCount;
+    for (int channel = 0; channel < ADC_BANK_CHANNELS; channel++)
+    {
+        // With all the bits the filters give
+        flightRecorder->recordAdc(channel, snapshot.values[channel]);
+    }
+}
+
+// Writes a value with the decimal point fixed at the 1000s place to one decimal place.
+// Returns false for INT32_MIN, which is no value at all.
+bool formatFixedPoint(char* text, size_t size, int32_t value)
+{
+    if (value == INT32_MIN)
+    {
+        return false;
+    }
+    snprintf(text, size, "%.1f", value / 1000.0);
+    return true;
+}
+
+// Reads the temperatures and the humidity for the next telemetry frame
+void readTemperature()
+{
+    gottenInsideTemp = formatFixedPoint(insideTemperature, sizeof(insideTemperature), temperatureSensor->readTemperature());
+    gottenOutsideTemp = formatFixedPoint(outsideTemperature, sizeof(outsideTemperature), outsideTemperatureSensor->readTemperature());
+    gottenHumidity = formatFixedPoint(relativeHumidity, sizeof(relativeHumidity), humiditySensor->readRelativeHumidity());
+}
+
+// Counts down the kill switch timeout, once a second
+void updateTimeout()
+{
     //Actions for the living
     if (!hasKickedBucket)
     {
@@ -421,102 +865,465 @@ void loop()
             //Time to die!
             hasKickedBucket = true;
         }
-        static int secondsSinceToggle = 0;
-        static bool stayAliveUp = false;
-        //To indicate that the arduino is running correctly,
-        //we send out a 5-second high, 5-second low pulse
-        if (++secondsSinceToggle >= 5)
+    }
+}
+
+//To indicate that the arduino is running correctly,
+//we send out a 5-second high, 5-second low pulse
+void toggleStayAlive()
+{
+    static bool stayAliveUp = false;
+    if (!hasKickedBucket)
+    {
+        //Do a toggle!
+        stayAliveUp = !stayAliveUp;
+        stayAliveGpio->setValue(stayAliveUp);
+    }
+}
+
+// Sends out a frame of whatever the telemetry policy says is due
+void sendTelemetry()
+{
+    {
+        StageTimer timer(&frameBuildLatency);
+        telemetryPolicy.beginFrame(TaskScheduler::now() / 1000000);
+        //Offer ALL the data!
+        if (gottenInsideTemp)
+        {
+            telemetryPolicy.offer("TI", insideTemperature);
+        }
+        if (gottenOutsideTemp)
+        {
+            telemetryPolicy.offer("TO", outsideTemperature);
+        }
+        if (gottenHumidity)
+        {
+            telemetryPolicy.offer("HU", relativeHumidity);
+        }
+        if (gottenGps)
+        {
+            //offerTag("TM", gpsDecoder.getTime());
+            offerTag("HD", gpsDecoder.getHDOP());
+            offerTag("GS", gpsDecoder.getSatelliteCount());
+            offerTag("LO", gpsDecoder.getLongitude());
+            offerTag("LA", gpsDecoder.getLatitude());
+            offerTag("AL", gpsDecoder.getAltitude());
+        
+            offerTag("SP", gpsDecoder.getSpeed());
+            offerTag("TH", gpsDecoder.getTrueHeading());
+            offerTag("MH", gpsDecoder.getMagneticHeading());
+        
+            lastLongitude = gpsDecoder.getLongitude();
+            lastLatitude = gpsDecoder.getLatitude();
+            lastAltitude = gpsDecoder.getAltitude();
+            lastSatelliteCount = gpsDecoder.getSatelliteCount();
+        }
+        else
+        {
+            //Send the last found ones if we have nothing new
+            offerTag("LO", lastLongitude);
+            offerTag("LA", lastLatitude);
+            offerTag("AL", lastAltitude);
+        }
+        if (gottenImu)
+        {
+            offerTag("YA", imuDecoder.getYaw());
+            offerTag("PI", imuDecoder.getPitch());
+            offerTag("RO", imuDecoder.getRoll());
+            offerTag("AX", imuDecoder.getAcceleration().coordX);
+            offerTag("AY", imuDecoder.getAcceleration().coordY);
+            offerTag("AZ", imuDecoder.getAcceleration().coordZ);
+        }
+        offerTag("MC", lastCellMmc);
+        offerTag("MN", lastCellMnc);
+        offerTag("LC", lastCellLac);
+        offerTag("CD", lastCellCid);
+
+        //Life left...
+        offerTag("DT", secondsToTimeout);
+
+        offerTag("RF", (int32_t)rcPassthrough->getStats().failsafeOutputs);
+
+        //Liveliness!
+        offerTag("LV", hasKickedBucket ? "0" : "1");
+
+        //Extra tags passed from the cellular connection only come once, so they always go
+        while (cellStoredTagOn > 0)
         {
-            //Do a toggle!
-            secondsSinceToggle = 0;
-            stayAliveUp = !stayAliveUp;
-            stayAliveGpio.setValue(stayAliveUp);
+            cellStoredTagOn--;
+            mainSendTag(cellStoredTags[cellStoredTagOn], cellStoredData[cellStoredTagOn]);
         }
+
+        telemetryPolicy.endFrame(sendTelemetryTag);
     }
 
-    //Send out data -- ALL the data!
-    if (gottenInsideTemp)
+    // Meant for deliminating lines of tags...
+    if (debugEchoMode & 32)
     {
-        mainSendTag("TI", insideTemperature);
+        std::cout << "\n";
     }
-    if (gottenOutsideTemp)
+
+    // Ready for the next frame
+    gottenGps = false;
+    gottenImu = false;
+    gottenInsideTemp = false;
+    gottenOutsideTemp = false;
+    gottenHumidity = false;
+}
+
+void sendStageLatenciesIfTiming()
+{
+    if (debugEchoMode & 64)
     {
-        mainSendTag("TO", outsideTemperature);
+        sendStageLatencies();
     }
-    if (gottenGps)
+}
+
+// Shows how everything is doing on the status leds
+void updateStatusDisplay()
+{
+    static uint64_t lastUpdateNs = TaskScheduler::now();
+    static uint64_t lastImuSentenceCount = 0;
+    static uint64_t lastOverruns = 0;
+    static uint32_t lastDroppedRecords = 0;
+    static bool isHeartbeatOn = false;
+
+    uint64_t now = TaskScheduler::now();
+    statusDisplay->setLight(STATUS_GPS_FIX, lastGpsFixNs && now - lastGpsFixNs < STATUS_GPS_FIX_NS);
+    statusDisplay->setLight(STATUS_TRANSCEIVER_LINK, lastTransceiverTagNs && now - lastTransceiverTagNs < STATUS_TRANSCEIVER_LINK_NS);
+    statusDisplay->setLight(STATUS_CELL_REGISTERED, cellDriver->isRegistered());
+
+    if (now > lastUpdateNs)
     {
-        //mainSendTag("TM", gpsDecoder.getTime());
-        mainSendTag("HD", gpsDecoder.getHDOP());
-        mainSendTag("GS", gpsDecoder.getSatelliteCount());
-        mainSendTag("LO", gpsDecoder.getLongitude());
-        mainSendTag("LA", gpsDecoder.getLatitude());
-        mainSendTag("AL", gpsDecoder.getAltitude());
-        
-        mainSendTag("SP", gpsDecoder.getSpeed());
-        mainSendTag("TH", gpsDecoder.getTrueHeading());
-        mainSendTag("MH", gpsDecoder.getMagneticHeading());
-        
-        lastLongitude = gpsDecoder.getLongitude();
-        lastLatitude = gpsDecoder.getLatitude();
-        lastSatelliteCount = gpsDecoder.getSatelliteCount();
+        uint64_t imuRate = (imuSentenceCount - lastImuSentenceCount) * 1000000000ULL / (now - lastUpdateNs);
+        statusDisplay->setLight(STATUS_IMU_RATE, imuRate >= STATUS_MIN_IMU_RATE);
     }
-    else
+    lastImuSentenceCount = imuSentenceCount;
+    lastUpdateNs = now;
+
+    // Lit for as long as any task has overrun since the last update
+    uint64_t overruns = 0;
+    for (int task = 0; scheduler.getStats(task); task++)
     {
-        //Send the last found ones if we have nothing new
-        mainSendTag("LO", lastLongitude);
-        mainSendTag("LA", lastLatitude);
-        mainSendTag("AL", lastAltitude);
+        overruns += scheduler.getStats(task)->overruns;
     }
-    if (gottenImu)
+    statusDisplay->setLight(STATUS_LOOP_OVERRUN, overruns != lastOverruns);
+    lastOverruns = overruns;
+
+    if (flightRecorder)
     {
-        mainSendTag("YA", imuDecoder.getYaw());
-        mainSendTag("PI", imuDecoder.getPitch());
-        mainSendTag("RO", imuDecoder.getRoll());
-        mainSendTag("AX", imuDecoder.getAcceleration().coordX);
-        mainSendTag("AY", imuDecoder.getAcceleration().coordY);
-        mainSendTag("AZ", imuDecoder.getAcceleration().coordZ);
+        FlightRecorderStats recorderStats = flightRecorder->getStats();
+        statusDisplay->setLight(STATUS_RECORDER_BACKLOG,
+                                recorderStats.bytesWritten - recorderStats.bytesSynced > STATUS_RECORDER_BACKLOG_BYTES ||
+                                recorderStats.droppedRecords != lastDroppedRecords);
+        lastDroppedRecords = recorderStats.droppedRecords;
     }
-    mainSendTag("MC", lastCellMmc);
-    mainSendTag("MN", lastCellMnc);
-    mainSendTag("LC", lastCellLac);
-    mainSendTag("CD", lastCellCid);
-    //Send extra tags passed from the cellular connection
-    while (cellStoredTagOn > 0)
+
+    statusDisplay->setLight(STATUS_ALIVE, !hasKickedBucket);
+
+    // Blinks for as long as the loop is running
+    isHeartbeatOn = !isHeartbeatOn;
+    statusDisplay->setLight(STATUS_HEARTBEAT, isHeartbeatOn);
+
+    statusDisplay->show();
+}
+
+// The schedule, [tasks] in the config as "period, deadline" in milliseconds.
+// Tasks due at the same time run in this order, so the frame has the latest temperature and timeout.
+// The telemetry task runs at the telemetry policy's frame rate instead.
+typedef struct
+{
+    const char* name;
+    ScheduledFunction function;
+    int32_t periodMs;
+    int32_t deadlineMs;
+} MissionTask;
+
+MissionTask missionTasks[] =
+{
+    {"adc", updateAdc, 100, 20},
+    {"temperature", readTemperature, 1000, 200},
+    {"timeout", updateTimeout, 1000, 100},
+    {"stayAlive", toggleStayAlive, 5000, 500},
+    {"telemetry", sendTelemetry, 0, 100},
+    {"stageLatencies", sendStageLatenciesIfTiming, 1000, 100},
+    {"statusDisplay", updateStatusDisplay, 500, 100},
+    // Information sent to the cell shield arduino must be done separately to avoid overworking him.
+    {"cellText", cellShieldSendInformation, 600000, 1000}
+};
+
+// Reads where the pins and uarts are and the other startup only settings.
+// Must be done before the devices are made.
+void applyStartupConfig()
+{
+    for (size_t i = 0; i < sizeof(pinSettings) / sizeof(*pinSettings); i++)
     {
-        cellStoredTagOn--;
-        mainSendTag(cellStoredTags[cellStoredTagOn], cellStoredData[cellStoredTagOn]);
+        *pinSettings[i].value = config.getInt("pins", pinSettings[i].name, *pinSettings[i].value);
+    }
+    for (size_t i = 0; i < sizeof(serialDevices) / sizeof(*serialDevices); i++)
+    {
+        int32_t values[2] = {serialDevices[i].uartNumber, serialDevices[i].baudRate};
+        if (config.has("uarts", serialDevices[i].name) && config.getInts("uarts", serialDevices[i].name, values, 2) != 2)
+        {
+            std::cout << "Config: uarts." << serialDevices[i].name << " should be uart number, baud rate.\n";
+            continue;
+        }
+        serialDevices[i].uartNumber = values[0];
+        serialDevices[i].baudRate = values[1];
     }
+    secondsToTimeout = config.getInt("timeouts", "killSwitch", secondsToTimeout);
+    cellTextNumber = config.getString("cell", "textNumber", cellTextNumber.c_str());
+}
 
+// Changes the baud rates of the uarts to what the config says.
+// A uart cannot move to another number without a restart.
+void applyUartConfig()
+{
+    for (size_t i = 0; i < sizeof(serialDevices) / sizeof(*serialDevices); i++)
+    {
+        SerialDevice& device = serialDevices[i];
+        int32_t values[2] = {device.uartNumber, device.baudRate};
+        if (config.getInts("uarts", device.name, values, 2) != 2 || values[1] == device.baudRate)
+        {
+            continue;
+        }
+        if (values[0] != device.uartNumber)
+        {
+            std::cout << "Config: " << device.name << " stays on uart " << device.uartNumber << " until restarted.\n";
+        }
+        if (device.uart && !device.uart->setBaudRate(values[1]))
+        {
+            std::cout << "Config: could not change " << device.name << " to " << values[1] << " baud.\n";
+            continue;
+        }
+        device.baudRate = values[1];
+        if (device.serial == &transceiverUart)
+        {
+            telemetryPolicy.setBaudRate(device.baudRate);
+        }
+    }
+}
 
-    //Life left...
-    mainSendTag("DT", secondsToTimeout);
+// Sets the telemetry rules back to how they are built, then applies the [telemetry]
+// section (each line as "LA = 500, 0, 0") and the telemetry settings file over them
+void applyTelemetryConfig()
+{
+    for (size_t i = 0; i < sizeof(telemetryRules) / sizeof(*telemetryRules); i++)
+    {
+        telemetryPolicy.setRule(telemetryRules[i]);
+    }
+    std::vector<MissionConfigEntry> settings = config.getSection("telemetry");
+    for (size_t i = 0; i < settings.size(); i++)
+    {
+        std::string setting = settings[i].key + "," + settings[i].value;
+        if (!telemetryPolicy.applySetting(setting.c_str()))
+        {
+            std::cout << "Config: could not apply telemetry setting " << setting << "\n";
+        }
+    }
+    if (telemetrySettingsPath && !telemetryPolicy.loadFile(telemetrySettingsPath))
+    {
+        std::cout << "Could not read telemetry settings " << telemetrySettingsPath << ", using the defaults.\n";
+    }
+}
 
-    //Liveliness!
-    mainSendTag("LV", hasKickedBucket ? "0" : "1");
+// Changes the periods and deadlines of the scheduled tasks to what the config says
+void applyTaskConfig()
+{
+    for (size_t i = 0; i < sizeof(missionTasks) / sizeof(*missionTasks); i++)
+    {
+        int task = scheduler.findTask(missionTasks[i].name);
+        int32_t values[2] = {missionTasks[i].periodMs, missionTasks[i].deadlineMs};
+        if (missionTasks[i].function == sendTelemetry)
+        {
+            values[0] = telemetryPolicy.getFramePeriodMs();
+            config.getInts("tasks", missionTasks[i].name, &values[1], 1);
+        }
+        else
+        {
+            config.getInts("tasks", missionTasks[i].name, values, 2);
+        }
+        if (values[0] <= 0 || values[1] < 0)
+        {
+            std::cout << "Config: tasks." << missionTasks[i].name << " needs a period above 0.\n";
+            continue;
+        }
+        if (task == -1)
+        {
+            scheduler.addTask(missionTasks[i].name, missionTasks[i].function, values[0], values[1]);
+        }
+        else
+        {
+            scheduler.setPeriod(task, values[0]);
+            scheduler.setDeadline(task, values[1]);
+        }
+    }
+}
 
-    // Meant for deliminating lines of tags...
-    if (debugEchoMode & 32)
+// Works out every sensor's calibration table, as the [calibration] section gives it
+// ("points, conversion, value, ..." or "polynomial, c0, c1, ...") or as it is built
+void applyCalibrationConfig()
+{
+    for (size_t i = 0; i < sizeof(sensorCalibrations) / sizeof(*sensorCalibrations); i++)
     {
-        std::cout << "\n";
+        const SensorCalibration& calibration = sensorCalibrations[i];
+        if (config.has("calibration", calibration.name))
+        {
+            if (calibration.table->parse(config.getString("calibration", calibration.name, "")))
+            {
+                continue;
+            }
+            std::cout << "Config: calibration." << calibration.name << " makes no sense, keeping it as built.\n";
+        }
+        calibration.table->setPoints(calibration.points, calibration.pointCount);
     }
-    
-    // Information sent to the cell shield arduino must be done separately to avoid overworking him.
-    cellShieldSendInformation();
+}
 
-    // Switch a servo back and forth as a demonstration
-    static int servoToggle = 0;
-    if (servoToggle <= 0)
+// Sets the adc acquisition's rate, filters and spi clock from the [adc] section.
+// The filters only start over when they are changed.
+void applyAdcConfig()
+{
+    int32_t speedHz = config.getInt("adc", "spiSpeed", adcSpiSpeedHz);
+    if (adcBank->isReady() && (uint32_t)speedHz != adcBank->getSpeed() && !adcBank->setSpeed(speedHz))
     {
-        throttleOut.setSpeed(1,126);
-        throttleOut.setAngle(1,3500);
-        servoToggle = 1;
+        std::cout << "Config: adc.spiSpeed " << speedHz << " cannot be used, keeping " << adcBank->getSpeed() << ".\n";
     }
-    else
+    adcAcquisition->setRate(config.getInt("adc", "rate", adcRateHz));
+
+    int32_t filter[2] = {adcFilterOrder, adcDecimation};
+    if (config.has("adc", "filter") && config.getInts("adc", "filter", filter, 2) != 2)
+    {
+        std::cout << "Config: adc.filter should be order, decimation.\n";
+        return;
+    }
+    if (filter[0] == adcAcquisition->getOrder() && filter[1] == adcAcquisition->getDecimation())
+    {
+        return;
+    }
+    if (!adcAcquisition->setFilter(filter[0], filter[1]))
+    {
+        std::cout << "Config: adc.filter should be an order of 1 to " << ADC_MAX_FILTER_ORDER
+                  << " and a power of two decimation up to " << ADC_MAX_DECIMATION << ".\n";
+    }
+}
+
+// Sets the rc passthrough to how it is built, or to the [rc] section if it has any outputs:
+// "outputN = input, servo, failsafe, min, max" and "curveN = input us, position, input us, position, ..."
+void applyRcConfig()
+{
+    RcOutput outputs[RC_MAX_OUTPUTS];
+    int count = 0;
+    for (int n = 1; n <= RC_MAX_OUTPUTS; n++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "output%d", n);
+        if (!config.has("rc", key))
+        {
+            continue;
+        }
+        RcOutput& output = outputs[count];
+        int32_t values[5];
+        int32_t points[RC_MAX_CURVE_POINTS * 2];
+        char curveKey[16];
+        snprintf(curveKey, sizeof(curveKey), "curve%d", n);
+        int pointValues = config.getInts("rc", curveKey, points, RC_MAX_CURVE_POINTS * 2);
+        if (config.getInts("rc", key, values, 5) != 5 || pointValues < 4 || pointValues % 2 != 0)
+        {
+            std::cout << "Config: rc." << key << " should be input, servo, failsafe, min, max with a " << curveKey << " of at least two points.\n";
+            continue;
+        }
+        output.input = values[0];
+        output.servo = values[1];
+        output.failsafePosition = values[2];
+        output.minPosition = values[3];
+        output.maxPosition = values[4];
+        output.curvePointCount = pointValues / 2;
+        for (int point = 0; point < output.curvePointCount; point++)
+        {
+            output.curve[point].inputUs = points[point * 2];
+            output.curve[point].position = points[point * 2 + 1];
+        }
+        count++;
+    }
+    if (count == 0 || !rcPassthrough->setOutputs(outputs, count))
+    {
+        if (count != 0)
+        {
+            std::cout << "Config: the [rc] outputs make no sense, keeping them as built.\n";
+        }
+        rcPassthrough->setOutputs(rcOutputs, rcOutputCount);
+    }
+    rcPassthrough->setRate(config.getInt("rc", "rate", rcRateHz));
+    rcPassthrough->setStaleMs(config.getInt("rc", "staleMs", rcStaleMs));
+}
+
+// Set by SIGHUP to reread the config at the start of the next pass of the loop
+volatile sig_atomic_t isReloading = 0;
+
+void reloadConfig(int signalNumber)
+{
+    isReloading = 1;
+}
+
+// Rereads the config and applies what can be changed while running:
+// the baud rates, the telemetry rules, the schedule, the calibrations, the adc acquisition and the rc passthrough
+void reapplyConfig()
+{
+    if (!configPath || !config.load(configPath))
+    {
+        std::cout << "Config: nothing to reload, keeping the current settings.\n";
+        return;
+    }
+    applyUartConfig();
+    applyTelemetryConfig();
+    applyTaskConfig();
+    applyCalibrationConfig();
+    applyAdcConfig();
+    applyRcConfig();
+    std::cout << "Config: reloaded " << configPath << "\n";
+}
+
+void setup()
+{
+    //Configure stay-alive pin, start low
+    //Preferably, this pin will have a resistor
+    //between it and the killswitch circuit
+    stayAliveGpio->setValue(0);
+
+    applyTelemetryConfig();
+    applyTaskConfig();
+
+    applyAdcConfig();
+    if (adcBank->isReady())
+    {
+        adcAcquisition->start();
+    }
+
+    applyRcConfig();
+    rcPassthrough->start();
+}
+
+void loop()
+{
+    if (isReloading)
     {
-        throttleOut.setSpeed(1,50);
-        throttleOut.setAngle(1,1500);
-        servoToggle = 0;
+        isReloading = 0;
+        reapplyConfig();
     }
+    
+    pollDevices();
+    scheduler.runDue();
+    
+    // Sleep until a task is due or a device has bytes for us
+    scheduler.waitForDue(deviceHandles.data(), deviceHandles.size(), replayPath ? REPLAY_POLL_US : -1);
+}
+
+// Set by a signal to stop after the current pass of the loop, so the recorders are closed properly
+volatile sig_atomic_t isStopping = 0;
+
+void stopLoop(int signalNumber)
+{
+    isStopping = 1;
 }
 
 void restoreTerminal()
@@ -524,11 +1331,230 @@ void restoreTerminal()
     tcsetattr(0, TCSANOW, &oldTerminalSettings);
 }
 
+// Stops the recorder so that everything recorded is synced
+void closeFlightRecorder()
+{
+    delete flightRecorder;
+    flightRecorder = NULL;
+}
+
+// Stops the rc passthrough before the recorder it records to is closed
+void stopRcPassthrough()
+{
+    rcPassthrough->stop();
+}
+
+void stopAdcAcquisition()
+{
+    adcAcquisition->stop();
+}
+
+// Stops the per-uart capture recorders
+void closeCaptureRecorders()
+{
+    for (size_t i = 0; i < captureRecorders.size(); i++)
+    {
+        delete captureRecorders[i];
+    }
+    captureRecorders.clear();
+}
+
+// Makes the serial device for the given uart: a replay when replaying,
+// otherwise the uart itself, recorded and captured as asked for.
+ISerial* openSerial(SerialDevice& device)
+{
+    int uartNumber = device.uartNumber;
+    char path[256];
+    if (replayPath)
+    {
+        if (isReplayingDirectory)
+        {
+            snprintf(path, sizeof(path), "%s/ttyO%d", replayPath, uartNumber);
+        }
+        else
+        {
+            snprintf(path, sizeof(path), "%s", replayPath);
+        }
+        ReplayUart* replay = new ReplayUart(path, uartNumber, replayClock);
+        if (!replay->isReady())
+        {
+            std::cout << "Nothing to replay for uart " << uartNumber << " at " << path << ".\n";
+        }
+        return replay;
+    }
+
+    Uart* uart = new Uart(uartNumber, device.baudRate);
+    device.uart = uart;
+    if (flightRecorder)
+    {
+        uart->setRecorder(flightRecorder);
+    }
+    if (captureDirectory)
+    {
+        snprintf(path, sizeof(path), "%s/ttyO%d", captureDirectory, uartNumber);
+        // Only one uart's bytes, so much smaller segments than the flight log
+        FlightRecorder* capture = new FlightRecorder(path, 4 * 1024 * 1024);
+        if (capture->isReady())
+        {
+            uart->setCapture(capture);
+            captureRecorders.push_back(capture);
+        }
+        else
+        {
+            std::cout << "Could not capture uart " << uartNumber << " to " << path << ".\n";
+            delete capture;
+        }
+    }
+    return uart;
+}
+
 int main(int argc, char* argv[])
 {
+    // Where flight log segments go, -l to change, -L for none at all
+    const char* flightLogPrefix = "flight";
+    bool hasChosenFlightLog = false;
+    // How fast to replay, 1 being as recorded and 0 as fast as possible
+    double replaySpeed = 1;
+    
+    int option;
+    while ((option = getopt(argc, argv, "l:Lc:r:R:s:t:f:")) != -1)
+    {
+        switch (option)
+        {
+            case 'l':
+                flightLogPrefix = optarg;
+                hasChosenFlightLog = true;
+                break;
+            case 'L':
+                flightLogPrefix = NULL;
+                hasChosenFlightLog = true;
+                break;
+            case 'c':
+                captureDirectory = optarg;
+                break;
+            case 'r':
+                replayPath = optarg;
+                isReplayingDirectory = true;
+                break;
+            case 'R':
+                replayPath = optarg;
+                isReplayingDirectory = false;
+                break;
+            case 's':
+                replaySpeed = strtod(optarg, NULL);
+                break;
+            case 't':
+                telemetrySettingsPath = optarg;
+                break;
+            case 'f':
+                configPath = optarg;
+                break;
+            default:
+                fprintf(stderr, "%s: [-l flight log prefix] [-L] [-c capture directory] [-r capture directory] [-R flight log prefix] [-s replay speed] [-t telemetry settings] [-f config]\n", argv[0]);
+                fprintf(stderr, "-c captures each uart to <directory>/ttyO#, -r replays such a capture and -R replays a flight log.\n");
+                return -1;
+        }
+    }
+    // A replay should not write over the flight logs unless asked to
+    if (replayPath && !hasChosenFlightLog)
+    {
+        flightLogPrefix = NULL;
+    }
+    
     //Unbuffered output, so the file can be read in as streamed.
     setvbuf(stdout, NULL, _IONBF, 0);
     
+    if (flightLogPrefix)
+    {
+        flightRecorder = new FlightRecorder(flightLogPrefix);
+        if (flightRecorder->isReady())
+        {
+            atexit(closeFlightRecorder);
+        }
+        else
+        {
+            // We fly without it rather than not at all
+            std::cout << "Flight recorder could not start, not recording.\n";
+            closeFlightRecorder();
+        }
+    }
+    
+    if (replayPath)
+    {
+        replayClock = new ReplayClock(replaySpeed);
+    }
+    
+    if (configPath && !config.load(configPath))
+    {
+        std::cout << "Could not read config " << configPath << ", using the defaults.\n";
+    }
+    applyStartupConfig();
+    
+    for (size_t i = 0; i < sizeof(serialDevices) / sizeof(*serialDevices); i++)
+    {
+        *serialDevices[i].serial = openSerial(serialDevices[i]);
+        struct pollfd handle = {serialDevices[i].uart ? serialDevices[i].uart->getReadHandle() : -1, POLLIN, 0};
+        if (handle.fd != -1)
+        {
+            deviceHandles.push_back(handle);
+        }
+    }
+    // The console only when it is a terminal; anything else at its end would never stop waking us
+    if (isatty(0))
+    {
+        struct pollfd console = {0, POLLIN, 0};
+        deviceHandles.push_back(console);
+    }
+    atexit(closeCaptureRecorders);
+    // The transceiver is the first device, its baud rate is what telemetry has to work with
+    telemetryPolicy.setBaudRate(serialDevices[0].baudRate);
+    
+    const int32_t adcChannels[ADC_BANK_CHANNELS] = {0, 1, 2, 3, 4, 5, 6, 7};
+    adcBank = new ADCBank3008(adcChannels, ADC_BANK_CHANNELS);
+    if (!adcBank->isReady())
+    {
+        std::cout << "Could not set up the adc.\n";
+    }
+    adcAcquisition = new AdcAcquisition(adcBank);
+    adcAcquisition->setFilter(adcFilterOrder, adcDecimation);
+    atexit(stopAdcAcquisition);
+    temperatureAdc = new ADCSensor3008(adcAcquisition, temperatureAdcChannel);
+    applyCalibrationConfig();
+    temperatureSensor = new TemperatureSensor(temperatureAdc, &insideTemperatureCalibration);
+    outsideTemperatureAdc = new ADCSensor3008(adcAcquisition, outsideTemperatureAdcChannel);
+    outsideTemperatureSensor = new TemperatureSensor(outsideTemperatureAdc, &outsideTemperatureCalibration);
+    if (humidityI2cBus >= 0)
+    {
+        humidityI2c = new I2cDevice(humidityI2cBus, HIH6130_ADDRESS);
+        if (!humidityI2c->isReady())
+        {
+            std::cout << "Could not set up the humidity sensor.\n";
+        }
+        humiditySensor = new HumiditySensor(humidityI2c);
+    }
+    else
+    {
+        humidityAdc = new ADCSensor3008(adcAcquisition, humidityAdcChannel);
+        humiditySensor = new HumiditySensor(humidityAdc, &humidityCalibration);
+    }
+    stayAliveGpio = new GpioOutput(stayAlivePin);
+    statusDisplay = new StatusDisplay(statusLedPins, sizeof(statusLedPins) / sizeof(*statusLedPins));
+    if (!statusDisplay->isReady())
+    {
+        std::cout << "Could not set up the status leds.\n";
+    }
+    throttleIn = new PWMSensor(throttleInPin, THROTTLE_FILTER_LENGTH, THROTTLE_JITTER_US);
+    pwmInputs = new PwmInputBank(pwmInputPins, sizeof(pwmInputPins) / sizeof(*pwmInputPins));
+    if (!pwmInputs->isReady())
+    {
+        std::cout << "Could not capture the pwm inputs.\n";
+    }
+    
+    cellDriver = new CellDriver(cellUart);
+    throttleOut = new ServoDriver(servoDriverUart);
+    rcPassthrough = new RcPassthrough(throttleIn, pwmInputs, throttleOut, flightRecorder, &rcPassthroughLatency);
+    atexit(stopRcPassthrough);
+    
     //Don't wait for newline to get stdin input
     struct termios terminalSettings;
     if (tcgetattr(0, &terminalSettings) < 0)
@@ -559,9 +1585,14 @@ int main(int argc, char* argv[])
     // do initialization
     setup();
     
-    // Perform our main loop FOREVER!
-    while (1)
+    signal(SIGTERM, stopLoop);
+    signal(SIGINT, stopLoop);
+    signal(SIGHUP, reloadConfig);
+    
+    // Perform our main loop FOREVER! Or until told to stop.
+    while (!isStopping)
     {
         loop();
     }
+    return 0;
 }
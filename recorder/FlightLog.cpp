@@ -0,0 +1,172 @@
+#include "FlightLog.h"
+#include "crc32.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+uint32_t flightRecordChecksum(const FlightRecordHeader* header, const void* payload)
+{
+    // Everything in the header after the crc itself
+    const uint8_t* checkedHeader = (const uint8_t*)&header->timestamp;
+    size_t checkedHeaderLength = sizeof(FlightRecordHeader) - (checkedHeader - (const uint8_t*)header);
+
+    uint32_t checksum = crc32(checkedHeader, checkedHeaderLength, 0);
+    return crc32(payload, header->length, checksum);
+}
+
+const char* flightRecordTypeName(int type)
+{
+    switch (type)
+    {
+        case FLIGHT_RECORD_SEGMENT_START:
+            return "SEGMENT";
+        case FLIGHT_RECORD_SERIAL_RX:
+            return "SERIAL";
+        case FLIGHT_RECORD_GPS:
+            return "GPS";
+        case FLIGHT_RECORD_IMU:
+            return "IMU";
+        case FLIGHT_RECORD_ADC:
+            return "ADC";
+        case FLIGHT_RECORD_PWM:
+            return "PWM";
+    }
+    return "UNKNOWN";
+}
+
+FlightLogReader::FlightLogReader(const char* path)
+{
+    data = NULL;
+    dataSize = 0;
+    ownsData = true;
+    position = 0;
+    corruptCount = 0;
+
+    int handle = open(path, O_RDONLY);
+    if (handle == -1)
+    {
+        perror("FlightLogReader: opening segment");
+        return;
+    }
+
+    struct stat fileStatus;
+    if (fstat(handle, &fileStatus) == -1 || fileStatus.st_size == 0)
+    {
+        close(handle);
+        return;
+    }
+
+    void* mapping = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_SHARED, handle, 0);
+    // The mapping stays valid without the file handle
+    close(handle);
+    if (mapping == MAP_FAILED)
+    {
+        perror("FlightLogReader: mapping segment");
+        return;
+    }
+
+    // We read front to back
+    madvise(mapping, fileStatus.st_size, MADV_SEQUENTIAL);
+
+    data = (const uint8_t*)mapping;
+    dataSize = fileStatus.st_size;
+}
+
+FlightLogReader::FlightLogReader(const uint8_t* data, uint64_t size)
+{
+    this->data = data;
+    dataSize = size;
+    ownsData = false;
+    position = 0;
+    corruptCount = 0;
+}
+
+FlightLogReader::~FlightLogReader()
+{
+    if (data && ownsData)
+    {
+        munmap((void*)data, dataSize);
+    }
+}
+
+bool FlightLogReader::isReady() const
+{
+    return data != NULL;
+}
+
+bool FlightLogReader::isValidRecordAt(uint64_t offset) const
+{
+    if (offset + sizeof(FlightRecordHeader) > dataSize)
+    {
+        return false;
+    }
+
+    const FlightRecordHeader* header = (const FlightRecordHeader*)(data + offset);
+    if (header->magic != FLIGHT_RECORD_MAGIC ||
+        header->length > FLIGHT_RECORD_MAX_PAYLOAD ||
+        offset + sizeof(FlightRecordHeader) + header->length > dataSize)
+    {
+        return false;
+    }
+
+    return header->crc == flightRecordChecksum(header, header + 1);
+}
+
+bool FlightLogReader::next(FlightRecordView* record)
+{
+    bool hasSkipped = false;
+    while (position + sizeof(FlightRecordHeader) <= dataSize)
+    {
+        if (isValidRecordAt(position))
+        {
+            if (hasSkipped)
+            {
+                corruptCount++;
+            }
+
+            record->header = (const FlightRecordHeader*)(data + position);
+            record->payload = (const uint8_t*)(record->header + 1);
+            record->offset = position;
+            position += flightRecordSize(record->header->length);
+            return true;
+        }
+
+        // Not a record here. Either we are at the zeroed end of the segment
+        // or a record was torn. Look for the next magic on a record boundary.
+        // Writeback of a mapping is not ordered, so there may be good records after a hole.
+        hasSkipped = true;
+        position += FLIGHT_RECORD_ALIGNMENT;
+        while (position + sizeof(FlightRecordHeader) <= dataSize &&
+               ((const FlightRecordHeader*)(data + position))->magic != FLIGHT_RECORD_MAGIC)
+        {
+            position += FLIGHT_RECORD_ALIGNMENT;
+        }
+    }
+
+    position = dataSize;
+    return false;
+}
+
+void FlightLogReader::seek(uint64_t offset)
+{
+    // Keep record alignment, whatever we are given
+    position = offset & ~(uint64_t)(FLIGHT_RECORD_ALIGNMENT - 1);
+}
+
+uint64_t FlightLogReader::tell() const
+{
+    return position;
+}
+
+uint64_t FlightLogReader::size() const
+{
+    return dataSize;
+}
+
+uint32_t FlightLogReader::getCorruptCount() const
+{
+    return corruptCount;
+}
@@ -0,0 +1,184 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef FLIGHT_LOG
+#define FLIGHT_LOG
+
+// On-disk format of the flight recorder log segments.
+//
+// A segment is a preallocated file of back-to-back records. Every record is a
+// FlightRecordHeader followed by length bytes of payload, padded with zeros so the
+// next header starts on an 8-byte boundary. The unused tail of a segment is all zeros,
+// so a header with a zero magic marks the end of the recorded data.
+//
+// The payload is written before the header, and the header carries a CRC-32 of
+// itself and the payload. A record torn by a crash or power loss therefore fails its
+// check and is skipped by the reader, which then scans forward for the next magic.
+
+// "FLRC" in little-endian
+#define FLIGHT_RECORD_MAGIC 0x43524c46u
+
+// Records are aligned to this many bytes within a segment
+#define FLIGHT_RECORD_ALIGNMENT 8
+
+// The largest payload a single record may carry
+#define FLIGHT_RECORD_MAX_PAYLOAD 4096
+
+enum FlightRecordType
+{
+    // First record of every segment. Payload is a SegmentStartRecord.
+    FLIGHT_RECORD_SEGMENT_START = 1,
+    // A chunk of bytes received on a serial port. Source is the uart number.
+    FLIGHT_RECORD_SERIAL_RX = 2,
+    // A decoded GPS fix. Payload is a GpsSampleRecord.
+    FLIGHT_RECORD_GPS = 3,
+    // A decoded IMU sample. Payload is an ImuSampleRecord.
+    FLIGHT_RECORD_IMU = 4,
+    // An ADC value. Source is the adc channel. Payload is an AdcSampleRecord.
+    FLIGHT_RECORD_ADC = 5,
+    // A PWM input reading. Payload is a PwmSampleRecord.
+    FLIGHT_RECORD_PWM = 6
+};
+
+typedef struct
+{
+    uint32_t magic;
+    // CRC-32 of the header bytes following this field, then of the payload
+    uint32_t crc;
+    // CLOCK_MONOTONIC nanoseconds at the time the record was appended
+    uint64_t timestamp;
+    // Payload bytes, not including padding
+    uint16_t length;
+    uint8_t type;
+    uint8_t source;
+    // Counts up by one for every record of a recorder, across segments,
+    // so gaps from dropped or corrupt records can be noticed.
+    uint32_t sequence;
+} FlightRecordHeader;
+
+typedef struct
+{
+    // CLOCK_REALTIME nanoseconds taken at the same moment as the header timestamp,
+    // so monotonic timestamps can be turned into wall-clock time.
+    uint64_t realTime;
+    // Counts up from 0 for each segment of a recorder
+    uint32_t segmentNumber;
+    uint32_t reserved;
+} SegmentStartRecord;
+
+// Same units as GPSDecoder; INT32_MIN for values that have not been decoded.
+typedef struct
+{
+    int32_t latitude;
+    int32_t longitude;
+    int32_t altitude;
+    int32_t satelliteCount;
+    int32_t hdop;
+    int32_t speed;
+    int32_t trueHeading;
+    int32_t magneticHeading;
+} GpsSampleRecord;
+
+// Same units as IMUDecoder
+typedef struct
+{
+    double yaw;
+    double pitch;
+    double roll;
+    double accelX;
+    double accelY;
+    double accelZ;
+} ImuSampleRecord;
+
+// Bits of an AdcSampleRecord's value below the count of the 10-bit conversion,
+// as the adc filters give them (ADC_FILTER_FRACTION_BITS)
+#define FLIGHT_ADC_FRACTION_BITS 6
+
+typedef struct
+{
+    // 10-bit conversion in 1/64ths of a count, as from AdcAcquisition, -1 for none
+    int32_t value;
+} AdcSampleRecord;
+
+typedef struct
+{
+    int32_t gpio;
+    // Same fixed-point value as PWMSensor
+    int32_t value;
+} PwmSampleRecord;
+
+// Rounds a record of the given payload length up to its full size within a segment.
+inline size_t flightRecordSize(size_t payloadLength)
+{
+    size_t size = sizeof(FlightRecordHeader) + payloadLength;
+    return (size + FLIGHT_RECORD_ALIGNMENT - 1) & ~(size_t)(FLIGHT_RECORD_ALIGNMENT - 1);
+}
+
+// Calculates the crc field for a header (whose other fields are filled in) and payload.
+uint32_t flightRecordChecksum(const FlightRecordHeader* header, const void* payload);
+
+// Returns a short upper-case name for a record type, or "UNKNOWN".
+const char* flightRecordTypeName(int type);
+
+// A record found by the FlightLogReader. Pointers are into the reader's mapping
+// and remain valid as long as the reader does.
+typedef struct
+{
+    const FlightRecordHeader* header;
+    const uint8_t* payload;
+    // Byte offset of the header within the segment
+    uint64_t offset;
+} FlightRecordView;
+
+// Reads the records of a single log segment by mapping it into memory.
+// Torn or corrupt records are skipped rather than ending the read.
+class FlightLogReader
+{
+    public:
+
+    // Maps the given segment file read-only.
+    // If anything goes wrong, isReady() will return false.
+    FlightLogReader(const char* path);
+    
+    // Reads a segment that is already in memory, such as the recorder's own mapping.
+    // The memory is not ours and must outlive the reader.
+    FlightLogReader(const uint8_t* data, uint64_t size);
+    ~FlightLogReader();
+
+    bool isReady() const;
+
+    // Finds the next valid record at or after the current position.
+    // Returns false when the end of the recorded data is reached.
+    bool next(FlightRecordView* record);
+
+    // Moves the reading position to the given byte offset, which should be
+    // the offset of a record (as from a FlightRecordView or an index).
+    void seek(uint64_t offset);
+
+    // The byte offset at which next() will begin looking
+    uint64_t tell() const;
+
+    // Size of the mapped segment in bytes
+    uint64_t size() const;
+
+    // How many times next() had to skip over bytes that were not a valid record
+    uint32_t getCorruptCount() const;
+
+    private:
+
+    // Not copyable, we own the mapping
+    FlightLogReader(const FlightLogReader&);
+    FlightLogReader& operator=(const FlightLogReader&);
+
+    // Whether a valid record starts at the given offset
+    bool isValidRecordAt(uint64_t offset) const;
+
+    const uint8_t* data;
+    uint64_t dataSize;
+    // Whether data is a mapping we made and must unmap
+    bool ownsData;
+    uint64_t position;
+    uint32_t corruptCount;
+};
+
+#endif
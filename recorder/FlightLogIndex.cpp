@@ -0,0 +1,109 @@
+#include "FlightLogIndex.h"
+#include <stdio.h>
+#include <algorithm>
+
+FlightLogIndex::FlightLogIndex()
+{
+    segmentSize = 0;
+}
+
+void FlightLogIndex::build(FlightLogReader& reader, uint64_t intervalNs)
+{
+    entries.clear();
+    segmentSize = reader.size();
+
+    reader.seek(0);
+    FlightRecordView record;
+    uint64_t nextEntryTime = 0;
+    while (reader.next(&record))
+    {
+        uint64_t time = record.header->timestamp;
+        if (entries.empty() || time >= nextEntryTime)
+        {
+            FlightIndexEntry entry;
+            entry.timestamp = time;
+            entry.offset = record.offset;
+            entries.push_back(entry);
+            nextEntryTime = time + intervalNs;
+        }
+    }
+}
+
+bool FlightLogIndex::load(const char* path, uint64_t segmentSize)
+{
+    entries.clear();
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    FlightIndexHeader header;
+    bool isGood = fread(&header, sizeof(header), 1, file) == 1 &&
+                  header.magic == FLIGHT_INDEX_MAGIC &&
+                  header.version == FLIGHT_INDEX_VERSION &&
+                  header.segmentSize == segmentSize;
+    if (isGood)
+    {
+        entries.resize(header.entryCount);
+        isGood = header.entryCount == 0 ||
+                 fread(&entries[0], sizeof(FlightIndexEntry), header.entryCount, file) == header.entryCount;
+    }
+    fclose(file);
+
+    if (!isGood)
+    {
+        entries.clear();
+        return false;
+    }
+    this->segmentSize = segmentSize;
+    return true;
+}
+
+bool FlightLogIndex::save(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        perror("FlightLogIndex: creating index");
+        return false;
+    }
+
+    FlightIndexHeader header;
+    header.magic = FLIGHT_INDEX_MAGIC;
+    header.version = FLIGHT_INDEX_VERSION;
+    header.segmentSize = segmentSize;
+    header.entryCount = entries.size();
+
+    bool isGood = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  (entries.empty() || fwrite(&entries[0], sizeof(FlightIndexEntry), entries.size(), file) == entries.size());
+    return (fclose(file) == 0) && isGood;
+}
+
+static bool isBeforeEntry(uint64_t timestamp, const FlightIndexEntry& entry)
+{
+    return timestamp < entry.timestamp;
+}
+
+uint64_t FlightLogIndex::findOffset(uint64_t timestamp) const
+{
+    // The first entry later than the time; the one before it is where to start
+    std::vector<FlightIndexEntry>::const_iterator after =
+        std::upper_bound(entries.begin(), entries.end(), timestamp, isBeforeEntry);
+    if (after == entries.begin())
+    {
+        return 0;
+    }
+    return (after - 1)->offset;
+}
+
+uint64_t FlightLogIndex::getFirstTimestamp() const
+{
+    return entries.empty() ? 0 : entries[0].timestamp;
+}
+
+std::string FlightLogIndex::pathFor(const char* segmentPath)
+{
+    return std::string(segmentPath) + ".idx";
+}
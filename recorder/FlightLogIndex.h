@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include "FlightLog.h"
+
+#ifndef FLIGHT_LOG_INDEX
+#define FLIGHT_LOG_INDEX
+
+// "FLIX" in little-endian
+#define FLIGHT_INDEX_MAGIC 0x58494c46u
+#define FLIGHT_INDEX_VERSION 1
+
+// By default, one index entry per this many nanoseconds of recording
+#define FLIGHT_INDEX_DEFAULT_INTERVAL 100000000ULL
+
+// A sparse index file sits beside each segment as <segment>.idx.
+// It is a FlightIndexHeader followed by entryCount FlightIndexEntry,
+// in increasing timestamp order.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    // Size of the segment the index was built from, so a stale index can be noticed
+    uint64_t segmentSize;
+    uint64_t entryCount;
+} FlightIndexHeader;
+
+typedef struct
+{
+    uint64_t timestamp;
+    uint64_t offset;
+} FlightIndexEntry;
+
+// Maps record timestamps to their byte offsets within one segment,
+// so a time range can be found without scanning the whole segment.
+class FlightLogIndex
+{
+    public:
+
+    FlightLogIndex();
+
+    // Scans every record from the reader, keeping an entry at least every intervalNs.
+    // The first record always gets an entry.
+    void build(FlightLogReader& reader, uint64_t intervalNs = FLIGHT_INDEX_DEFAULT_INTERVAL);
+
+    // Loads an index file. Returns false if it is missing, damaged,
+    // or was made for a segment of a different size than segmentSize.
+    bool load(const char* path, uint64_t segmentSize);
+
+    // Writes the index file. Returns false on error.
+    bool save(const char* path) const;
+
+    // The offset of the latest indexed record at or before the given time,
+    // which is where a reader should start looking for that time.
+    // 0 if the time is before all entries.
+    uint64_t findOffset(uint64_t timestamp) const;
+
+    // Timestamp of the first indexed record, or 0 if empty
+    uint64_t getFirstTimestamp() const;
+
+    // The index file name that belongs to a segment
+    static std::string pathFor(const char* segmentPath);
+
+    private:
+
+    uint64_t segmentSize;
+    std::vector<FlightIndexEntry> entries;
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include "FlightRecorder.h"
+#include "FlightLogIndex.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <chrono>
+
+// Builds <prefix>-NNNN.flog
+static std::string segmentPath(const std::string& prefix, uint32_t number)
+{
+    char suffix[24];
+    snprintf(suffix, sizeof(suffix), "-%04u.flog", number);
+    return prefix + suffix;
+}
+
+uint64_t FlightRecorder::timestamp()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+FlightRecorder::FlightRecorder(const char* pathPrefix, uint32_t segmentBytes, int32_t syncIntervalMs)
+{
+    this->pathPrefix = pathPrefix;
+    // Leave room for at least a segment start and one full size record
+    uint64_t minimumBytes = 2 * flightRecordSize(FLIGHT_RECORD_MAX_PAYLOAD);
+    this->segmentBytes = (segmentBytes < minimumBytes) ? minimumBytes : segmentBytes;
+    this->syncIntervalMs = (syncIntervalMs < 1) ? 1 : syncIntervalMs;
+
+    hasCurrent = false;
+    hasSpare = false;
+    nextSequence = 0;
+    nextSegmentNumber = 0;
+    bytesWrittenBefore = 0;
+    bytesSyncedBefore = 0;
+    droppedRecords = 0;
+    isStopping = false;
+
+    // The first segment is opened right here, so we know whether we are ready
+    if (!openSegment(nextSegmentNumber++, &current))
+    {
+        return;
+    }
+    hasCurrent = true;
+
+    SegmentStartRecord start;
+    memset(&start, 0, sizeof(start));
+    uint64_t time = timestamp();
+    struct timespec realNow;
+    clock_gettime(CLOCK_REALTIME, &realNow);
+    start.realTime = (uint64_t)realNow.tv_sec * 1000000000ULL + realNow.tv_nsec;
+    start.segmentNumber = current.number;
+    writeRecord(FLIGHT_RECORD_SEGMENT_START, 0, &start, sizeof(start), time);
+
+    flusher = std::thread(&FlightRecorder::flusherMain, this);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    if (flusher.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(recordLock);
+            isStopping = true;
+        }
+        flusherWakeup.notify_one();
+        flusher.join();
+    }
+    else if (hasCurrent)
+    {
+        closeSegment(&current);
+    }
+}
+
+bool FlightRecorder::isReady() const
+{
+    return hasCurrent;
+}
+
+bool FlightRecorder::openSegment(uint32_t number, Segment* segment)
+{
+    std::string path = segmentPath(pathPrefix, number);
+    int handle = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (handle == -1)
+    {
+        perror("FlightRecorder: creating segment");
+        return false;
+    }
+
+    // Reserve the blocks up front so appending never has to allocate.
+    // Not every filesystem supports this, so fall back to just sizing the file.
+    if (posix_fallocate(handle, 0, segmentBytes) != 0 &&
+        ftruncate(handle, segmentBytes) == -1)
+    {
+        perror("FlightRecorder: sizing segment");
+        close(handle);
+        return false;
+    }
+
+    void* mapping = mmap(NULL, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+    if (mapping == MAP_FAILED)
+    {
+        perror("FlightRecorder: mapping segment");
+        close(handle);
+        return false;
+    }
+
+    segment->handle = handle;
+    segment->mapping = (uint8_t*)mapping;
+    segment->size = segmentBytes;
+    segment->writeOffset = 0;
+    segment->syncOffset = 0;
+    segment->number = number;
+    return true;
+}
+
+void FlightRecorder::closeSegment(Segment* segment)
+{
+    msync(segment->mapping, segment->writeOffset, MS_SYNC);
+    
+    // Index it while it is still mapped, so queries need not scan it later
+    if (segment->writeOffset > 0)
+    {
+        FlightLogReader reader(segment->mapping, segment->writeOffset);
+        FlightLogIndex index;
+        index.build(reader);
+        index.save(FlightLogIndex::pathFor(segmentPath(pathPrefix, segment->number).c_str()).c_str());
+    }
+    munmap(segment->mapping, segment->size);
+
+    // Give back the preallocated space we did not use
+    if (ftruncate(segment->handle, segment->writeOffset) == -1)
+    {
+        perror("FlightRecorder: trimming segment");
+    }
+    fsync(segment->handle);
+    close(segment->handle);
+
+    // An unused spare has nothing worth keeping
+    if (segment->writeOffset == 0)
+    {
+        unlink(segmentPath(pathPrefix, segment->number).c_str());
+    }
+}
+
+void FlightRecorder::writeRecord(uint8_t type, uint8_t source, const void* payload, uint16_t length, uint64_t time)
+{
+    FlightRecordHeader* header = (FlightRecordHeader*)(current.mapping + current.writeOffset);
+
+    // Payload first; the header is what makes the record count.
+    // The padding after it is already zero from the fresh file.
+    memcpy(header + 1, payload, length);
+
+    header->timestamp = time;
+    header->length = length;
+    header->type = type;
+    header->source = source;
+    header->sequence = nextSequence++;
+    header->crc = flightRecordChecksum(header, payload);
+    header->magic = FLIGHT_RECORD_MAGIC;
+
+    size_t size = flightRecordSize(length);
+    current.writeOffset += size;
+    bytesWrittenBefore += size;
+}
+
+bool FlightRecorder::append(uint8_t type, uint8_t source, const void* payload, uint16_t length)
+{
+    if (length > FLIGHT_RECORD_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(recordLock);
+    // The time is taken under the lock so that timestamps never go
+    // backwards within a segment, which the index depends on.
+    uint64_t time = timestamp();
+    if (!hasCurrent)
+    {
+        droppedRecords++;
+        return false;
+    }
+
+    if (current.writeOffset + flightRecordSize(length) > current.size)
+    {
+        // Switch to the spare the flusher prepared, or drop if it has not yet
+        if (!hasSpare)
+        {
+            droppedRecords++;
+            return false;
+        }
+        retired.push_back(current);
+        current = spare;
+        hasSpare = false;
+
+        SegmentStartRecord start;
+        memset(&start, 0, sizeof(start));
+        struct timespec realNow;
+        clock_gettime(CLOCK_REALTIME, &realNow);
+        start.realTime = (uint64_t)realNow.tv_sec * 1000000000ULL + realNow.tv_nsec;
+        start.segmentNumber = current.number;
+        writeRecord(FLIGHT_RECORD_SEGMENT_START, 0, &start, sizeof(start), time);
+
+        // Have the flusher close the old one and prepare another spare
+        flusherWakeup.notify_one();
+    }
+
+    writeRecord(type, source, payload, length, time);
+    return true;
+}
+
+bool FlightRecorder::recordSerial(uint8_t uartNumber, const void* data, uint16_t length)
+{
+    return append(FLIGHT_RECORD_SERIAL_RX, uartNumber, data, length);
+}
+
+bool FlightRecorder::recordGps(const GpsSampleRecord& sample)
+{
+    return append(FLIGHT_RECORD_GPS, 0, &sample, sizeof(sample));
+}
+
+bool FlightRecorder::recordImu(const ImuSampleRecord& sample)
+{
+    return append(FLIGHT_RECORD_IMU, 0, &sample, sizeof(sample));
+}
+
+bool FlightRecorder::recordAdc(uint8_t channel, int32_t value)
+{
+    AdcSampleRecord sample;
+    sample.value = value;
+    return append(FLIGHT_RECORD_ADC, channel, &sample, sizeof(sample));
+}
+
+bool FlightRecorder::recordPwm(int32_t gpio, int32_t value)
+{
+    PwmSampleRecord sample;
+    sample.gpio = gpio;
+    sample.value = value;
+    return append(FLIGHT_RECORD_PWM, 0, &sample, sizeof(sample));
+}
+
+FlightRecorderStats FlightRecorder::getStats()
+{
+    std::lock_guard<std::mutex> lock(recordLock);
+    FlightRecorderStats stats;
+    stats.bytesWritten = bytesWrittenBefore;
+    stats.bytesSynced = bytesSyncedBefore;
+    stats.droppedRecords = droppedRecords;
+    stats.segmentCount = nextSegmentNumber - (hasSpare ? 1 : 0);
+    return stats;
+}
+
+void FlightRecorder::flusherMain()
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    std::chrono::milliseconds syncInterval(syncIntervalMs);
+    std::chrono::steady_clock::time_point lastSync = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(recordLock);
+    while (true)
+    {
+        // Always keep a spare ready for when the current segment fills up
+        if (!hasSpare && !isStopping)
+        {
+            uint32_t number = nextSegmentNumber++;
+            Segment segment;
+            lock.unlock();
+            bool opened = openSegment(number, &segment);
+            lock.lock();
+            if (opened)
+            {
+                spare = segment;
+                hasSpare = true;
+            }
+        }
+
+        // Close out full segments. Only we ever unmap, so the mapping
+        // stays valid while we work on it without the lock.
+        while (!retired.empty())
+        {
+            Segment segment = retired.back();
+            retired.pop_back();
+            lock.unlock();
+            closeSegment(&segment);
+            lock.lock();
+            bytesSyncedBefore += segment.writeOffset - segment.syncOffset;
+        }
+
+        // Bound how often we make the storage sync
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (hasCurrent && current.writeOffset > current.syncOffset &&
+            (now - lastSync >= syncInterval || isStopping))
+        {
+            uint8_t* mapping = current.mapping;
+            uint64_t start = current.syncOffset;
+            uint64_t end = current.writeOffset;
+            uint32_t number = current.number;
+            lastSync = now;
+
+            lock.unlock();
+            // msync wants a page aligned start
+            uint64_t pageStart = start & ~(uint64_t)(pageSize - 1);
+            msync(mapping + pageStart, end - pageStart, MS_SYNC);
+            lock.lock();
+
+            // The segment may have been retired while we were syncing
+            Segment* synced = NULL;
+            if (current.number == number)
+            {
+                synced = &current;
+            }
+            for (size_t i = 0; i < retired.size(); i++)
+            {
+                if (retired[i].number == number)
+                {
+                    synced = &retired[i];
+                }
+            }
+            if (synced && synced->syncOffset < end)
+            {
+                bytesSyncedBefore += end - synced->syncOffset;
+                synced->syncOffset = end;
+            }
+        }
+
+        if (isStopping && retired.empty())
+        {
+            break;
+        }
+        if (!isStopping)
+        {
+            flusherWakeup.wait_for(lock, syncInterval);
+        }
+    }
+
+    // Final close with everything synced
+    if (hasCurrent)
+    {
+        bytesSyncedBefore += current.writeOffset - current.syncOffset;
+        closeSegment(&current);
+        hasCurrent = false;
+    }
+    if (hasSpare)
+    {
+        closeSegment(&spare);
+        hasSpare = false;
+    }
+}
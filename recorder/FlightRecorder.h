@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "FlightLog.h"
+
+#ifndef FLIGHT_RECORDER
+#define FLIGHT_RECORDER
+
+// Counters describing how the recorder is keeping up
+typedef struct
+{
+    // Bytes of records placed into segments so far
+    uint64_t bytesWritten;
+    // Bytes of those that have been synced to storage
+    uint64_t bytesSynced;
+    // Records that could not be written because no segment was ready
+    uint32_t droppedRecords;
+    // Segments opened so far
+    uint32_t segmentCount;
+} FlightRecorderStats;
+
+// Appends records to a series of preallocated, memory-mapped log segments
+// named <pathPrefix>-0000.flog, <pathPrefix>-0001.flog, and so on.
+//
+// Appending is a copy into the mapping under a short lock, so it is cheap enough
+// to call for every sample from the main loop. Nothing on the appending path touches
+// the disk: a background flusher thread syncs written ranges at most once every
+// syncIntervalMs, prepares the next segment before the current one fills up
+// and closes finished segments.
+// If the flusher falls so far behind that no segment is ready, records are dropped
+// (and counted) rather than blocking the caller.
+class FlightRecorder
+{
+    public:
+
+    // Starts recording to segments of segmentBytes each.
+    // If the first segment cannot be created, isReady() will return false.
+    FlightRecorder(const char* pathPrefix, uint32_t segmentBytes = 16 * 1024 * 1024, int32_t syncIntervalMs = 1000);
+
+    // Syncs and closes everything that has been written.
+    ~FlightRecorder();
+
+    bool isReady() const;
+
+    // Appends a record with the given type, source and payload, timestamped now.
+    // Returns false if the record was dropped.
+    bool append(uint8_t type, uint8_t source, const void* payload, uint16_t length);
+
+    // Convenience for the fixed-size sample records
+    bool recordSerial(uint8_t uartNumber, const void* data, uint16_t length);
+    bool recordGps(const GpsSampleRecord& sample);
+    bool recordImu(const ImuSampleRecord& sample);
+    bool recordAdc(uint8_t channel, int32_t value);
+    bool recordPwm(int32_t gpio, int32_t value);
+
+    FlightRecorderStats getStats();
+
+    // CLOCK_MONOTONIC in nanoseconds, the time base of all records
+    static uint64_t timestamp();
+
+    private:
+
+    typedef struct
+    {
+        int handle;
+        uint8_t* mapping;
+        uint64_t size;
+        // Where the next record goes
+        uint64_t writeOffset;
+        // Everything before this has been synced
+        uint64_t syncOffset;
+        uint32_t number;
+    } Segment;
+
+    // Not copyable, we own threads and mappings
+    FlightRecorder(const FlightRecorder&);
+    FlightRecorder& operator=(const FlightRecorder&);
+
+    // Creates, preallocates and maps a new segment file. Returns false on error.
+    bool openSegment(uint32_t number, Segment* segment);
+    // Syncs, trims to its used length and unmaps a segment
+    void closeSegment(Segment* segment);
+    // Places a record into the current segment. recordLock must be held.
+    void writeRecord(uint8_t type, uint8_t source, const void* payload, uint16_t length, uint64_t time);
+
+    void flusherMain();
+
+    std::string pathPrefix;
+    uint64_t segmentBytes;
+    int32_t syncIntervalMs;
+
+    // Guards everything below
+    std::mutex recordLock;
+    std::condition_variable flusherWakeup;
+
+    Segment current;
+    bool hasCurrent;
+    // Prepared by the flusher so that switching segments never waits on the disk
+    Segment spare;
+    bool hasSpare;
+    // Full segments waiting on the flusher to close them
+    std::vector<Segment> retired;
+
+    uint32_t nextSequence;
+    uint32_t nextSegmentNumber;
+    uint64_t bytesWrittenBefore;
+    uint64_t bytesSyncedBefore;
+    uint32_t droppedRecords;
+    bool isStopping;
+
+    std::thread flusher;
+};
+
+#endif
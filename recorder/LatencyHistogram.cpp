@@ -0,0 +1,114 @@
+#include "LatencyHistogram.h"
+#include <string.h>
+#include <time.h>
+
+static std::atomic<bool> stageTiming(false);
+
+void setStageTiming(bool isTiming)
+{
+    stageTiming.store(isTiming, std::memory_order_relaxed);
+}
+
+bool isStageTiming()
+{
+    return stageTiming.load(std::memory_order_relaxed);
+}
+
+uint64_t StageTimer::now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    count.store(0);
+    totalNs.store(0);
+    maxNs.store(0);
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        buckets[i].store(0);
+    }
+}
+
+int LatencyHistogram::bucketOf(uint64_t nanoseconds)
+{
+    // The smallest values each have a bucket of their own
+    if (nanoseconds < LATENCY_SUB_BUCKETS)
+    {
+        return (int)nanoseconds;
+    }
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    if (exponent > LATENCY_MAX_EXPONENT)
+    {
+        return LATENCY_BUCKET_COUNT - 1;
+    }
+    // The bits just below the top one pick the bucket within the power of two
+    int subBucket = (nanoseconds >> (exponent - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return ((exponent - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS) + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketTop(int bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    int exponent = (bucket >> LATENCY_SUB_BUCKET_BITS) + LATENCY_SUB_BUCKET_BITS - 1;
+    int subBucket = bucket & (LATENCY_SUB_BUCKETS - 1);
+    return ((uint64_t)(LATENCY_SUB_BUCKETS + subBucket + 1) << (exponent - LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t currentMax = maxNs.load(std::memory_order_relaxed);
+    while (nanoseconds > currentMax &&
+           !maxNs.compare_exchange_weak(currentMax, nanoseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::takeSnapshot(LatencySnapshot* snapshot)
+{
+    snapshot->count = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        snapshot->buckets[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+        snapshot->count += snapshot->buckets[i];
+    }
+    // The count is taken from the buckets so that percentiles always add up
+    count.store(0, std::memory_order_relaxed);
+    snapshot->totalNs = totalNs.exchange(0, std::memory_order_relaxed);
+    snapshot->maxNs = maxNs.exchange(0, std::memory_order_relaxed);
+}
+
+uint64_t latencyPercentile(const LatencySnapshot& snapshot, double fraction)
+{
+    if (snapshot.count == 0)
+    {
+        return 0;
+    }
+    // How many values must be at or below the answer
+    uint64_t wanted = (uint64_t)(fraction * snapshot.count + 0.5);
+    if (wanted < 1)
+    {
+        wanted = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        seen += snapshot.buckets[i];
+        if (seen >= wanted)
+        {
+            // The bucket's top may be past anything actually recorded
+            uint64_t top = LatencyHistogram::bucketTop(i);
+            return (snapshot.maxNs && top > snapshot.maxNs) ? snapshot.maxNs : top;
+        }
+    }
+    return snapshot.maxNs;
+}
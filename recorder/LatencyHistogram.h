@@ -0,0 +1,90 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+
+// Buckets are log-linear: every power of two is split into this many equal buckets,
+// so a recorded value is known to within 1/8th (12.5%) of itself.
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+// Values of 2^(this + 1) nanoseconds (about 18 minutes) and up all go in the last bucket
+#define LATENCY_MAX_EXPONENT 39
+#define LATENCY_BUCKET_COUNT ((LATENCY_MAX_EXPONENT - LATENCY_SUB_BUCKET_BITS + 2) * LATENCY_SUB_BUCKETS)
+
+// What a histogram held when a snapshot was taken of it
+typedef struct
+{
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint64_t buckets[LATENCY_BUCKET_COUNT];
+} LatencySnapshot;
+
+// The value (the top of its bucket, so never an underestimate) that the given
+// fraction of the snapshot's values are at or below. 0 if there are none.
+uint64_t latencyPercentile(const LatencySnapshot& snapshot, double fraction);
+
+// Counts durations in nanoseconds. Recording is lock-free (a few relaxed atomic adds),
+// so any thread can record while another takes snapshots.
+class LatencyHistogram
+{
+    public:
+
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+
+    // Copies out everything recorded since the last snapshot and starts over.
+    // A value recorded while the snapshot is being taken lands in this one or the next.
+    void takeSnapshot(LatencySnapshot* snapshot);
+
+    // Which bucket a value goes in, and the highest value that bucket holds
+    static int bucketOf(uint64_t nanoseconds);
+    static uint64_t bucketTop(int bucket);
+
+    private:
+
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> maxNs;
+    std::atomic<uint64_t> buckets[LATENCY_BUCKET_COUNT];
+};
+
+// Turns every StageTimer on or off. Off by default, when a StageTimer costs a single branch.
+void setStageTiming(bool isTiming);
+bool isStageTiming();
+
+// Records how long it lived into a histogram, when stage timing is on.
+// Timed with CLOCK_MONOTONIC_RAW, which no clock adjustment can move.
+class StageTimer
+{
+    public:
+
+    StageTimer(LatencyHistogram* histogram)
+    {
+        this->histogram = isStageTiming() ? histogram : NULL;
+        if (this->histogram)
+        {
+            startNs = now();
+        }
+    }
+
+    ~StageTimer()
+    {
+        if (histogram)
+        {
+            histogram->record(now() - startNs);
+        }
+    }
+
+    static uint64_t now();
+
+    private:
+
+    LatencyHistogram* histogram;
+    uint64_t startNs;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "crc32.h"
+
+// Lookup table for the reflected 0xEDB88320 polynomial
+struct Crc32Table
+{
+    uint32_t values[256];
+
+    Crc32Table()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+            }
+            values[i] = value;
+        }
+    }
+};
+
+uint32_t crc32(const void* data, size_t length, uint32_t initialChecksum)
+{
+    // Built on first use. Function statics are initialized thread-safely.
+    static const Crc32Table table;
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t checksum = ~initialChecksum;
+    for (size_t i = 0; i < length; i++)
+    {
+        checksum = table.values[(checksum ^ bytes[i]) & 0xff] ^ (checksum >> 8);
+    }
+    return ~checksum;
+}
@@ -0,0 +1,13 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef RECORDER_CRC32_H
+#define RECORDER_CRC32_H
+
+// Calculates the CRC-32 (IEEE 802.3 polynomial) checksum of length bytes of data.
+// Starting with a given initialChecksum so that multiple calls may be strung together.
+// Use 0 as a default.
+// Unlike the AKP crc8, this works on binary data and not null-terminated strings.
+uint32_t crc32(const void* data, size_t length, uint32_t initialChecksum);
+
+#endif
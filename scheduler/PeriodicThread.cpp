@@ -0,0 +1,91 @@
+#include "PeriodicThread.h"
+#include <time.h>
+#include <errno.h>
+
+static uint64_t monotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+PeriodicThread::PeriodicThread(IPeriodicTask* task, uint64_t periodNs)
+{
+    this->task = task;
+    this->periodNs = periodNs;
+    lateCycles = 0;
+    isStopping = false;
+    isStarted = false;
+}
+
+PeriodicThread::~PeriodicThread()
+{
+    stop();
+}
+
+void PeriodicThread::setPeriodNs(uint64_t periodNs)
+{
+    this->periodNs = periodNs;
+}
+
+uint64_t PeriodicThread::getPeriodNs() const
+{
+    return periodNs;
+}
+
+void PeriodicThread::start()
+{
+    if (isStarted)
+    {
+        return;
+    }
+    isStopping = false;
+    thread = std::thread(&PeriodicThread::run, this);
+    isStarted = true;
+}
+
+void PeriodicThread::stop()
+{
+    if (!isStarted)
+    {
+        return;
+    }
+    isStopping = true;
+    thread.join();
+    isStarted = false;
+}
+
+bool PeriodicThread::isRunning() const
+{
+    return isStarted;
+}
+
+uint64_t PeriodicThread::getLateCycles() const
+{
+    return lateCycles;
+}
+
+void PeriodicThread::run()
+{
+    uint64_t dueNs = monotonicNs();
+
+    while (!isStopping)
+    {
+        task->runCycle();
+
+        // Due a period after the last was due, unless that has already gone by
+        dueNs += periodNs;
+        uint64_t now = monotonicNs();
+        if (dueNs + periodNs < now)
+        {
+            lateCycles++;
+            dueNs = now;
+        }
+        struct timespec wake;
+        wake.tv_sec = dueNs / 1000000000ULL;
+        wake.tv_nsec = dueNs % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR && !isStopping)
+        {
+        }
+    }
+}
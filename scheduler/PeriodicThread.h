@@ -0,0 +1,63 @@
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "../devices/CppInterfaces.h"
+
+#ifndef PERIODIC_THREAD
+#define PERIODIC_THREAD
+
+// Whatever a PeriodicThread runs
+DeclareInterface(IPeriodicTask)
+    // Does one period's work, from the thread
+    virtual void runCycle() = 0;
+EndInterface
+
+// Runs a task's cycles from a thread of its own, so it keeps its rate whatever the
+// main loop is doing.
+//
+// Each cycle is due a period after the last was due, on the monotonic clock, so the rate
+// does not drift with how long the cycles take. When a cycle finishes more than a whole
+// period after it was due, it counts as late and the next is due straight away, rather
+// than the missed ones being run in a burst to catch up.
+class PeriodicThread
+{
+    public:
+
+    // Runs the task, which it does not own, a cycle every period once started
+    PeriodicThread(IPeriodicTask* task, uint64_t periodNs);
+
+    // Stops the thread
+    ~PeriodicThread();
+
+    // Can be changed while running, from the next cycle on
+    void setPeriodNs(uint64_t periodNs);
+    uint64_t getPeriodNs() const;
+
+    // Starts the thread, if it is not already running
+    void start();
+    // Lets the cycle that is running finish, and waits for the thread to end
+    void stop();
+
+    bool isRunning() const;
+
+    // Cycles that finished more than a whole period after they were due
+    uint64_t getLateCycles() const;
+
+    private:
+
+    // Not copyable, we own a thread
+    PeriodicThread(const PeriodicThread&);
+    PeriodicThread& operator=(const PeriodicThread&);
+
+    void run();
+
+    IPeriodicTask* task;
+    std::atomic<uint64_t> periodNs;
+    std::atomic<uint64_t> lateCycles;
+
+    std::thread thread;
+    std::atomic<bool> isStopping;
+    bool isStarted;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "TaskScheduler.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <iostream>
+
+uint64_t TaskScheduler::now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+TaskScheduler::TaskScheduler()
+{
+    timerHandle = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerHandle == -1)
+    {
+        perror("TaskScheduler: making timerfd");
+        isInitialized = false;
+        return;
+    }
+    isInitialized = true;
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    if (timerHandle != -1)
+    {
+        close(timerHandle);
+    }
+}
+
+bool TaskScheduler::isReady() const
+{
+    return isInitialized;
+}
+
+int TaskScheduler::addTask(const char* name, ScheduledFunction function, uint32_t periodMs, uint32_t deadlineMs)
+{
+    if (periodMs == 0)
+    {
+        return -1;
+    }
+    ScheduledTask task;
+    task.name = name;
+    task.function = function;
+    task.periodNs = periodMs * 1000000ULL;
+    task.deadlineNs = deadlineMs * 1000000ULL;
+    task.nextDueNs = now() + task.periodNs;
+    memset(&task.stats, 0, sizeof(task.stats));
+    tasks.push_back(task);
+
+    armTimer();
+    return tasks.size() - 1;
+}
+
+int TaskScheduler::findTask(const char* name) const
+{
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        if (tasks[i].name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool TaskScheduler::setPeriod(int task, uint32_t periodMs)
+{
+    if (task < 0 || task >= (int)tasks.size() || periodMs == 0)
+    {
+        return false;
+    }
+    uint64_t lastDueNs = tasks[task].nextDueNs - tasks[task].periodNs;
+    tasks[task].periodNs = periodMs * 1000000ULL;
+    tasks[task].nextDueNs = lastDueNs + tasks[task].periodNs;
+    armTimer();
+    return true;
+}
+
+bool TaskScheduler::setDeadline(int task, uint32_t deadlineMs)
+{
+    if (task < 0 || task >= (int)tasks.size())
+    {
+        return false;
+    }
+    tasks[task].deadlineNs = deadlineMs * 1000000ULL;
+    return true;
+}
+
+void TaskScheduler::runDue()
+{
+    // Clear the timerfd's expirations; we look at the clock ourselves
+    if (isInitialized)
+    {
+        uint64_t expirations;
+        read(timerHandle, &expirations, sizeof(expirations));
+    }
+
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        ScheduledTask& task = tasks[i];
+        uint64_t startNs = now();
+        if (startNs < task.nextDueNs)
+        {
+            continue;
+        }
+
+        task.function();
+
+        uint64_t finishNs = now();
+        uint64_t dueNs = task.nextDueNs;
+        task.stats.runs++;
+        if (finishNs - startNs > task.stats.maxRunNs)
+        {
+            task.stats.maxRunNs = finishNs - startNs;
+        }
+        if (finishNs - dueNs > task.stats.maxLatenessNs)
+        {
+            task.stats.maxLatenessNs = finishNs - dueNs;
+        }
+        if (finishNs > dueNs + task.deadlineNs)
+        {
+            task.stats.overruns++;
+            std::cout << "Scheduler: " << task.name << " finished " << (finishNs - dueNs - task.deadlineNs) / 1000000
+                      << " ms past its deadline (" << task.stats.overruns << " overruns)" << std::endl;
+        }
+
+        // Keep the phase; any periods that have gone by entirely are skipped
+        task.nextDueNs = dueNs + task.periodNs;
+        if (task.nextDueNs <= finishNs)
+        {
+            uint64_t skipped = (finishNs - task.nextDueNs) / task.periodNs + 1;
+            task.stats.skippedPeriods += skipped;
+            task.nextDueNs += skipped * task.periodNs;
+        }
+    }
+
+    armTimer();
+}
+
+uint64_t TaskScheduler::soonestDue() const
+{
+    if (tasks.empty())
+    {
+        return 0;
+    }
+    uint64_t soonestNs = tasks[0].nextDueNs;
+    for (size_t i = 1; i < tasks.size(); i++)
+    {
+        if (tasks[i].nextDueNs < soonestNs)
+        {
+            soonestNs = tasks[i].nextDueNs;
+        }
+    }
+    return soonestNs;
+}
+
+void TaskScheduler::armTimer()
+{
+    if (!isInitialized || tasks.empty())
+    {
+        return;
+    }
+    uint64_t soonestNs = soonestDue();
+
+    struct itimerspec timerSetting;
+    memset(&timerSetting, 0, sizeof(timerSetting));
+    timerSetting.it_value.tv_sec = soonestNs / 1000000000ULL;
+    timerSetting.it_value.tv_nsec = soonestNs % 1000000000ULL;
+    if (timerfd_settime(timerHandle, TFD_TIMER_ABSTIME, &timerSetting, NULL) == -1)
+    {
+        perror("TaskScheduler: setting timerfd");
+    }
+}
+
+void TaskScheduler::waitForDue(struct pollfd* handles, int handleCount, int32_t maxWaitUs)
+{
+    int64_t waitNs = (maxWaitUs < 0) ? -1 : (int64_t)maxWaitUs * 1000;
+    // Without the timerfd, the sleep itself has to end when the next task is due
+    if (!isInitialized && !tasks.empty())
+    {
+        uint64_t soonestNs = soonestDue();
+        uint64_t nowNs = now();
+        int64_t dueInNs = (soonestNs > nowNs) ? (int64_t)(soonestNs - nowNs) : 0;
+        waitNs = (waitNs < 0 || dueInNs < waitNs) ? dueInNs : waitNs;
+    }
+
+    waitHandles.assign(handles, handles + handleCount);
+    if (isInitialized)
+    {
+        struct pollfd timerPoll = {timerHandle, POLLIN, 0};
+        waitHandles.push_back(timerPoll);
+    }
+
+    struct timespec timeout = {(time_t)(waitNs / 1000000000LL), (long)(waitNs % 1000000000LL)};
+    int result = ppoll(waitHandles.data(), waitHandles.size(), (waitNs < 0) ? NULL : &timeout, NULL);
+    for (int i = 0; i < handleCount; i++)
+    {
+        handles[i].revents = (result > 0) ? waitHandles[i].revents : 0;
+        // A handle at its end would wake every wait from here on
+        if (handles[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+        {
+            handles[i].fd = -1;
+        }
+    }
+}
+
+const TaskStats* TaskScheduler::getStats(int task) const
+{
+    if (task < 0 || task >= (int)tasks.size())
+    {
+        return NULL;
+    }
+    return &tasks[task].stats;
+}
+
+const char* TaskScheduler::getName(int task) const
+{
+    if (task < 0 || task >= (int)tasks.size())
+    {
+        return NULL;
+    }
+    return tasks[task].name.c_str();
+}
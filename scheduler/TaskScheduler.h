@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <poll.h>
+
+#ifndef TASK_SCHEDULER
+#define TASK_SCHEDULER
+
+typedef void (*ScheduledFunction)();
+
+// How a task has been keeping to its schedule
+typedef struct
+{
+    uint64_t runs;
+    // Runs that finished later than their deadline
+    uint64_t overruns;
+    // Whole periods that went by without a run, because the task or others ran too long
+    uint64_t skippedPeriods;
+    // Longest a run has taken, and the latest past its due time one has finished
+    uint64_t maxRunNs;
+    uint64_t maxLatenessNs;
+} TaskStats;
+
+// Runs named periodic tasks on the monotonic clock, so that nothing
+// (NTP, a GPS time fix, someone setting the date) can move the schedule.
+//
+// Each task is due every period, counted from when it was added, and should finish
+// within its deadline of the time it was due. A run that finishes later counts as
+// an overrun and is reported. Periods missed completely are skipped rather than
+// made up with a burst of runs, so a task keeps its phase.
+//
+// Tasks are run from runDue, by whichever thread calls it. In between, waitForDue
+// sleeps on a timerfd set for the next due time, so it wakes right on time, along with
+// whatever handles the caller has to read, so it also wakes as soon as they have something.
+class TaskScheduler
+{
+    public:
+
+    // If the timerfd cannot be made, isReady() will return false.
+    // Tasks still run, waitForDue works out how long to sleep for them instead.
+    TaskScheduler();
+    ~TaskScheduler();
+
+    bool isReady() const;
+
+    // Adds a task, first due a period from now. Returns its number, or -1 for a period of 0.
+    int addTask(const char* name, ScheduledFunction function, uint32_t periodMs, uint32_t deadlineMs);
+
+    // The number of the task with the given name, or -1
+    int findTask(const char* name) const;
+
+    // Changes how often a task runs. It is next due a new period after it was last due.
+    bool setPeriod(int task, uint32_t periodMs);
+
+    // Changes how long after it is due a task should have finished, from its next run on
+    bool setDeadline(int task, uint32_t deadlineMs);
+
+    // Runs every task that is due, in the order they were added
+    void runDue();
+
+    // Sleeps until the next task is due, one of the handles has something for their events,
+    // or maxWaitUs have passed (-1 for no limit), whichever is sooner. Handles that hang up
+    // or are not open are set to -1, so they are not waited on again. Their revents are filled in.
+    void waitForDue(struct pollfd* handles, int handleCount, int32_t maxWaitUs);
+
+    const TaskStats* getStats(int task) const;
+    const char* getName(int task) const;
+
+    // The monotonic time in nanoseconds that the schedule is kept in
+    static uint64_t now();
+
+    private:
+
+    typedef struct
+    {
+        std::string name;
+        ScheduledFunction function;
+        uint64_t periodNs;
+        uint64_t deadlineNs;
+        uint64_t nextDueNs;
+        TaskStats stats;
+    } ScheduledTask;
+
+    // Sets the timerfd for the soonest due time
+    void armTimer();
+
+    // The soonest time a task is due, 0 if there are none
+    uint64_t soonestDue() const;
+
+    // Not copyable, we own the timerfd
+    TaskScheduler(const TaskScheduler&);
+    TaskScheduler& operator=(const TaskScheduler&);
+
+    std::vector<ScheduledTask> tasks;
+
+    int timerHandle;
+
+    // The caller's handles and the timerfd, kept so waiting does not allocate
+    std::vector<struct pollfd> waitHandles;
+
+    // Whether the timerfd was made, value returned by isReady
+    bool isInitialized;
+};
+
+#endif
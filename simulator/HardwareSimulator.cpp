@@ -0,0 +1,559 @@
+#include "HardwareSimulator.h"
+#include "../devices/HardwarePath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sstream>
+
+// The omap_mux files that Uart writes to. "/dev/null" stands in for uart3's missing rx pin.
+static const char* muxFiles[] =
+{
+    "/sys/kernel/debug/omap_mux/uart1_rxd", "/sys/kernel/debug/omap_mux/uart1_txd",
+    "/sys/kernel/debug/omap_mux/spi0_sclk", "/sys/kernel/debug/omap_mux/spi0_d0",
+    "/dev/null", "/sys/kernel/debug/omap_mux/ecap0_in_pwm0_out",
+    "/sys/kernel/debug/omap_mux/gpmc_wait0", "/sys/kernel/debug/omap_mux/gpmc_wpn",
+    "/sys/kernel/debug/omap_mux/lcd_data9", "/sys/kernel/debug/omap_mux/lcd_data8"
+};
+
+// Baud rates that missionControl opens the uarts with
+static const int32_t uartBaudRates[] = {9600, 115200, 9600, 115200, 9600};
+
+// The pwm input that missionControl reads the throttle from
+#define SIMULATED_THROTTLE_GPIO 43
+
+// The eight pwm inputs missionControl captures together, as a radio control receiver's channels
+static const int simulatedPwmInputGpios[] = {26, 27, 38, 61, 65, 86, 117, 115};
+// The adc channels of the temperature and humidity sensors
+#define SIMULATED_TEMPERATURE_CHANNEL 1
+#define SIMULATED_OUTSIDE_TEMPERATURE_CHANNEL 2
+#define SIMULATED_HUMIDITY_CHANNEL 3
+// The HIH6130's stand-in, on i2c bus 1, holds the four bytes of its latest measurement
+#define SIMULATED_HUMIDITY_BYTES 4
+
+double simulatorSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+double decodedSentenceTime(double encodedSeconds, double decodedTime)
+{
+    // How far the decode came after the send, within the 1000 seconds
+    double delay = fmod(fmod(decodedTime, 1000) - encodedSeconds + 1000, 1000);
+    return decodedTime - delay;
+}
+
+SimulatorSettings defaultSimulatorSettings()
+{
+    SimulatorSettings settings;
+    settings.gpsLogPath = "devices/oldDATA.txt";
+    settings.gpsSentenceRate = 8;
+    settings.imuSentenceRate = 40;
+    settings.transceiverTagRate = 0.2;
+    settings.cellTextInterval = 60;
+    settings.saturationMultiplier = 0;
+    settings.isTimestampingSentences = false;
+    return settings;
+}
+
+HardwareSimulator::HardwareSimulator(const char* prefix, const SimulatorSettings& settings)
+    : gpsTraffic(settings.gpsLogPath)
+{
+    this->prefix = prefix;
+    this->settings = settings;
+    for (int i = 0; i < SIMULATED_UART_COUNT; i++)
+    {
+        ports[i] = NULL;
+    }
+    adcHandle = -1;
+    pwmHandle = -1;
+    i2cHandle = -1;
+    cellTextCount = 0;
+    memset(&telemetryParse, 0, sizeof(telemetryParse));
+    telemetryFrames = 0;
+    servoCommands = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        servoPositions[i] = -1;
+    }
+    telemetryTags = 0;
+    gpsFixesSent = 0;
+    imuSentencesSent = 0;
+    isInitialized = false;
+
+    startTime = simulatorSeconds();
+    nextGpsTime = startTime;
+    nextImuTime = startTime;
+    nextTransceiverTime = startTime;
+    nextCellTextTime = startTime + settings.cellTextInterval;
+    nextInputTime = startTime;
+
+    if (!makeDirectory(this->prefix + "/dev") ||
+        !makeDirectory(this->prefix + "/sys/kernel/debug/omap_mux") ||
+        !makeDirectory(this->prefix + "/sys/class/gpio"))
+    {
+        return;
+    }
+
+    for (int i = 0; i < SIMULATED_UART_COUNT; i++)
+    {
+        std::stringstream path;
+        path << this->prefix << "/dev/ttyO" << (i + 1);
+        ports[i] = new PtyPort(path.str().c_str());
+        if (!ports[i]->isReady())
+        {
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(muxFiles) / sizeof(*muxFiles); i++)
+    {
+        int handle = makeFile(this->prefix + muxFiles[i], 0);
+        if (handle == -1)
+        {
+            return;
+        }
+        close(handle);
+    }
+
+    // Real sysfs makes the gpio's directory on export; we can only make them all up front
+    int exportHandle = makeFile(this->prefix + "/sys/class/gpio/export", 0);
+    if (exportHandle == -1)
+    {
+        return;
+    }
+    close(exportHandle);
+    for (int gpio = 0; gpio < SIMULATED_PWM_GPIOS; gpio++)
+    {
+        std::stringstream path;
+        path << this->prefix << "/sys/class/gpio/gpio" << gpio;
+        if (!makeDirectory(path.str()))
+        {
+            return;
+        }
+        int directionHandle = makeFile(path.str() + "/direction", 0);
+        int valueHandle = makeFile(path.str() + "/value", 0);
+        if (directionHandle == -1 || valueHandle == -1)
+        {
+            return;
+        }
+        close(directionHandle);
+        close(valueHandle);
+    }
+
+    adcHandle = makeFile(this->prefix + "/dev/spidev2.0", SIMULATED_ADC_CHANNELS * sizeof(uint16_t));
+    pwmHandle = makeFile(this->prefix + "/dev/pwm_in", SIMULATED_PWM_GPIOS * sizeof(uint32_t));
+    i2cHandle = makeFile(this->prefix + "/dev/i2c-1", SIMULATED_HUMIDITY_BYTES);
+    if (adcHandle == -1 || pwmHandle == -1 || i2cHandle == -1)
+    {
+        return;
+    }
+
+    if (settings.gpsSentenceRate > 0 && !gpsTraffic.isReady())
+    {
+        fprintf(stderr, "HardwareSimulator: no NMEA sentences in %s\n", settings.gpsLogPath);
+        return;
+    }
+
+    isInitialized = true;
+}
+
+HardwareSimulator::~HardwareSimulator()
+{
+    for (int i = 0; i < SIMULATED_UART_COUNT; i++)
+    {
+        delete ports[i];
+    }
+    if (adcHandle != -1)
+    {
+        close(adcHandle);
+    }
+    if (pwmHandle != -1)
+    {
+        close(pwmHandle);
+    }
+    if (i2cHandle != -1)
+    {
+        close(i2cHandle);
+    }
+    free(telemetryParse.dataBuffer);
+}
+
+bool HardwareSimulator::isReady() const
+{
+    return isInitialized;
+}
+
+bool HardwareSimulator::makeDirectory(const std::string& path)
+{
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+    {
+        std::string directory = path.substr(0, slash);
+        if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST)
+        {
+            perror("HardwareSimulator: making directory");
+            return false;
+        }
+        if (slash == std::string::npos)
+        {
+            return true;
+        }
+    }
+}
+
+int HardwareSimulator::makeFile(const std::string& path, size_t size)
+{
+    int handle = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (handle == -1)
+    {
+        perror("HardwareSimulator: making file");
+        return -1;
+    }
+    if (size > 0 && ftruncate(handle, size) == -1)
+    {
+        perror("HardwareSimulator: sizing file");
+        close(handle);
+        return -1;
+    }
+    return handle;
+}
+
+std::string HardwareSimulator::nextGpsSentence(double now)
+{
+    std::string sentence = gpsTraffic.nextSentence();
+    if (sentence.compare(0, 7, "$GPGGA,") != 0)
+    {
+        return sentence;
+    }
+    gpsFixesSent++;
+    if (!settings.isTimestampingSentences)
+    {
+        return sentence;
+    }
+
+    // Swap the altitude (the 9th field) for the time, which GPSDecoder takes as whole meters
+    std::vector<std::string> fields;
+    std::string body = sentence.substr(1, sentence.find('*') - 1);
+    size_t start = 0;
+    for (size_t comma = body.find(','); ; comma = body.find(',', start))
+    {
+        fields.push_back(body.substr(start, comma - start));
+        if (comma == std::string::npos)
+        {
+            break;
+        }
+        start = comma + 1;
+    }
+    if (fields.size() <= 9)
+    {
+        return sentence;
+    }
+    char altitude[16];
+    snprintf(altitude, sizeof(altitude), "%ld", (long)fmod(now * 1000, 1000000));
+    fields[9] = altitude;
+
+    body = fields[0];
+    for (size_t i = 1; i < fields.size(); i++)
+    {
+        body += "," + fields[i];
+    }
+    return finishNmea(body);
+}
+
+std::string HardwareSimulator::nextImuSentence(double now)
+{
+    imuSentencesSent++;
+    std::string sentence = imuSentence(now - startTime);
+    if (settings.isTimestampingSentences)
+    {
+        // Swap the yaw (the first field) for the time
+        char yaw[16];
+        snprintf(yaw, sizeof(yaw), "%09.5f", fmod(now, 1000));
+        size_t yawStart = sentence.find(',') + 1;
+        size_t yawEnd = sentence.find(',', yawStart);
+        sentence = finishNmea(sentence.substr(1, yawStart - 1) + yaw + sentence.substr(yawEnd, sentence.find('*') - yawEnd));
+    }
+    return sentence;
+}
+
+std::string HardwareSimulator::nextTransceiverTag()
+{
+    // The ground station keeping the kill switch timeout topped up
+    return akpTag("ST", "600");
+}
+
+void HardwareSimulator::saturate(int uartNumber, int32_t baudRate, double now)
+{
+    PtyPort* port = ports[uartNumber - 1];
+    double bytesDue = (now - startTime) * baudRate / 10 * settings.saturationMultiplier;
+    while (port->getBytesWritten() + port->getBytesDropped() < bytesDue)
+    {
+        std::string message;
+        switch (uartNumber)
+        {
+            case 1:
+                message = nextTransceiverTag();
+                break;
+            case 2:
+                message = nextImuSentence(now);
+                break;
+            case 4:
+                message = "\r\n+CMTI: \"SM\",1\r\n";
+                break;
+            case 5:
+                message = nextGpsSentence(now);
+                break;
+            default:
+                return;
+        }
+        port->write(message.c_str(), message.length());
+    }
+}
+
+void HardwareSimulator::update()
+{
+    if (!isInitialized)
+    {
+        return;
+    }
+    double now = simulatorSeconds();
+
+    if (settings.saturationMultiplier > 0)
+    {
+        // Everything but the write only servo controller
+        saturate(1, uartBaudRates[0], now);
+        saturate(2, uartBaudRates[1], now);
+        saturate(4, uartBaudRates[3], now);
+        saturate(5, uartBaudRates[4], now);
+    }
+    else
+    {
+        // Catch up on whatever is due, but never more than a second's worth at once
+        if (settings.gpsSentenceRate > 0)
+        {
+            if (nextGpsTime < now - 1)
+            {
+                nextGpsTime = now - 1;
+            }
+            for (; nextGpsTime <= now; nextGpsTime += 1 / settings.gpsSentenceRate)
+            {
+                std::string sentence = nextGpsSentence(now);
+                ports[4]->write(sentence.c_str(), sentence.length());
+            }
+        }
+        if (settings.imuSentenceRate > 0)
+        {
+            if (nextImuTime < now - 1)
+            {
+                nextImuTime = now - 1;
+            }
+            for (; nextImuTime <= now; nextImuTime += 1 / settings.imuSentenceRate)
+            {
+                std::string sentence = nextImuSentence(now);
+                ports[1]->write(sentence.c_str(), sentence.length());
+            }
+        }
+        if (settings.transceiverTagRate > 0)
+        {
+            if (nextTransceiverTime < now - 1)
+            {
+                nextTransceiverTime = now - 1;
+            }
+            for (; nextTransceiverTime <= now; nextTransceiverTime += 1 / settings.transceiverTagRate)
+            {
+                std::string tag = nextTransceiverTag();
+                ports[0]->write(tag.c_str(), tag.length());
+            }
+        }
+    }
+    if (settings.cellTextInterval > 0 && nextCellTextTime <= now)
+    {
+        nextCellTextTime = now + settings.cellTextInterval;
+        std::stringstream count;
+        count << ++cellTextCount;
+        cellModem.receiveText("+15555550100", akpTag("CT", count.str().c_str()).c_str());
+    }
+
+    char buffer[1024];
+    int32_t length;
+
+    // The cell modem answers whatever was written to it
+    while ((length = ports[3]->read(buffer, sizeof(buffer))) > 0)
+    {
+        std::string reply = cellModem.respond(buffer, length);
+        ports[3]->write(reply.c_str(), reply.length());
+    }
+
+    // Telemetry going down to the ground
+    while ((length = ports[0]->read(buffer, sizeof(buffer))) > 0)
+    {
+        for (int32_t i = 0; i < length; i++)
+        {
+            if (parseTag(buffer[i], &telemetryParse))
+            {
+                telemetryTags++;
+                if (strcmp(telemetryParse.tag, "LV") == 0)
+                {
+                    telemetryFrames++;
+                    frameTimes.push_back(now);
+                }
+                free(telemetryParse.tag);
+                free(telemetryParse.data);
+            }
+        }
+    }
+
+    // Take the servo controller's commands, keeping where each servo was set to
+    int32_t servoBytes;
+    while ((servoBytes = ports[2]->read(buffer, sizeof(buffer))) > 0)
+    {
+        for (int32_t i = 0; i < servoBytes; i++)
+        {
+            uint8_t byte = buffer[i];
+            if (byte == 0x80)
+            {
+                servoCommand.clear();
+            }
+            servoCommand.push_back(byte);
+            // Start, device, set position, servo, position high 7 bits, position low 7 bits
+            if (servoCommand.size() == 6 && servoCommand[0] == 0x80 && servoCommand[2] == 0x04 &&
+                servoCommand[3] >= 1 && servoCommand[3] <= 8)
+            {
+                servoPositions[servoCommand[3] - 1] = ((servoCommand[4] << 7) | servoCommand[5]) - 500;
+                servoCommands++;
+            }
+        }
+    }
+
+    // The slow inputs only need moving along now and then
+    if (nextInputTime <= now)
+    {
+        nextInputTime = now + 0.02;
+        double seconds = now - startTime;
+        // Around 25 celsius as TemperatureSensor sees it, with a count or two of noise to filter out
+        setAdcConversion(SIMULATED_TEMPERATURE_CHANNEL, (uint16_t)(610 + 4 * sin(seconds / 30) + rand() % 5 - 2));
+        // Around freezing outside, and half humid
+        setAdcConversion(SIMULATED_OUTSIDE_TEMPERATURE_CHANNEL, (uint16_t)(560 + 6 * sin(seconds / 45) + rand() % 5 - 2));
+        setAdcConversion(SIMULATED_HUMIDITY_CHANNEL, (uint16_t)(481 + 20 * sin(seconds / 60) + rand() % 5 - 2));
+        setHumidity(45 + 5 * sin(seconds / 60), 22 + 2 * sin(seconds / 40));
+        // A throttle stick swept from end to end every 4 seconds
+        setPulseWidth(SIMULATED_THROTTLE_GPIO, (uint32_t)(1500 + 500 * sin(seconds * M_PI / 2)));
+        // Each receiver channel swept at its own pace, so they can be told apart
+        for (int i = 0; i < (int)(sizeof(simulatedPwmInputGpios) / sizeof(*simulatedPwmInputGpios)); i++)
+        {
+            setPulseWidth(simulatedPwmInputGpios[i], (uint32_t)(1500 + 400 * sin(seconds * (i + 1) * M_PI / 8)));
+        }
+    }
+}
+
+int32_t HardwareSimulator::getServoPosition(int servo) const
+{
+    if (servo < 1 || servo > 8)
+    {
+        return -1;
+    }
+    return servoPositions[servo - 1];
+}
+
+uint32_t HardwareSimulator::getServoCommands() const
+{
+    return servoCommands;
+}
+
+PtyPort* HardwareSimulator::getPort(int uartNumber)
+{
+    if (uartNumber < 1 || uartNumber > SIMULATED_UART_COUNT)
+    {
+        return NULL;
+    }
+    return ports[uartNumber - 1];
+}
+
+void HardwareSimulator::setAdcConversion(int channel, uint16_t value)
+{
+    if (adcHandle != -1 && channel >= 0 && channel < SIMULATED_ADC_CHANNELS)
+    {
+        pwrite(adcHandle, &value, sizeof(value), channel * sizeof(value));
+    }
+}
+
+void HardwareSimulator::setHumidity(double humidity, double celsius)
+{
+    if (i2cHandle == -1)
+    {
+        return;
+    }
+    // As the HIH6130 sends it: a status of 0 for a new measurement, 14 bits of humidity, 14 bits of temperature
+    uint16_t rawHumidity = (uint16_t)(humidity / 100 * 16382);
+    uint16_t rawTemperature = (uint16_t)((celsius + 40) / 165 * 16382);
+    uint8_t measurement[SIMULATED_HUMIDITY_BYTES] =
+    {
+        (uint8_t)((rawHumidity >> 8) & 0x3F),
+        (uint8_t)(rawHumidity & 0xFF),
+        (uint8_t)(rawTemperature >> 6),
+        (uint8_t)((rawTemperature & 0x3F) << 2)
+    };
+    pwrite(i2cHandle, measurement, sizeof(measurement), 0);
+}
+
+void HardwareSimulator::setPulseWidth(int gpioNumber, uint32_t widthUs)
+{
+    if (pwmHandle != -1 && gpioNumber >= 0 && gpioNumber < SIMULATED_PWM_GPIOS)
+    {
+        pwrite(pwmHandle, &widthUs, sizeof(widthUs), gpioNumber * sizeof(widthUs));
+    }
+}
+
+int32_t HardwareSimulator::getGpioValue(int gpioNumber)
+{
+    std::stringstream path;
+    path << prefix << "/sys/class/gpio/gpio" << gpioNumber << "/value";
+    int handle = open(path.str().c_str(), O_RDONLY);
+    if (handle == -1)
+    {
+        return -1;
+    }
+    char value = 0;
+    int result = read(handle, &value, 1);
+    close(handle);
+    return (result == 1) ? (value != '0') : -1;
+}
+
+uint32_t HardwareSimulator::getTelemetryFrames() const
+{
+    return telemetryFrames;
+}
+
+uint32_t HardwareSimulator::getTelemetryTags() const
+{
+    return telemetryTags;
+}
+
+std::vector<double> HardwareSimulator::takeFrameTimes()
+{
+    std::vector<double> times;
+    times.swap(frameTimes);
+    return times;
+}
+
+uint64_t HardwareSimulator::getGpsFixesSent() const
+{
+    return gpsFixesSent;
+}
+
+uint64_t HardwareSimulator::getImuSentencesSent() const
+{
+    return imuSentencesSent;
+}
+
+const CellModem& HardwareSimulator::getCellModem() const
+{
+    return cellModem;
+}
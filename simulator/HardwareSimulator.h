@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "PtyPort.h"
+#include "SimulatedTraffic.h"
+#include "../akp/cAkpParser/cAkpParser.h"
+
+#ifndef HARDWARE_SIMULATOR
+#define HARDWARE_SIMULATOR
+
+#define SIMULATED_UART_COUNT 5
+
+// How much traffic the simulator makes. Rates are per second, 0 for none.
+typedef struct
+{
+    // NMEA log that the GPS sentences come from
+    const char* gpsLogPath;
+    double gpsSentenceRate;
+    double imuSentenceRate;
+    // AKP tags sent up to the transceiver
+    double transceiverTagRate;
+    // Seconds between texts arriving at the cell modem
+    double cellTextInterval;
+    // When above 0, the rates are ignored and every uart that missionControl reads is kept
+    // full at this multiple of its baud rate (taking 10 bits to the byte).
+    // The cell modem's uart is filled with unsolicited new message indications.
+    double saturationMultiplier;
+    // Puts the time each GPS and IMU sentence is sent in it, for decodedSentenceTime
+    bool isTimestampingSentences;
+} SimulatorSettings;
+
+// Settings close to the real thing: one GPS fix (8 sentences) a second, a 40Hz IMU,
+// an uplinked tag every 5 seconds and a text every minute. No saturation or timestamps.
+SimulatorSettings defaultSimulatorSettings();
+
+// Stands in for all of the hardware that the device classes use, under a directory prefix.
+// Uarts become pseudo-terminals linked at <prefix>/dev/ttyO#, while the omap_mux and gpio
+// sysfs files, spidev, i2c-1 and pwm_in become plain files (laid out as HardwarePath.h describes).
+// missionControl is then run with MISSION_HW_PREFIX set to the same prefix.
+class HardwareSimulator
+{
+    public:
+
+    // Makes every stand-in under the prefix.
+    // If anything goes wrong, isReady() will return false.
+    HardwareSimulator(const char* prefix, const SimulatorSettings& settings);
+    ~HardwareSimulator();
+
+    bool isReady() const;
+
+    // Does whatever is due: sends the traffic, answers the cell modem, takes in what
+    // missionControl sent and moves the analog and pwm inputs along. Should be called often.
+    void update();
+
+    // The port standing in for the given uart, 1 to 5
+    PtyPort* getPort(int uartNumber);
+
+    // Sets the 10-bit conversion the spi adc gives for the channel
+    void setAdcConversion(int channel, uint16_t value);
+
+    // Sets the measurement the HIH6130 on i2c bus 1 gives, relative humidity in percent and celsius
+    void setHumidity(double humidity, double celsius);
+
+    // Sets the pulse width in microseconds that pwm_in gives for the gpio
+    void setPulseWidth(int gpioNumber, uint32_t widthUs);
+
+    // What missionControl last set the gpio to, or -1 if it has not
+    int32_t getGpioValue(int gpioNumber);
+
+    // Telemetry frames (ended with the LV tag) missionControl sent to the transceiver
+    uint32_t getTelemetryFrames() const;
+
+    // Tags of any kind missionControl sent to the transceiver
+    uint32_t getTelemetryTags() const;
+
+    // The last position missionControl set the servo (1 to 8) to, or -1 if it has not
+    int32_t getServoPosition(int servo) const;
+
+    // Set position commands missionControl sent to the servo controller
+    uint32_t getServoCommands() const;
+
+    // Monotonic times that telemetry frames arrived at since the last call
+    std::vector<double> takeFrameTimes();
+
+    // GPS fixes (GGA sentences) and IMU sentences sent
+    uint64_t getGpsFixesSent() const;
+    uint64_t getImuSentencesSent() const;
+
+    const CellModem& getCellModem() const;
+
+    private:
+
+    // Not copyable, we own the ports
+    HardwareSimulator(const HardwareSimulator&);
+    HardwareSimulator& operator=(const HardwareSimulator&);
+
+    // Makes the directory and its parents
+    bool makeDirectory(const std::string& path);
+
+    // Makes a plain file of the given number of zero bytes, returning its handle or -1
+    int makeFile(const std::string& path, size_t size);
+
+    // The next message for each uart, as the settings call for
+    std::string nextGpsSentence(double now);
+    std::string nextImuSentence(double now);
+    std::string nextTransceiverTag();
+
+    // Sends messages until the uart has been offered its saturated share of bytes by now
+    void saturate(int uartNumber, int32_t baudRate, double now);
+
+    std::string prefix;
+    SimulatorSettings settings;
+
+    PtyPort* ports[SIMULATED_UART_COUNT];
+
+    GpsTraffic gpsTraffic;
+    CellModem cellModem;
+
+    int adcHandle;
+    int pwmHandle;
+    int i2cHandle;
+
+    // Monotonic seconds that we started at, and when each kind of traffic is next due
+    double startTime;
+    double nextGpsTime;
+    double nextImuTime;
+    double nextTransceiverTime;
+    double nextCellTextTime;
+    double nextInputTime;
+    uint32_t cellTextCount;
+
+    // The servo controller command being taken in, from its 0x80 start byte
+    std::vector<uint8_t> servoCommand;
+    int32_t servoPositions[8];
+    uint32_t servoCommands;
+
+    TagParseData telemetryParse;
+    uint32_t telemetryFrames;
+    uint32_t telemetryTags;
+    std::vector<double> frameTimes;
+
+    uint64_t gpsFixesSent;
+    uint64_t imuSentencesSent;
+
+    bool isInitialized;
+};
+
+// Monotonic time in seconds
+double simulatorSeconds();
+
+// With isTimestampingSentences, the GPS altitude is the send time in milliseconds and
+// the IMU yaw is the send time in seconds, both modulo 1000 seconds.
+// Gives the monotonic time a sentence was sent from that and a later time it was decoded.
+double decodedSentenceTime(double encodedSeconds, double decodedTime);
+
+#endif
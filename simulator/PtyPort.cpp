@@ -0,0 +1,135 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "PtyPort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+
+PtyPort::PtyPort(const char* linkPath)
+{
+    this->linkPath = linkPath;
+    masterHandle = -1;
+    terminalHandle = -1;
+    bytesWritten = 0;
+    bytesDropped = 0;
+    bytesRead = 0;
+    isInitialized = false;
+
+    // Close on exec, so a missionControl started by us does not also hold our end
+    masterHandle = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (masterHandle == -1 || grantpt(masterHandle) == -1 || unlockpt(masterHandle) == -1)
+    {
+        perror("PtyPort: making pseudo-terminal");
+        return;
+    }
+    terminalName = ptsname(masterHandle);
+
+    terminalHandle = open(terminalName.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (terminalHandle == -1)
+    {
+        perror("PtyPort: opening terminal side");
+        return;
+    }
+
+    // Bytes must pass through exactly as a uart would give them
+    struct termios terminalOptions;
+    tcgetattr(terminalHandle, &terminalOptions);
+    cfmakeraw(&terminalOptions);
+    terminalOptions.c_cc[VTIME] = 0;
+    terminalOptions.c_cc[VMIN] = 0;
+    if (tcsetattr(terminalHandle, TCSANOW, &terminalOptions) == -1)
+    {
+        perror("PtyPort: setting terminal to raw");
+        return;
+    }
+
+    unlink(linkPath);
+    if (symlink(terminalName.c_str(), linkPath) == -1)
+    {
+        perror("PtyPort: linking terminal");
+        return;
+    }
+
+    isInitialized = true;
+}
+
+PtyPort::~PtyPort()
+{
+    if (isInitialized)
+    {
+        unlink(linkPath.c_str());
+    }
+    if (terminalHandle != -1)
+    {
+        close(terminalHandle);
+    }
+    if (masterHandle != -1)
+    {
+        close(masterHandle);
+    }
+}
+
+bool PtyPort::isReady() const
+{
+    return isInitialized;
+}
+
+const char* PtyPort::getTerminalName() const
+{
+    return terminalName.c_str();
+}
+
+int PtyPort::getHandle() const
+{
+    return masterHandle;
+}
+
+int32_t PtyPort::write(const char* data, int32_t length)
+{
+    int32_t written = 0;
+    if (isInitialized && length > 0)
+    {
+        int result = ::write(masterHandle, data, length);
+        if (result > 0)
+        {
+            written = result;
+        }
+    }
+    bytesWritten += written;
+    bytesDropped += length - written;
+    return written;
+}
+
+int32_t PtyPort::read(char* data, int32_t length)
+{
+    if (!isInitialized)
+    {
+        return 0;
+    }
+    int result = ::read(masterHandle, data, length);
+    if (result <= 0)
+    {
+        return 0;
+    }
+    bytesRead += result;
+    return result;
+}
+
+uint64_t PtyPort::getBytesWritten() const
+{
+    return bytesWritten;
+}
+
+uint64_t PtyPort::getBytesDropped() const
+{
+    return bytesDropped;
+}
+
+uint64_t PtyPort::getBytesRead() const
+{
+    return bytesRead;
+}
@@ -0,0 +1,61 @@
+#include <stdint.h>
+#include <string>
+
+#ifndef PTY_PORT
+#define PTY_PORT
+
+// The simulator's end of a pseudo-terminal that stands in for a uart.
+// The terminal side is linked to the path a uart would be opened at, so
+// missionControl opens it as it would the real /dev/ttyO#.
+class PtyPort
+{
+    public:
+
+    // Makes the pseudo-terminal and the link to it at linkPath, replacing whatever was there.
+    // If anything goes wrong, isReady() will return false.
+    PtyPort(const char* linkPath);
+    ~PtyPort();
+
+    bool isReady() const;
+
+    // Name of the terminal side, like /dev/pts/3
+    const char* getTerminalName() const;
+
+    // Our end, which never blocks
+    int getHandle() const;
+
+    // Writes as much of the data as the terminal will take.
+    // Returns how many bytes were taken; the rest are counted as dropped.
+    int32_t write(const char* data, int32_t length);
+
+    // Reads whatever the other side has written, up to length bytes.
+    // Returns how many bytes were read, 0 if none.
+    int32_t read(char* data, int32_t length);
+
+    uint64_t getBytesWritten() const;
+    uint64_t getBytesDropped() const;
+    uint64_t getBytesRead() const;
+
+    private:
+
+    // Not copyable, we own the handles
+    PtyPort(const PtyPort&);
+    PtyPort& operator=(const PtyPort&);
+
+    std::string linkPath;
+    std::string terminalName;
+
+    int masterHandle;
+
+    // Held open so the terminal keeps its settings and our writes do not fail
+    // while nobody else has it open
+    int terminalHandle;
+
+    uint64_t bytesWritten;
+    uint64_t bytesDropped;
+    uint64_t bytesRead;
+
+    bool isInitialized;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "SimulatedTraffic.h"
+#include "../akp/cAkpParser/crc8.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <fstream>
+#include <sstream>
+
+GpsTraffic::GpsTraffic(const char* logPath)
+{
+    nextIndex = 0;
+
+    std::ifstream log(logPath);
+    std::string line;
+    while (std::getline(log, line))
+    {
+        // Skip anything before the $, such as a byte order mark
+        size_t start = line.find('$');
+        if (start == std::string::npos)
+        {
+            continue;
+        }
+        size_t end = line.find_last_not_of("\r\n");
+        sentences.push_back(line.substr(start, end + 1 - start) + "\r\n");
+    }
+}
+
+bool GpsTraffic::isReady() const
+{
+    return !sentences.empty();
+}
+
+std::string GpsTraffic::nextSentence()
+{
+    if (sentences.empty())
+    {
+        return "";
+    }
+    const std::string& sentence = sentences[nextIndex];
+    nextIndex = (nextIndex + 1) % sentences.size();
+    return sentence;
+}
+
+std::string finishNmea(const std::string& body)
+{
+    unsigned char checksum = 0;
+    for (size_t i = 0; i < body.length(); i++)
+    {
+        checksum ^= body[i];
+    }
+    char ending[8];
+    snprintf(ending, sizeof(ending), "*%02X\r\n", checksum);
+    return "$" + body + ending;
+}
+
+std::string imuSentence(double seconds)
+{
+    double yaw = 180 * sin(seconds / 20);
+    double pitch = 10 * sin(seconds / 3);
+    double roll = 15 * sin(seconds / 5);
+
+    // Each datum must fit in 9 characters for IMUDecoder
+    char body[160];
+    snprintf(body, sizeof(body), "VNYMR,%+08.3f,%+08.3f,%+08.3f,%+07.4f,%+07.4f,%+07.4f,%+07.3f,%+07.3f,%+07.3f,%+08.5f,%+08.5f,%+08.5f",
+             yaw, pitch, roll,
+             0.25, -0.05, 0.42,
+             0.1 * sin(seconds), 0.1 * cos(seconds), -9.81,
+             0.001, -0.002, 0.0005);
+    return finishNmea(body);
+}
+
+static char getHexOfNibble(char c)
+{
+    c = c & 0x0f;
+    return (c < 10) ? ('0' + c) : ('a' + c - 10);
+}
+
+std::string akpTag(const char* tag, const char* data)
+{
+    unsigned char checksum = crc8(tag, 0);
+    checksum = crc8(data, checksum);
+    std::string result = std::string(tag) + "^" + data + ":";
+    result += getHexOfNibble(checksum >> 4);
+    result += getHexOfNibble(checksum);
+    return result;
+}
+
+CellModem::CellModem()
+{
+    isTakingText = false;
+    nextIndex = 1;
+    textsSent = 0;
+}
+
+std::string CellModem::respond(const char* data, int32_t length)
+{
+    std::string reply;
+    for (int32_t i = 0; i < length; i++)
+    {
+        char c = data[i];
+        if (isTakingText)
+        {
+            if (c == '\x1A')
+            {
+                textsSent++;
+                isTakingText = false;
+                commandBuffer = "";
+                std::stringstream sent;
+                sent << "\r\n+CMGS: " << textsSent << "\r\n\r\nOK\r\n";
+                reply += sent.str();
+            }
+            else
+            {
+                commandBuffer += c;
+            }
+        }
+        else if (c == '\r' || c == '\n')
+        {
+            if (!commandBuffer.empty())
+            {
+                reply += respondToCommand(commandBuffer);
+                commandBuffer = "";
+            }
+        }
+        else
+        {
+            commandBuffer += c;
+        }
+    }
+    return reply;
+}
+
+std::string CellModem::respondToCommand(const std::string& command)
+{
+    if (command.compare(0, 7, "AT+CMGS") == 0)
+    {
+        // The prompt for the text itself
+        isTakingText = true;
+        return "\r\n> ";
+    }
+    if (command.compare(0, 7, "AT+CMGL") == 0)
+    {
+        std::stringstream listing;
+        for (size_t i = 0; i < inbox.size(); i++)
+        {
+            listing << "\r\n+CMGL: " << inbox[i].index << ",\"REC UNREAD\",\"" << inbox[i].sender
+                    << "\",\"\",\"13/02/15,02:21:09-20\"\r\n" << inbox[i].text << "\r\n";
+        }
+        listing << "\r\nOK\r\n";
+        return listing.str();
+    }
+    if (command.compare(0, 8, "AT+CREG?") == 0)
+    {
+        // Always registered on the home network
+        return "\r\n+CREG: 0,1\r\n\r\nOK\r\n";
+    }
+    if (command.compare(0, 8, "AT+CMGD=") == 0)
+    {
+        int32_t index = strtol(command.c_str() + 8, NULL, 10);
+        for (size_t i = 0; i < inbox.size(); i++)
+        {
+            if (inbox[i].index == index)
+            {
+                inbox.erase(inbox.begin() + i);
+                break;
+            }
+        }
+    }
+    return "\r\nOK\r\n";
+}
+
+void CellModem::receiveText(const char* sender, const char* text)
+{
+    InboxText inboxText;
+    inboxText.index = nextIndex++;
+    inboxText.sender = sender;
+    inboxText.text = text;
+    inbox.push_back(inboxText);
+}
+
+uint32_t CellModem::getTextsSent() const
+{
+    return textsSent;
+}
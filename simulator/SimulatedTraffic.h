@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifndef SIMULATED_TRAFFIC
+#define SIMULATED_TRAFFIC
+
+// Sentences from a recorded NMEA log, such as devices/oldDATA.txt,
+// handed out in order and from the start again once they run out.
+class GpsTraffic
+{
+    public:
+
+    // Loads every sentence of the log.
+    // If there are none, isReady() will return false.
+    GpsTraffic(const char* logPath);
+
+    bool isReady() const;
+
+    // The next sentence, ending with \r\n
+    std::string nextSentence();
+
+    private:
+
+    std::vector<std::string> sentences;
+    size_t nextIndex;
+};
+
+// Puts the $, the checksum and \r\n around the body of an NMEA sentence
+std::string finishNmea(const std::string& body);
+
+// A VectorNav VNYMR sentence, as IMUDecoder expects, swaying slowly with the given time
+std::string imuSentence(double seconds);
+
+// A tag as missionControl's sendTag makes it, TAG^data:xx
+std::string akpTag(const char* tag, const char* data);
+
+// Answers the AT commands CellDriver sends, as a cell module in text mode does.
+// Texts can be put in its inbox to be listed and deleted.
+class CellModem
+{
+    public:
+
+    CellModem();
+
+    // Takes what was written to the modem and returns its reply, "" if none yet
+    std::string respond(const char* data, int32_t length);
+
+    // Puts a text in the inbox, to be given with the next listing of messages
+    void receiveText(const char* sender, const char* text);
+
+    // How many texts CellDriver has sent out through us
+    uint32_t getTextsSent() const;
+
+    private:
+
+    typedef struct
+    {
+        int32_t index;
+        std::string sender;
+        std::string text;
+    } InboxText;
+
+    // Replies to a single command, without its \r
+    std::string respondToCommand(const std::string& command);
+
+    std::string commandBuffer;
+
+    // After AT+CMGS, everything up to the Ctrl-Z is the text to send
+    bool isTakingText;
+
+    std::vector<InboxText> inbox;
+    int32_t nextIndex;
+    uint32_t textsSent;
+};
+
+#endif
@@ -0,0 +1,307 @@
+#include "TelemetryPolicy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+
+// Orders candidates by priority, then by whichever has been due the longest
+class CandidateOrder
+{
+    public:
+
+    CandidateOrder(const std::vector<TelemetryRule>& rules, const std::vector<uint64_t>& dueTimes)
+        : rules(rules), dueTimes(dueTimes)
+    {
+    }
+
+    bool operator()(size_t a, size_t b) const
+    {
+        if (rules[a].priority != rules[b].priority)
+        {
+            return rules[a].priority < rules[b].priority;
+        }
+        return dueTimes[a] < dueTimes[b];
+    }
+
+    private:
+
+    const std::vector<TelemetryRule>& rules;
+    const std::vector<uint64_t>& dueTimes;
+};
+
+TelemetryPolicy::TelemetryPolicy(uint32_t baudRate, uint32_t framePeriodMs)
+{
+    this->baudRate = baudRate;
+    this->framePeriodMs = framePeriodMs;
+    budgetPercent = 80;
+    frameTimeMs = 0;
+
+    memset(&defaultRule, 0, sizeof(defaultRule));
+    defaultRule.periodMs = 0;
+    defaultRule.priority = 5;
+    defaultRule.deadband = 0;
+
+    memset(&stats, 0, sizeof(stats));
+}
+
+size_t TelemetryPolicy::findState(const char* tag)
+{
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        if (strncmp(states[i].rule.tag, tag, 2) == 0)
+        {
+            return i;
+        }
+    }
+
+    TagState state;
+    state.rule = defaultRule;
+    strncpy(state.rule.tag, tag, 2);
+    state.rule.tag[2] = '\0';
+    state.nextDueMs = 0;
+    state.lastValue = 0;
+    state.lastSentMs = 0;
+    state.hasSent = false;
+    states.push_back(state);
+    return states.size() - 1;
+}
+
+void TelemetryPolicy::setRule(const TelemetryRule& rule)
+{
+    // Keep when it was last sent, so changing a rule does not send everything at once
+    TagState& state = states[findState(rule.tag)];
+    state.rule = rule;
+    state.rule.tag[2] = '\0';
+}
+
+bool TelemetryPolicy::applySetting(const char* setting)
+{
+    char name[16];
+    double values[3];
+    int valueCount = 0;
+
+    // The name runs up to the first comma
+    const char* comma = strchr(setting, ',');
+    if (!comma || comma == setting || comma - setting >= (int)sizeof(name))
+    {
+        return false;
+    }
+    memcpy(name, setting, comma - setting);
+    name[comma - setting] = '\0';
+
+    const char* next = comma + 1;
+    while (valueCount < 3)
+    {
+        char* endPtr;
+        values[valueCount] = strtod(next, &endPtr);
+        if (endPtr == next)
+        {
+            return false;
+        }
+        valueCount++;
+        while (*endPtr == ' ' || *endPtr == '\t' || *endPtr == '\r' || *endPtr == '\n')
+        {
+            endPtr++;
+        }
+        if (*endPtr == '\0')
+        {
+            break;
+        }
+        if (*endPtr != ',')
+        {
+            return false;
+        }
+        next = endPtr + 1;
+    }
+
+    if (strcmp(name, "frame") == 0)
+    {
+        if (values[0] < 1)
+        {
+            return false;
+        }
+        framePeriodMs = (uint32_t)values[0];
+        return true;
+    }
+    if (strcmp(name, "budget") == 0)
+    {
+        if (values[0] <= 0 || values[0] > 100)
+        {
+            return false;
+        }
+        budgetPercent = (uint32_t)values[0];
+        return true;
+    }
+    if (strlen(name) != 2 || values[0] < 0 || (valueCount > 1 && values[1] < 0) || (valueCount > 2 && values[2] < 0))
+    {
+        return false;
+    }
+
+    // Whatever is left off stays as it was
+    TagState& state = states[findState(name)];
+    state.rule.periodMs = (uint32_t)values[0];
+    if (valueCount > 1)
+    {
+        state.rule.priority = (uint8_t)std::min(values[1], 255.0);
+    }
+    if (valueCount > 2)
+    {
+        state.rule.deadband = values[2];
+    }
+    return true;
+}
+
+bool TelemetryPolicy::loadFile(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        perror("TelemetryPolicy: opening settings");
+        return false;
+    }
+
+    char line[128];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+        char* start = line;
+        while (*start == ' ' || *start == '\t')
+        {
+            start++;
+        }
+        if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0')
+        {
+            continue;
+        }
+        if (!applySetting(start))
+        {
+            std::cout << "TelemetryPolicy: skipping line " << lineNumber << " of " << path << ": " << start;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+void TelemetryPolicy::setBaudRate(uint32_t baudRate)
+{
+    this->baudRate = baudRate;
+}
+
+uint32_t TelemetryPolicy::getFramePeriodMs() const
+{
+    return framePeriodMs;
+}
+
+void TelemetryPolicy::beginFrame(uint64_t nowMs)
+{
+    frameTimeMs = nowMs;
+    candidates.clear();
+}
+
+void TelemetryPolicy::offer(const char* tag, const char* data)
+{
+    offer(tag, data, 0, false);
+}
+
+void TelemetryPolicy::offer(const char* tag, const char* data, double value)
+{
+    offer(tag, data, value, true);
+}
+
+void TelemetryPolicy::offer(const char* tag, const char* data, double value, bool hasValue)
+{
+    if (!data || !*data)
+    {
+        return;
+    }
+
+    size_t index = findState(tag);
+    TagState& state = states[index];
+
+    // Due within half a frame counts as due now, so a tag keeps to its period
+    // rather than slipping a frame whenever the frame runs a little early
+    if (state.rule.periodMs > 0 && state.nextDueMs > frameTimeMs + framePeriodMs / 2)
+    {
+        return;
+    }
+
+    if (hasValue && state.rule.deadband > 0 && state.hasSent &&
+        fabs(value - state.lastValue) <= state.rule.deadband)
+    {
+        uint32_t period = state.rule.periodMs > 0 ? state.rule.periodMs : framePeriodMs;
+        if (frameTimeMs < state.lastSentMs + (uint64_t)period * TELEMETRY_REFRESH_PERIODS)
+        {
+            stats.tagsUnchanged++;
+            return;
+        }
+    }
+
+    Candidate candidate;
+    candidate.state = index;
+    candidate.data = data;
+    candidate.value = hasValue ? value : state.lastValue;
+    candidates.push_back(candidate);
+}
+
+uint32_t TelemetryPolicy::endFrame(TelemetrySender sender)
+{
+    stats.frames++;
+
+    std::vector<TelemetryRule> rules;
+    std::vector<uint64_t> dueTimes;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        rules.push_back(states[candidates[i].state].rule);
+        dueTimes.push_back(states[candidates[i].state].nextDueMs);
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), CandidateOrder(rules, dueTimes));
+
+    // The frame's share of the radio, at 10 bits a byte with the start and stop bits
+    uint64_t budget = (uint64_t)baudRate / 10 * framePeriodMs / 1000 * budgetPercent / 100;
+    uint32_t bytesSent = 0;
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const Candidate& candidate = candidates[order[i]];
+        TagState& state = states[candidate.state];
+
+        uint32_t size = candidate.data.length() + TELEMETRY_TAG_OVERHEAD;
+        if (bytesSent + size > budget)
+        {
+            // Still due, so it goes out with the next frame that has room
+            stats.tagsShed++;
+            continue;
+        }
+
+        sender(state.rule.tag, candidate.data.c_str());
+        bytesSent += size;
+        stats.tagsSent++;
+
+        state.lastValue = candidate.value;
+        state.lastSentMs = frameTimeMs;
+        state.hasSent = true;
+        if (state.rule.periodMs > 0)
+        {
+            // Keep the tag's phase unless it has fallen a whole period behind
+            state.nextDueMs += state.rule.periodMs;
+            if (state.nextDueMs <= frameTimeMs)
+            {
+                state.nextDueMs = frameTimeMs + state.rule.periodMs;
+            }
+        }
+    }
+
+    stats.bytesSent += bytesSent;
+    candidates.clear();
+    return bytesSent;
+}
+
+const TelemetryStats& TelemetryPolicy::getStats() const
+{
+    return stats;
+}
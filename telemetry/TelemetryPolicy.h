@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifndef TELEMETRY_POLICY
+#define TELEMETRY_POLICY
+
+// Bytes an AKP tag takes on the wire besides its data: the two character tag, '^', ':' and the checksum
+#define TELEMETRY_TAG_OVERHEAD 6
+
+// Even a value that stays within its deadband is sent again after this many of its periods,
+// so the ground station can tell an unchanging value from a lost one
+#define TELEMETRY_REFRESH_PERIODS 10
+
+// How a tag is to be sent
+typedef struct
+{
+    char tag[3];
+    // Sent at most once every period. 0 for every frame.
+    uint32_t periodMs;
+    // 0 is sent first and shed last
+    uint8_t priority;
+    // A number is only sent when it has moved more than this since it was last sent. 0 to always send.
+    double deadband;
+} TelemetryRule;
+
+// What the policy has done, since it was made
+typedef struct
+{
+    uint64_t frames;
+    uint64_t tagsSent;
+    uint64_t bytesSent;
+    // Tags that were due but did not fit in the frame's share of the radio
+    uint64_t tagsShed;
+    // Tags that were due but had not changed past their deadband
+    uint64_t tagsUnchanged;
+} TelemetryStats;
+
+// Called for every tag that made it into a frame, with its data as text
+typedef void (*TelemetrySender)(const char* tag, const char* data);
+
+// Decides which telemetry tags go out in each frame.
+//
+// Each tag has a rule: how often it is sent, its priority, and a deadband to
+// skip numbers that have barely changed. Tags without a rule get the default one.
+// A frame is built by offering every tag we have a value for between beginFrame and
+// endFrame. The tags that are due are then sent in priority order until the frame's
+// share of the radio's bytes is used up. The rest are shed, and stay due for the next frame.
+//
+// Settings are lines of text, the same from a file or uplinked as a tag:
+//   LA,500,0,0      tag, period in ms, priority, deadband (the last ones may be left off)
+//   frame,500       ms between frames
+//   budget,80       percentage of the radio's bytes that telemetry may use
+class TelemetryPolicy
+{
+    public:
+
+    // The radio's bytes are worked out from its baud rate, at 10 bits a byte
+    TelemetryPolicy(uint32_t baudRate, uint32_t framePeriodMs);
+
+    // Adds or replaces the rule for rule.tag
+    void setRule(const TelemetryRule& rule);
+
+    // Applies a single setting line. Returns whether it made sense.
+    bool applySetting(const char* setting);
+
+    // Applies every setting line of a file, skipping blank lines and # comments.
+    // Returns false if the file could not be read. Bad lines are reported and skipped.
+    bool loadFile(const char* path);
+
+    void setBaudRate(uint32_t baudRate);
+
+    // ms between frames, for scheduling endFrame
+    uint32_t getFramePeriodMs() const;
+
+    // Starts a frame built at the given time in ms
+    void beginFrame(uint64_t nowMs);
+
+    // Offers text that has no number to compare, so it has no deadband
+    void offer(const char* tag, const char* data);
+
+    // Offers a number, with its text
+    void offer(const char* tag, const char* data, double value);
+
+    // Sends the tags that are due and fit, highest priority first. Returns how many bytes were sent.
+    uint32_t endFrame(TelemetrySender sender);
+
+    const TelemetryStats& getStats() const;
+
+    private:
+
+    typedef struct
+    {
+        TelemetryRule rule;
+        uint64_t nextDueMs;
+        // What was last sent, for the deadband
+        double lastValue;
+        uint64_t lastSentMs;
+        bool hasSent;
+    } TagState;
+
+    typedef struct
+    {
+        size_t state;
+        std::string data;
+        double value;
+    } Candidate;
+
+    // The state for a tag, made from the default rule the first time it is seen
+    size_t findState(const char* tag);
+
+    void offer(const char* tag, const char* data, double value, bool hasValue);
+
+    std::vector<TagState> states;
+    TelemetryRule defaultRule;
+
+    std::vector<Candidate> candidates;
+    uint64_t frameTimeMs;
+
+    uint32_t baudRate;
+    uint32_t framePeriodMs;
+    uint32_t budgetPercent;
+
+    TelemetryStats stats;
+};
+
+#endif
@@ -0,0 +1,334 @@
+// Answers time-range queries over flight recorder log segments.
+// Each segment's sparse index (<segment>.idx, built here if missing or stale)
+// is binary-searched for the start of the range, so only the records in the range are read.
+//
+// Recorded samples are expanded to the same AKP tags missionControl sends:
+// GPS gives HD GS LO LA AL SP TH MH, IMU gives YA PI RO AX AY AZ,
+// ADC conversions are A0 to A7 by channel and PWM readings are PW.
+//
+// Examples:
+//   flightLogQuery -f 120 -t 180 -g LA,LO,AL flight-*.flog
+//   flightLogQuery -g YA,PI,RO -d 10 -o akp flight-*.flog
+//   flightLogQuery -i flight-*.flog    (only rebuild the indexes)
+
+#define __STDC_LIMIT_MACROS
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <map>
+#include <string>
+
+#include "../recorder/FlightLog.h"
+#include "../recorder/FlightLogIndex.h"
+#include "../akp/cAkpParser/crc8.h"
+
+#define MAX_RECORD_TAGS 8
+
+typedef struct
+{
+    char tag[3];
+    char value[24];
+} TagValue;
+
+// Tags used when none are asked for
+const char* defaultTags[] = {"LA", "LO", "AL", "GS", "HD", "SP", "TH", "MH", "YA", "PI", "RO", "AX", "AY", "AZ"};
+
+void setTag(TagValue* tagValue, const char* tag)
+{
+    strncpy(tagValue->tag, tag, sizeof(tagValue->tag) - 1);
+    tagValue->tag[sizeof(tagValue->tag) - 1] = '\0';
+}
+
+// Adds an integer tag unless it is INT32_MIN (not decoded), as missionControl does
+int addIntTag(TagValue* tags, int count, const char* tag, int32_t value)
+{
+    if (value != INT32_MIN)
+    {
+        setTag(&tags[count], tag);
+        snprintf(tags[count].value, sizeof(tags[count].value), "%d", value);
+        count++;
+    }
+    return count;
+}
+
+int addDoubleTag(TagValue* tags, int count, const char* tag, double value)
+{
+    setTag(&tags[count], tag);
+    snprintf(tags[count].value, sizeof(tags[count].value), "%g", value);
+    return count + 1;
+}
+
+// Expands a record into the tags it carries. Returns how many.
+int recordTags(const FlightRecordView& record, TagValue* tags)
+{
+    int count = 0;
+    switch (record.header->type)
+    {
+        case FLIGHT_RECORD_GPS:
+        {
+            GpsSampleRecord gps;
+            memcpy(&gps, record.payload, sizeof(gps));
+            count = addIntTag(tags, count, "HD", gps.hdop);
+            count = addIntTag(tags, count, "GS", gps.satelliteCount);
+            count = addIntTag(tags, count, "LO", gps.longitude);
+            count = addIntTag(tags, count, "LA", gps.latitude);
+            count = addIntTag(tags, count, "AL", gps.altitude);
+            count = addIntTag(tags, count, "SP", gps.speed);
+            count = addIntTag(tags, count, "TH", gps.trueHeading);
+            count = addIntTag(tags, count, "MH", gps.magneticHeading);
+            break;
+        }
+        case FLIGHT_RECORD_IMU:
+        {
+            ImuSampleRecord imu;
+            memcpy(&imu, record.payload, sizeof(imu));
+            count = addDoubleTag(tags, count, "YA", imu.yaw);
+            count = addDoubleTag(tags, count, "PI", imu.pitch);
+            count = addDoubleTag(tags, count, "RO", imu.roll);
+            count = addDoubleTag(tags, count, "AX", imu.accelX);
+            count = addDoubleTag(tags, count, "AY", imu.accelY);
+            count = addDoubleTag(tags, count, "AZ", imu.accelZ);
+            break;
+        }
+        case FLIGHT_RECORD_ADC:
+        {
+            AdcSampleRecord adc;
+            memcpy(&adc, record.payload, sizeof(adc));
+            char tag[3] = {'A', (char)('0' + (record.header->source & 7)), '\0'};
+            if (adc.value < 0)
+            {
+                count = addIntTag(tags, count, tag, -1);
+            }
+            else
+            {
+                count = addDoubleTag(tags, count, tag, (double)adc.value / (1 << FLIGHT_ADC_FRACTION_BITS));
+            }
+            break;
+        }
+        case FLIGHT_RECORD_PWM:
+        {
+            PwmSampleRecord pwm;
+            memcpy(&pwm, record.payload, sizeof(pwm));
+            count = addIntTag(tags, count, "PW", pwm.value);
+            break;
+        }
+    }
+    return count;
+}
+
+char getHexOfNibble(char c)
+{
+    c = c & 0x0f;
+    return (c < 10) ? ('0' + c) : ('a' + c - 10);
+}
+
+// Prints in the same form as sendTag in missionControl
+void printAkpTag(const char* tag, const char* data)
+{
+    unsigned char checksum = crc8(tag, 0);
+    checksum = crc8(data, checksum);
+    printf("%s^%s:%c%c", tag, data, getHexOfNibble(checksum >> 4), getHexOfNibble(checksum));
+}
+
+// Loads the index beside the segment, or builds (and tries to save) one
+void loadIndex(const char* segmentPath, FlightLogReader& reader, FlightLogIndex* index)
+{
+    std::string indexPath = FlightLogIndex::pathFor(segmentPath);
+    if (!index->load(indexPath.c_str(), reader.size()))
+    {
+        index->build(reader);
+        // Not being able to save is fine, we have it for this run
+        index->save(indexPath.c_str());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double fromSeconds = 0;
+    double toSeconds = -1;
+    double decimateHz = 0;
+    bool outputAkp = false;
+    bool onlyIndex = false;
+    std::vector<std::string> selectedTags;
+
+    int option;
+    while ((option = getopt(argc, argv, "f:t:g:d:o:i")) != -1)
+    {
+        switch (option)
+        {
+            case 'f':
+                fromSeconds = strtod(optarg, NULL);
+                break;
+            case 't':
+                toSeconds = strtod(optarg, NULL);
+                break;
+            case 'g':
+            {
+                // Comma separated tags
+                char* saveState;
+                for (char* tag = strtok_r(optarg, ",", &saveState); tag; tag = strtok_r(NULL, ",", &saveState))
+                {
+                    selectedTags.push_back(tag);
+                }
+                break;
+            }
+            case 'd':
+                decimateHz = strtod(optarg, NULL);
+                break;
+            case 'o':
+                outputAkp = (strcmp(optarg, "akp") == 0);
+                break;
+            case 'i':
+                onlyIndex = true;
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "%s: [-f from seconds] [-t to seconds] [-g TAG,TAG...] [-d decimate to hz] [-o csv|akp] [-i] <segment>...\n", argv[0]);
+        fprintf(stderr, "Seconds count from the first record of the first segment.\n");
+        return -1;
+    }
+
+    if (onlyIndex)
+    {
+        for (int i = optind; i < argc; i++)
+        {
+            FlightLogReader reader(argv[i]);
+            if (reader.isReady())
+            {
+                FlightLogIndex index;
+                index.build(reader);
+                if (!index.save(FlightLogIndex::pathFor(argv[i]).c_str()))
+                {
+                    return -1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    if (selectedTags.empty())
+    {
+        selectedTags.assign(defaultTags, defaultTags + sizeof(defaultTags) / sizeof(*defaultTags));
+    }
+    // Column of each selected tag
+    std::map<std::string, int> tagColumns;
+    for (size_t i = 0; i < selectedTags.size(); i++)
+    {
+        tagColumns[selectedTags[i]] = i;
+    }
+
+    if (!outputAkp)
+    {
+        printf("time");
+        for (size_t i = 0; i < selectedTags.size(); i++)
+        {
+            printf(",%s", selectedTags[i].c_str());
+        }
+        printf("\n");
+    }
+
+    uint64_t decimateInterval = (decimateHz > 0) ? (uint64_t)(1e9 / decimateHz) : 0;
+    // Last time output for each record type and source, for decimation
+    std::map<int, uint64_t> lastOutputTimes;
+
+    uint64_t baseTime = 0;
+    bool hasBaseTime = false;
+    for (int i = optind; i < argc; i++)
+    {
+        FlightLogReader reader(argv[i]);
+        if (!reader.isReady())
+        {
+            fprintf(stderr, "Could not read %s\n", argv[i]);
+            continue;
+        }
+        FlightLogIndex index;
+        loadIndex(argv[i], reader, &index);
+
+        if (!hasBaseTime)
+        {
+            baseTime = index.getFirstTimestamp();
+            hasBaseTime = true;
+        }
+        uint64_t fromTime = baseTime + (uint64_t)(fromSeconds * 1e9);
+        uint64_t toTime = (toSeconds < 0) ? UINT64_MAX : baseTime + (uint64_t)(toSeconds * 1e9);
+
+        reader.seek(index.findOffset(fromTime));
+        FlightRecordView record;
+        while (reader.next(&record))
+        {
+            uint64_t time = record.header->timestamp;
+            if (time < fromTime)
+            {
+                continue;
+            }
+            // Timestamps only go forward within a segment
+            if (time > toTime)
+            {
+                break;
+            }
+
+            TagValue tags[MAX_RECORD_TAGS];
+            int tagCount = recordTags(record, tags);
+
+            // Which of the tags were asked for, by column
+            std::vector<const char*> row(selectedTags.size(), (const char*)NULL);
+            bool hasSelected = false;
+            for (int k = 0; k < tagCount; k++)
+            {
+                std::map<std::string, int>::const_iterator column = tagColumns.find(tags[k].tag);
+                if (column != tagColumns.end())
+                {
+                    row[column->second] = tags[k].value;
+                    hasSelected = true;
+                }
+            }
+            if (!hasSelected)
+            {
+                continue;
+            }
+
+            if (decimateInterval)
+            {
+                int stream = (record.header->type << 8) | record.header->source;
+                std::map<int, uint64_t>::iterator last = lastOutputTimes.find(stream);
+                if (last != lastOutputTimes.end() && time < last->second + decimateInterval)
+                {
+                    continue;
+                }
+                lastOutputTimes[stream] = time;
+            }
+
+            double seconds = (double)(time - baseTime) / 1e9;
+            if (outputAkp)
+            {
+                // The AKP parser skips the leading time like any other noise between tags
+                printf("%.6f ", seconds);
+                for (size_t k = 0; k < row.size(); k++)
+                {
+                    if (row[k])
+                    {
+                        printAkpTag(selectedTags[k].c_str(), row[k]);
+                    }
+                }
+            }
+            else
+            {
+                printf("%.6f", seconds);
+                for (size_t k = 0; k < row.size(); k++)
+                {
+                    printf(",%s", row[k] ? row[k] : "");
+                }
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+// Rebuilds a timeline from flight recorder log segments.
+// Records from all the given segments are merged in time order and printed one per line:
+// <seconds since first record> <wall-clock time> <type> <source> <values...>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+#include "../recorder/FlightLog.h"
+
+typedef struct
+{
+    FlightRecordView view;
+    // Offset to turn this record's monotonic time into wall-clock time, 0 if unknown
+    int64_t realTimeOffset;
+} TimelineEntry;
+
+bool isEarlier(const TimelineEntry& a, const TimelineEntry& b)
+{
+    return a.view.header->timestamp < b.view.header->timestamp;
+}
+
+void printSerial(const uint8_t* data, int length)
+{
+    putchar('"');
+    for (int i = 0; i < length; i++)
+    {
+        int c = data[i];
+        if (c == '\\' || c == '"')
+        {
+            printf("\\%c", c);
+        }
+        else if (c >= 32 && c < 127)
+        {
+            putchar(c);
+        }
+        else if (c == '\r')
+        {
+            printf("\\r");
+        }
+        else if (c == '\n')
+        {
+            printf("\\n");
+        }
+        else
+        {
+            printf("\\x%02x", c);
+        }
+    }
+    putchar('"');
+}
+
+void printEntry(const TimelineEntry& entry, uint64_t firstTimestamp)
+{
+    const FlightRecordHeader* header = entry.view.header;
+    const uint8_t* payload = entry.view.payload;
+
+    uint64_t sinceFirst = header->timestamp - firstTimestamp;
+    printf("%llu.%06llu ", (unsigned long long)(sinceFirst / 1000000000ULL), (unsigned long long)(sinceFirst % 1000000000ULL / 1000));
+
+    if (entry.realTimeOffset)
+    {
+        uint64_t realTime = header->timestamp + entry.realTimeOffset;
+        time_t seconds = realTime / 1000000000ULL;
+        struct tm parts;
+        gmtime_r(&seconds, &parts);
+        char formatted[32];
+        strftime(formatted, sizeof(formatted), "%Y-%m-%dT%H:%M:%S", &parts);
+        printf("%s.%03lluZ ", formatted, (unsigned long long)(realTime % 1000000000ULL / 1000000));
+    }
+    else
+    {
+        printf("- ");
+    }
+
+    printf("%s %d ", flightRecordTypeName(header->type), header->source);
+
+    switch (header->type)
+    {
+        case FLIGHT_RECORD_SEGMENT_START:
+        {
+            SegmentStartRecord start;
+            memcpy(&start, payload, sizeof(start));
+            printf("segment=%u", start.segmentNumber);
+            break;
+        }
+        case FLIGHT_RECORD_SERIAL_RX:
+            printSerial(payload, header->length);
+            break;
+        case FLIGHT_RECORD_GPS:
+        {
+            GpsSampleRecord gps;
+            memcpy(&gps, payload, sizeof(gps));
+            printf("LA=%d LO=%d AL=%d GS=%d HD=%d SP=%d TH=%d MH=%d",
+                   gps.latitude, gps.longitude, gps.altitude, gps.satelliteCount,
+                   gps.hdop, gps.speed, gps.trueHeading, gps.magneticHeading);
+            break;
+        }
+        case FLIGHT_RECORD_IMU:
+        {
+            ImuSampleRecord imu;
+            memcpy(&imu, payload, sizeof(imu));
+            printf("YA=%g PI=%g RO=%g AX=%g AY=%g AZ=%g",
+                   imu.yaw, imu.pitch, imu.roll, imu.accelX, imu.accelY, imu.accelZ);
+            break;
+        }
+        case FLIGHT_RECORD_ADC:
+        {
+            AdcSampleRecord adc;
+            memcpy(&adc, payload, sizeof(adc));
+            printf("value=%d (%.3f counts)", adc.value, (double)adc.value / (1 << FLIGHT_ADC_FRACTION_BITS));
+            break;
+        }
+        case FLIGHT_RECORD_PWM:
+        {
+            PwmSampleRecord pwm;
+            memcpy(&pwm, payload, sizeof(pwm));
+            printf("gpio=%d value=%d", pwm.gpio, pwm.value);
+            break;
+        }
+        default:
+            printf("length=%d", header->length);
+            break;
+    }
+    putchar('\n');
+}
+
+int main(int argc, char* argv[])
+{
+    bool showSerial = false;
+    int onlyType = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "rt:")) != -1)
+    {
+        switch (option)
+        {
+            case 'r':
+                showSerial = true;
+                break;
+            case 't':
+                onlyType = (int)strtol(optarg, NULL, 10);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "%s: [-r show raw serial] [-t record type number] <segment>...\n", argv[0]);
+        return -1;
+    }
+
+    // Readers own the mappings the entries point into, so they live until the end
+    std::vector<FlightLogReader*> readers;
+    std::vector<TimelineEntry> timeline;
+    for (int i = optind; i < argc; i++)
+    {
+        FlightLogReader* reader = new FlightLogReader(argv[i]);
+        if (!reader->isReady())
+        {
+            fprintf(stderr, "Could not read %s\n", argv[i]);
+            delete reader;
+            continue;
+        }
+        readers.push_back(reader);
+
+        TimelineEntry entry;
+        entry.realTimeOffset = 0;
+        while (reader->next(&entry.view))
+        {
+            const FlightRecordHeader* header = entry.view.header;
+            if (header->type == FLIGHT_RECORD_SEGMENT_START)
+            {
+                SegmentStartRecord start;
+                memcpy(&start, entry.view.payload, sizeof(start));
+                entry.realTimeOffset = (int64_t)(start.realTime - header->timestamp);
+            }
+            if ((header->type == FLIGHT_RECORD_SERIAL_RX && !showSerial) ||
+                (onlyType && header->type != onlyType))
+            {
+                continue;
+            }
+            timeline.push_back(entry);
+        }
+
+        if (reader->getCorruptCount())
+        {
+            fprintf(stderr, "%s: skipped %u corrupt stretches\n", argv[i], reader->getCorruptCount());
+        }
+    }
+
+    // Segments of one recorder are already in order, but captures from several may interleave
+    std::stable_sort(timeline.begin(), timeline.end(), isEarlier);
+
+    for (size_t i = 0; i < timeline.size(); i++)
+    {
+        printEntry(timeline[i], timeline[0].view.header->timestamp);
+    }
+
+    for (size_t i = 0; i < readers.size(); i++)
+    {
+        delete readers[i];
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Stands in for the beaglebone's hardware so missionControl can run on any linux machine.
+// Uarts become pseudo-terminals and the sysfs, spidev, i2c and pwm_in files become plain files,
+// all under the given directory. Then run missionControl with MISSION_HW_PREFIX set to it.
+//
+// Example:
+//   hardwareSimulator -i 100 /tmp/sim &
+//   MISSION_HW_PREFIX=/tmp/sim missionControl -L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../simulator/HardwareSimulator.h"
+
+volatile sig_atomic_t isStopping = 0;
+
+void stop(int signalNumber)
+{
+    isStopping = 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SimulatorSettings settings = defaultSimulatorSettings();
+    bool isQuiet = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:g:i:t:c:q")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                settings.gpsLogPath = optarg;
+                break;
+            case 'g':
+                settings.gpsSentenceRate = strtod(optarg, NULL);
+                break;
+            case 'i':
+                settings.imuSentenceRate = strtod(optarg, NULL);
+                break;
+            case 't':
+                settings.transceiverTagRate = strtod(optarg, NULL);
+                break;
+            case 'c':
+                settings.cellTextInterval = strtod(optarg, NULL);
+                break;
+            case 'q':
+                isQuiet = true;
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "%s: [-n nmea log] [-g gps sentences/s] [-i imu sentences/s] [-t transceiver tags/s] [-c seconds between texts] [-q] <directory>\n", argv[0]);
+        fprintf(stderr, "Defaults are %s, 8, 40, 0.2 and 60.\n", settings.gpsLogPath);
+        return -1;
+    }
+
+    HardwareSimulator simulator(argv[optind], settings);
+    if (!simulator.isReady())
+    {
+        fprintf(stderr, "Could not make the simulated hardware under %s\n", argv[optind]);
+        return -1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    double startTime = simulatorSeconds();
+    double nextReportTime = startTime + 1;
+    while (!isStopping)
+    {
+        simulator.update();
+
+        if (!isQuiet && simulatorSeconds() >= nextReportTime)
+        {
+            nextReportTime += 1;
+            // Bytes sent to missionControl on each uart, and how many the terminal would not take
+            printf("%.0fs frames %u tags %u texts %u servo1 %d (%u set) |", nextReportTime - 1 - startTime,
+                   simulator.getTelemetryFrames(), simulator.getTelemetryTags(), simulator.getCellModem().getTextsSent(),
+                   simulator.getServoPosition(1), simulator.getServoCommands());
+            for (int uart = 1; uart <= SIMULATED_UART_COUNT; uart++)
+            {
+                PtyPort* port = simulator.getPort(uart);
+                printf(" ttyO%d %llu/%llu", uart, (unsigned long long)port->getBytesWritten(), (unsigned long long)port->getBytesDropped());
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+
+        struct timespec sleepTime = {0, 1000000};
+        nanosleep(&sleepTime, NULL);
+    }
+    return 0;
+}
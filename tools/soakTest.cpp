@@ -0,0 +1,435 @@
+// Soak test: runs missionControl against the hardware simulator with every uart it reads
+// kept full at a multiple of its baud rate, for as long as asked, and measures how it copes.
+//
+// Every report interval it prints
+//   the telemetry tick: intervals between frames (ended with the LV tag), which should be 1000 ms,
+//   missionControl's cpu use and resident memory from /proc,
+//   bytes lost on each uart, being bytes the pseudo-terminal would not take because
+//   missionControl was not reading (where a real uart would overrun).
+// At the end it adds the GPS and IMU decoder latency percentiles, taken from the flight log
+// by way of the send times the simulator puts in each sentence's altitude and yaw.
+//
+// The test fails if any telemetry frame comes later than 1000 ms + tolerance after the one
+// before it (the 1 Hz deadline), or if missionControl stops running.
+//
+// Example:
+//   soakTest -m 4 -d 7200 -p ./missionControl
+
+#define __STDC_LIMIT_MACROS
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../simulator/HardwareSimulator.h"
+#include "../devices/HardwarePath.h"
+#include "../recorder/FlightLog.h"
+
+// How long missionControl has to send its first frame after starting
+#define FIRST_FRAME_SECONDS 3
+
+volatile sig_atomic_t isStopping = 0;
+
+void stop(int signalNumber)
+{
+    isStopping = 1;
+}
+
+// The value below which the given fraction of the sorted values fall
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+void printPercentiles(const char* name, std::vector<double>& values)
+{
+    std::sort(values.begin(), values.end());
+    printf("%s: %zu samples, ms p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f max %.3f\n", name, values.size(),
+           percentile(values, 0.5), percentile(values, 0.9), percentile(values, 0.99), percentile(values, 0.999),
+           values.empty() ? 0 : values.back());
+}
+
+// Total cpu seconds the process has used, or -1 if it is gone
+double processCpuSeconds(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+    char line[1024];
+    char* result = fgets(line, sizeof(line), file);
+    fclose(file);
+    // The name may have spaces, so count fields from after it; utime and stime are the 14th and 15th
+    char* fields = result ? strrchr(line, ')') : NULL;
+    unsigned long userTicks;
+    unsigned long systemTicks;
+    if (!fields || sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &userTicks, &systemTicks) != 2)
+    {
+        return -1;
+    }
+    return (double)(userTicks + systemTicks) / sysconf(_SC_CLK_TCK);
+}
+
+// Resident memory of the process in kB, or -1 if it is gone
+long processRssKb(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+    char line[256];
+    long rss = -1;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "VmRSS: %ld", &rss) == 1)
+        {
+            break;
+        }
+    }
+    fclose(file);
+    return rss;
+}
+
+// Starts missionControl on the simulated hardware, recording to flightPrefix
+pid_t startMissionControl(const char* path, const std::string& hardwarePrefix, const std::string& flightPrefix,
+                          const std::string& logPath, bool isEchoing)
+{
+    // Console input: ')' turns the echo of every uart off, then there is no more
+    int inputPipe[2];
+    if (pipe(inputPipe) == -1)
+    {
+        perror("soakTest: making input pipe");
+        return -1;
+    }
+    if (!isEchoing)
+    {
+        write(inputPipe[1], ")", 1);
+    }
+    close(inputPipe[1]);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int logHandle = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(inputPipe[0], 0);
+        if (logHandle != -1)
+        {
+            dup2(logHandle, 1);
+            dup2(logHandle, 2);
+        }
+        setenv(HARDWARE_PREFIX_VARIABLE, hardwarePrefix.c_str(), 1);
+        execl(path, path, "-l", flightPrefix.c_str(), (char*)NULL);
+        perror("soakTest: starting missionControl");
+        _exit(127);
+    }
+    close(inputPipe[0]);
+    if (pid == -1)
+    {
+        perror("soakTest: forking");
+    }
+    return pid;
+}
+
+// Asks missionControl to stop so its flight log is closed, then makes sure
+void stopMissionControl(pid_t pid)
+{
+    kill(pid, SIGTERM);
+    for (int i = 0; i < 50; i++)
+    {
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            return;
+        }
+        struct timespec sleepTime = {0, 100000000};
+        nanosleep(&sleepTime, NULL);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+// Decoder latencies of every newly decoded GPS fix and IMU sentence in the flight log,
+// and how many of each were decoded
+void readDecoderLatencies(const std::string& flightPrefix, std::vector<double>* gpsLatencies, std::vector<double>* imuLatencies)
+{
+    std::string pattern = flightPrefix + "-*.flog";
+    glob_t segments;
+    if (glob(pattern.c_str(), 0, NULL, &segments) != 0)
+    {
+        return;
+    }
+
+    int32_t lastAltitude = INT32_MIN;
+    double lastYaw = -1;
+    for (size_t i = 0; i < segments.gl_pathc; i++)
+    {
+        FlightLogReader reader(segments.gl_pathv[i]);
+        FlightRecordView record;
+        while (reader.isReady() && reader.next(&record))
+        {
+            double decodedTime = record.header->timestamp / 1e9;
+            // A sample is recorded for every sentence decoded, not only the ones
+            // carrying the time, so only a change counts as a new one
+            if (record.header->type == FLIGHT_RECORD_GPS)
+            {
+                GpsSampleRecord gps;
+                memcpy(&gps, record.payload, sizeof(gps));
+                if (gps.altitude != lastAltitude && gps.altitude != INT32_MIN)
+                {
+                    lastAltitude = gps.altitude;
+                    // Milliseconds, taken as whole meters and so in millimeters
+                    double sentTime = decodedSentenceTime(gps.altitude / 1e6, decodedTime);
+                    gpsLatencies->push_back((decodedTime - sentTime) * 1000);
+                }
+            }
+            else if (record.header->type == FLIGHT_RECORD_IMU)
+            {
+                ImuSampleRecord imu;
+                memcpy(&imu, record.payload, sizeof(imu));
+                if (imu.yaw != lastYaw)
+                {
+                    lastYaw = imu.yaw;
+                    double sentTime = decodedSentenceTime(imu.yaw, decodedTime);
+                    imuLatencies->push_back((decodedTime - sentTime) * 1000);
+                }
+            }
+        }
+    }
+    globfree(&segments);
+}
+
+int main(int argc, char* argv[])
+{
+    SimulatorSettings settings = defaultSimulatorSettings();
+    settings.saturationMultiplier = 1;
+    settings.isTimestampingSentences = true;
+    settings.cellTextInterval = 0;
+    const char* missionControlPath = "./missionControl";
+    const char* workDirectory = NULL;
+    double durationSeconds = 3600;
+    double toleranceMs = 100;
+    double reportSeconds = 10;
+    bool isEchoing = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "m:d:j:r:p:n:w:e")) != -1)
+    {
+        switch (option)
+        {
+            case 'm':
+                settings.saturationMultiplier = strtod(optarg, NULL);
+                break;
+            case 'd':
+                durationSeconds = strtod(optarg, NULL);
+                break;
+            case 'j':
+                toleranceMs = strtod(optarg, NULL);
+                break;
+            case 'r':
+                reportSeconds = strtod(optarg, NULL);
+                break;
+            case 'p':
+                missionControlPath = optarg;
+                break;
+            case 'n':
+                settings.gpsLogPath = optarg;
+                break;
+            case 'w':
+                workDirectory = optarg;
+                break;
+            case 'e':
+                isEchoing = true;
+                break;
+            default:
+                fprintf(stderr, "%s: [-m baud multiplier] [-d seconds] [-j tick tolerance ms] [-r report seconds] [-p missionControl] [-n nmea log] [-w work directory] [-e]\n", argv[0]);
+                fprintf(stderr, "Defaults are 1, 3600, 100, 10, ./missionControl, %s and a new directory in /tmp.\n", settings.gpsLogPath);
+                fprintf(stderr, "-e leaves missionControl echoing every uart to its log.\n");
+                return -1;
+        }
+    }
+    if (settings.saturationMultiplier <= 0)
+    {
+        settings.saturationMultiplier = 1;
+    }
+
+    char madeDirectory[] = "/tmp/soakTestXXXXXX";
+    if (!workDirectory)
+    {
+        workDirectory = mkdtemp(madeDirectory);
+        if (!workDirectory)
+        {
+            perror("soakTest: making work directory");
+            return -1;
+        }
+    }
+    std::string hardwarePrefix = std::string(workDirectory) + "/hardware";
+    std::string flightPrefix = std::string(workDirectory) + "/flight";
+    std::string logPath = std::string(workDirectory) + "/missionControl.log";
+
+    HardwareSimulator simulator(hardwarePrefix.c_str(), settings);
+    if (!simulator.isReady())
+    {
+        fprintf(stderr, "Could not make the simulated hardware under %s\n", hardwarePrefix.c_str());
+        return -1;
+    }
+
+    printf("Soak testing %s at %gx baud for %gs, working in %s\n", missionControlPath, settings.saturationMultiplier, durationSeconds, workDirectory);
+    pid_t pid = startMissionControl(missionControlPath, hardwarePrefix, flightPrefix, logPath, isEchoing);
+    if (pid == -1)
+    {
+        return -1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    // The uarts missionControl reads from
+    const int uarts[] = {1, 2, 4, 5};
+    const int uartCount = sizeof(uarts) / sizeof(*uarts);
+
+    double startTime = simulatorSeconds();
+    double nextReportTime = startTime + reportSeconds;
+    double lastFrameTime = -1;
+    bool isGapReported = false;
+    uint32_t missedDeadlines = 0;
+    bool hasExited = false;
+
+    std::vector<double> tickIntervals;
+    size_t reportedIntervals = 0;
+    double lastCpuSeconds = 0;
+    double lastReportTime = startTime;
+    long firstRssKb = -1;
+    long lastRssKb = -1;
+    long maxRssKb = 0;
+
+    while (!isStopping && simulatorSeconds() < startTime + durationSeconds)
+    {
+        simulator.update();
+        double now = simulatorSeconds();
+
+        std::vector<double> frameTimes = simulator.takeFrameTimes();
+        for (size_t i = 0; i < frameTimes.size(); i++)
+        {
+            if (lastFrameTime >= 0)
+            {
+                double intervalMs = (frameTimes[i] - lastFrameTime) * 1000;
+                tickIntervals.push_back(intervalMs);
+                if (intervalMs > 1000 + toleranceMs && !isGapReported)
+                {
+                    missedDeadlines++;
+                    printf("%.0fs: telemetry deadline missed, frame came %.1f ms after the last\n", frameTimes[i] - startTime, intervalMs);
+                }
+            }
+            lastFrameTime = frameTimes[i];
+            isGapReported = false;
+        }
+
+        // A frame that does not come at all is just as late
+        double deadline = (lastFrameTime >= 0) ? lastFrameTime + (1000 + toleranceMs) / 1000 : startTime + FIRST_FRAME_SECONDS;
+        if (now > deadline && !isGapReported)
+        {
+            missedDeadlines++;
+            isGapReported = true;
+            printf("%.0fs: telemetry deadline missed, no frame for over %.0f ms\n", now - startTime,
+                   (now - ((lastFrameTime >= 0) ? lastFrameTime : startTime)) * 1000);
+        }
+
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            hasExited = true;
+            printf("%.0fs: missionControl stopped running, see %s\n", now - startTime, logPath.c_str());
+            break;
+        }
+
+        if (now >= nextReportTime)
+        {
+            nextReportTime += reportSeconds;
+
+            double cpuSeconds = processCpuSeconds(pid);
+            long rssKb = processRssKb(pid);
+            double cpuPercent = (cpuSeconds - lastCpuSeconds) / (now - lastReportTime) * 100;
+            lastCpuSeconds = cpuSeconds;
+            lastReportTime = now;
+            if (firstRssKb < 0)
+            {
+                firstRssKb = rssKb;
+            }
+            lastRssKb = rssKb;
+            maxRssKb = std::max(maxRssKb, rssKb);
+
+            // Tick intervals since the last report
+            double minimumMs = 0;
+            double maximumMs = 0;
+            double totalMs = 0;
+            for (size_t i = reportedIntervals; i < tickIntervals.size(); i++)
+            {
+                minimumMs = (i == reportedIntervals) ? tickIntervals[i] : std::min(minimumMs, tickIntervals[i]);
+                maximumMs = std::max(maximumMs, tickIntervals[i]);
+                totalMs += tickIntervals[i];
+            }
+            size_t intervalCount = tickIntervals.size() - reportedIntervals;
+            reportedIntervals = tickIntervals.size();
+
+            printf("%6.0fs frames %u missed %u tick ms mean %.1f min %.1f max %.1f | cpu %.1f%% rss %ldkB | lost",
+                   now - startTime, simulator.getTelemetryFrames(), missedDeadlines,
+                   intervalCount ? totalMs / intervalCount : 0, minimumMs, maximumMs, cpuPercent, rssKb);
+            for (int i = 0; i < uartCount; i++)
+            {
+                printf(" ttyO%d %llu", uarts[i], (unsigned long long)simulator.getPort(uarts[i])->getBytesDropped());
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+
+        struct timespec sleepTime = {0, 500000};
+        nanosleep(&sleepTime, NULL);
+    }
+
+    if (!hasExited)
+    {
+        stopMissionControl(pid);
+    }
+
+    printf("\nSummary after %.0fs at %gx baud\n", simulatorSeconds() - startTime, settings.saturationMultiplier);
+    printf("Telemetry frames %u, deadlines missed %u (tolerance %g ms)\n", simulator.getTelemetryFrames(), missedDeadlines, toleranceMs);
+    printPercentiles("Tick interval", tickIntervals);
+    for (int i = 0; i < uartCount; i++)
+    {
+        PtyPort* port = simulator.getPort(uarts[i]);
+        uint64_t offered = port->getBytesWritten() + port->getBytesDropped();
+        printf("ttyO%d: %llu bytes offered, %llu lost (%.3f%%)\n", uarts[i], (unsigned long long)offered,
+               (unsigned long long)port->getBytesDropped(), offered ? 100.0 * port->getBytesDropped() / offered : 0);
+    }
+    printf("Memory: rss %ldkB at first report, %ldkB at last, %ldkB at most\n", firstRssKb, lastRssKb, maxRssKb);
+
+    std::vector<double> gpsLatencies;
+    std::vector<double> imuLatencies;
+    readDecoderLatencies(flightPrefix, &gpsLatencies, &imuLatencies);
+    printf("GPS fixes decoded %zu of %llu sent\n", gpsLatencies.size(), (unsigned long long)simulator.getGpsFixesSent());
+    printPercentiles("GPS decoder latency", gpsLatencies);
+    printf("IMU sentences decoded %zu of %llu sent\n", imuLatencies.size(), (unsigned long long)simulator.getImuSentencesSent());
+    printPercentiles("IMU decoder latency", imuLatencies);
+
+    bool isPassing = (missedDeadlines == 0) && !hasExited;
+    printf("%s\n", isPassing ? "PASS" : "FAIL");
+    return isPassing ? 0 : 1;
+}